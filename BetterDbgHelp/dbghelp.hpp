@@ -289,12 +289,52 @@ public:
 		res->sym_name = res->str_buf;
 		res->src_filepath = nullptr;
 		res->src_lineno = 0;
+		res->num_inline_frames = 0;
 		
-		if (!SymGetLineFromAddr64(inspectee, (DWORD64)addr, &Displacement, &line)) {
-			return nullptr;
+		if (SymGetLineFromAddr64(inspectee, (DWORD64)addr, &Displacement, &line)) {
+			res->src_filepath = line.FileName;
+			res->src_lineno = line.LineNumber;
 		}
-		res->src_filepath = line.FileName;
-		res->src_lineno = line.LineNumber;
+
+		// inline frames, their names go into str_buf after the symbol name
+		DWORD inlineNum = _SymAddrIncludeInlineTrace ? _SymAddrIncludeInlineTrace(inspectee, (DWORD64)addr) : 0;
+		DWORD ctx = 0, idx = 0;
+		if (inlineNum != 0 && _SymQueryInlineTrace(inspectee, (DWORD64)addr, 0, (DWORD64)addr, (DWORD64)addr, &ctx, &idx)) {
+			size_t buf_used = strlen(res->str_buf)+1;
+
+			for (DWORD i=0; i<inlineNum && res->num_inline_frames < SymResolver::Result::MAX_INLINE_FRAMES; i++, ctx++) {
+				if (!_SymFromInlineContext(inspectee, (DWORD64)addr, ctx, NULL, si))
+					continue;
+
+				size_t len = strlen(si->Name)+1;
+				if (buf_used + len > SymResolver::Result::STRBUF_SIZE)
+					break;
+				char* name = res->str_buf + buf_used;
+				memcpy(name, si->Name, len);
+				buf_used += len;
+
+				auto& frame = res->inline_frames[res->num_inline_frames++];
+				frame = { name, nullptr, 0 };
+				if (_SymGetLineFromInlineContext(inspectee, (DWORD64)addr, ctx, 0, &Displacement, &line)) {
+					frame.src_filepath = line.FileName;
+					frame.src_lineno = line.LineNumber;
+				}
+			}
+		}
+		return nullptr;
+	}
+
+	SymResolver::err_t name2addr (const char* name, void** out_addr) {
+		char buf[sizeof(SYMBOL_INFO) + SymResolver::Result::STRBUF_SIZE] = {};
+
+		auto* si = (SYMBOL_INFO*)buf;
+		si->SizeOfStruct = sizeof(SYMBOL_INFO);
+		si->MaxNameLen = SymResolver::Result::STRBUF_SIZE;
+
+		if (!SymFromName(inspectee, name, si)) {
+			return "SymFromName error";
+		}
+		*out_addr = (void*)si->Address;
 		return nullptr;
 	}
 
@@ -0,0 +1,120 @@
+#pragma once
+#include <assert.h>
+#include <vector>
+#include <atomic>
+
+// Hazard pointers, for freeing objects that were published through an atomic pointer (RCU style) while readers might still use them
+// A reader announces the pointer it is about to use in its thread's slot, a writer only frees retired objects that no slot points to
+// Every thread gets one slot (reused by later threads once it exits) holding PER_THREAD pointers,
+// so a thread can protect one object per index at a time, callers agree on what each index is for
+class HazardPointers {
+public:
+	static constexpr int PER_THREAD = 2;
+private:
+	struct alignas(64) Slot { // own cache line, readers write theirs on every lookup
+		std::atomic<const void*> ptr[PER_THREAD] = {};
+		std::atomic<bool> in_use = false;
+		Slot* next = nullptr;
+	};
+	// lock-free list, slots are never freed
+	static inline std::atomic<Slot*> slots = nullptr;
+
+	static Slot* acquire_slot () {
+		for (Slot* s = slots.load(); s; s = s->next) {
+			bool expected = false;
+			if (!s->in_use.load(std::memory_order_relaxed) && s->in_use.compare_exchange_strong(expected, true))
+				return s;
+		}
+		auto* s = new Slot();
+		s->in_use = true;
+		Slot* head = slots.load();
+		do {
+			s->next = head;
+		} while (!slots.compare_exchange_weak(head, s));
+		return s;
+	}
+	static Slot& thread_slot () {
+		struct Holder {
+			Slot* slot = nullptr;
+			~Holder () {
+				if (!slot) return;
+				for (auto& p : slot->ptr)
+					p.store(nullptr);
+				slot->in_use.store(false);
+			}
+		};
+		thread_local Holder holder;
+		if (!holder.slot)
+			holder.slot = acquire_slot();
+		return *holder.slot;
+	}
+
+public:
+	// Loads src and keeps the object alive until clear(), the re-check makes sure a writer that swapped src in the meantime sees our slot
+	template <typename T>
+	static T* protect (std::atomic<T*> const& src, int index = 0) {
+		assert(index >= 0 && index < PER_THREAD);
+		auto& slot = thread_slot().ptr[index];
+		assert(slot.load(std::memory_order_relaxed) == nullptr); // only one per index at a time
+		T* ptr = src.load(std::memory_order_acquire);
+		for (;;) {
+			slot.store(ptr, std::memory_order_seq_cst);
+			T* again = src.load(std::memory_order_seq_cst);
+			if (again == ptr)
+				return ptr;
+			ptr = again;
+		}
+	}
+	static void clear (int index = 0) {
+		thread_slot().ptr[index].store(nullptr, std::memory_order_release);
+	}
+
+	static bool is_protected (const void* ptr) {
+		for (Slot* s = slots.load(); s; s = s->next) {
+			for (auto& p : s->ptr) {
+				if (p.load(std::memory_order_seq_cst) == ptr)
+					return true;
+			}
+		}
+		return false;
+	}
+
+	// Frees every object in retired that is not protected, keeps the rest for the next call
+	template <typename T>
+	static void reclaim (std::vector<T*>* retired) {
+		size_t kept = 0;
+		for (auto* ptr : *retired) {
+			if (is_protected(ptr)) (*retired)[kept++] = ptr;
+			else                   delete ptr;
+		}
+		retired->resize(kept);
+	}
+};
+
+// Scope of one protect() at index, or of several in a row through protect()
+template <typename T>
+class HazardGuard {
+	T* ptr = nullptr;
+	int index;
+public:
+	HazardGuard (std::atomic<T*> const& src, int index = 0): ptr{HazardPointers::protect(src, index)}, index{index} {}
+	// protects nothing until protect()
+	explicit HazardGuard (int index): index{index} {}
+	~HazardGuard () { HazardPointers::clear(index); }
+
+	// drops the previous object
+	T* protect (std::atomic<T*> const& src) {
+		HazardPointers::clear(index);
+		return ptr = HazardPointers::protect(src, index);
+	}
+	void clear () {
+		HazardPointers::clear(index);
+		ptr = nullptr;
+	}
+
+	HazardGuard (HazardGuard const&) = delete;
+	HazardGuard& operator= (HazardGuard const&) = delete;
+
+	T* get () const { return ptr; }
+	T* operator-> () const { return ptr; }
+};
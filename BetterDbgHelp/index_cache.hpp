@@ -0,0 +1,185 @@
+#pragma once
+#include "util.hpp"
+#include <stdint.h>
+#include <random>
+
+// On-disk cache of everything PDB_File needs for lookups (proc index, proc names, decoded line tables, file names)
+// Flat arrays at aligned offsets, so a warm start just maps the file and points FlatArrays at it, nothing is parsed
+// Keyed by the GUID and age from the PDB info stream, which are also in the file path (like in a symbol store),
+// so PDBs with the same file name each get their own cache, and a rebuilt PDB writes a new one next to the old
+// Everything is little-endian and only ever read by the same build that wrote it, so bump the version whenever a layout changes
+
+constexpr char     INDEX_CACHE_MAGIC[8] = { 'B','D','H','I','D','X','\0','\0' };
+constexpr uint32_t INDEX_CACHE_VERSION = 4;
+
+enum IndexCacheArray : uint32_t {
+	ICA_SECTIONS = 0,     // index_cache_section[]
+	ICA_PROC_RVA_BEGIN,   // u32[] ProcIndex columns
+	ICA_PROC_RVA_END,     // u32[]
+	ICA_PROC_SYM_RVA,     // u32[]
+	ICA_PROC_MODULE,      // u16[]
+	ICA_PROC_NAME,        // u32[] offset into ICA_STRINGS
+	ICA_MODULE_LINES,     // index_cache_module_lines[num_modules]
+	ICA_LINE_CONTRIBS,    // PDB_File::LineContrib[] of all modules
+	ICA_LINE_OFFSETS,     // u32[]
+	ICA_LINE_NUMBERS,     // u32[]
+	ICA_NAMES,            // copy of the /names string buffer, LineContrib::file offsets stay valid
+	ICA_STRINGS,          // null-terminated proc and inlinee names
+	ICA_MODULE_INLINES,   // index_cache_module_inlines[num_modules]
+	ICA_INLINE_SITES,     // PDB_File::InlineSite[] of all modules
+	ICA_INLINE_SITE_NAME, // u32[] offset into ICA_STRINGS per site
+	ICA_INLINE_RANGES,    // PDB_File::InlineRange[]
+	ICA_INLINE_SEGMENTS,  // PDB_File::InlineSegment[]
+	ICA_COUNT
+};
+
+struct index_cache_array {
+	uint64_t offset; // from start of file, aligned to 8
+	uint64_t size;   // in bytes
+};
+struct index_cache_header {
+	char     magic[8];
+	uint32_t version;
+	uint32_t age;
+	uint8_t  guid[16];
+	uint32_t num_modules;
+	uint32_t reserved;
+	index_cache_array arrays[ICA_COUNT];
+};
+struct index_cache_section {
+	char     name[8];
+	uint32_t rva;
+	uint32_t size;
+};
+// range of a module's line table in the ICA_LINE_* arrays, LineContrib::first_line is relative to first_line
+struct index_cache_module_lines {
+	uint32_t first_contrib;
+	uint32_t num_contribs;
+	uint32_t first_line;
+	uint32_t num_lines;
+};
+
+// range of a module's inline table in the ICA_INLINE_* arrays, indices inside are relative to the module again
+struct index_cache_module_inlines {
+	uint32_t first_site;
+	uint32_t num_sites;
+	uint32_t first_range;
+	uint32_t num_ranges;
+	uint32_t first_segment;
+	uint32_t num_segments;
+};
+
+// Collects the arrays in memory and writes them out in one go
+class IndexCacheWriter {
+	index_cache_header header = {};
+	std::vector<char> data;
+public:
+	IndexCacheWriter (const uint8_t guid[16], uint32_t age, uint32_t num_modules) {
+		memcpy(header.magic, INDEX_CACHE_MAGIC, sizeof(header.magic));
+		header.version = INDEX_CACHE_VERSION;
+		header.age = age;
+		memcpy(header.guid, guid, sizeof(header.guid));
+		header.num_modules = num_modules;
+		data.resize(sizeof(header));
+	}
+
+	void add (IndexCacheArray arr, const void* ptr, size_t size) {
+		data.resize((data.size() + 7) & ~(size_t)7);
+		header.arrays[arr] = { data.size(), size };
+		data.insert(data.end(), (const char*)ptr, (const char*)ptr + size);
+	}
+	template <typename T>
+	void add (IndexCacheArray arr, std::vector<T> const& vec) {
+		add(arr, vec.data(), vec.size() * sizeof(T));
+	}
+	template <typename T>
+	void add (IndexCacheArray arr, FlatArray<T> const& vec) {
+		add(arr, vec.data(), vec.size() * sizeof(T));
+	}
+
+	// writes to a temporary file first and renames it, so a concurrent reader never maps a half written cache
+	bool write (std::string const& path) {
+		memcpy(data.data(), &header, sizeof(header));
+
+		std::error_code ec;
+		auto dir = std::filesystem::path(path).parent_path();
+		if (!dir.empty())
+			std::filesystem::create_directories(dir, ec);
+
+		// unique per writer, two processes writing the same cache at once each rename their own complete file
+	#if defined(_WIN32)
+		uint32_t pid = (uint32_t)GetCurrentProcessId();
+	#else
+		uint32_t pid = (uint32_t)getpid();
+	#endif
+		char suffix[32];
+		snprintf(suffix, sizeof(suffix), ".%u.%08x.tmp", pid, (uint32_t)std::random_device()());
+		std::string tmp_path = path + suffix;
+		{
+			std::ofstream ofs(tmp_path, std::ios::binary|std::ios::trunc);
+			if (!ofs || !ofs.write(data.data(), data.size())) {
+				ofs.close();
+				std::filesystem::remove(tmp_path, ec);
+				return false;
+			}
+		}
+		std::filesystem::rename(tmp_path, path, ec);
+		if (ec) {
+			std::filesystem::remove(tmp_path, ec);
+			return false;
+		}
+		return true;
+	}
+};
+
+// Maps a cache file and checks it against the PDB, arrays can then be viewed in-place
+class IndexCacheReader {
+	MappedFile mapped;
+	const index_cache_header* header = nullptr;
+public:
+	bool open (std::string const& path, const uint8_t guid[16], uint32_t age) {
+		if (!mapped.open(path))
+			return false;
+		if (!validate(guid, age)) {
+			mapped.close(); // windows won't let us overwrite it while mapped
+			return false;
+		}
+		header = (const index_cache_header*)mapped.data();
+		return true;
+	}
+	bool validate (const uint8_t guid[16], uint32_t age) const {
+		if (mapped.size() < sizeof(index_cache_header))
+			return false;
+
+		auto* h = (const index_cache_header*)mapped.data();
+		if (memcmp(h->magic, INDEX_CACHE_MAGIC, sizeof(h->magic)) != 0 || h->version != INDEX_CACHE_VERSION)
+			return false;
+		if (h->age != age || memcmp(h->guid, guid, sizeof(h->guid)) != 0)
+			return false; // stale, PDB was rebuilt
+
+		for (auto& arr : h->arrays) {
+			if (arr.offset % 8 != 0 || arr.offset > mapped.size() || arr.size > mapped.size() - arr.offset)
+				return false; // truncated or corrupted
+		}
+		return true;
+	}
+	void close () {
+		mapped.close();
+		header = nullptr;
+	}
+	bool is_open () const { return header != nullptr; }
+	index_cache_header const& get_header () const { return *header; }
+
+	template <typename T>
+	size_t count (IndexCacheArray arr) const {
+		return header->arrays[arr].size / sizeof(T);
+	}
+	template <typename T>
+	const T* get (IndexCacheArray arr) const {
+		return (const T*)(mapped.data() + header->arrays[arr].offset);
+	}
+	template <typename T>
+	void view (IndexCacheArray arr, FlatArray<T>* out) const {
+		out->view(get<T>(arr), count<T>(arr));
+	}
+};
@@ -1,5 +1,7 @@
 #include "util.hpp"
 #include <functional>
+#include <cmath>
+#include <thread>
 
 #include <psapi.h>
 #pragma comment(lib, "Kernel32.lib")
@@ -7,6 +9,39 @@
 #include "dbghelp.hpp"
 #include "sym_resolver.hpp"
 
+// One side failed and the other didn't, or both resolved but to a different symbol, line or inline frames
+static bool results_differ (SymResolver::err_t err_a, SymResolver::Result const& a, SymResolver::err_t err_b, SymResolver::Result const& b,
+		bool check_inline_frames = true) {
+	if ((err_a == nullptr) != (err_b == nullptr)) return true;
+	if (err_a) return false;
+	return a != b || (check_inline_frames && !a.inline_frames_equal(b));
+}
+
+// Resolves every address with both resolvers and counts where they differ
+template <typename ADDR>
+static size_t count_result_mismatches (SymResolver& resolver_a, SymResolver& resolver_b, std::vector<ADDR> const& addrs) {
+	size_t mismatches = 0;
+	for (auto addr : addrs) {
+		SymResolver::Result a, b;
+		auto err_a = resolver_a.addr2sym(addr, &a);
+		auto err_b = resolver_b.addr2sym(addr, &b);
+		if (results_differ(err_a, a, err_b, b))
+			mismatches++;
+	}
+	return mismatches;
+}
+// Counts where two runs over the same addresses resolved differently
+static size_t count_result_mismatches (std::vector<SymResolver::err_t> const& errs_a, std::vector<SymResolver::Result> const& results_a,
+		std::vector<SymResolver::err_t> const& errs_b, std::vector<SymResolver::Result> const& results_b) {
+	assert(errs_a.size() == results_a.size() && errs_b.size() == results_b.size() && results_a.size() == results_b.size());
+	size_t mismatches = 0;
+	for (size_t i=0; i<results_a.size(); i++) {
+		if (results_differ(errs_a[i], results_a[i], errs_b[i], results_b[i]))
+			mismatches++;
+	}
+	return mismatches;
+}
+
 class SymTesting {
 	STARTUPINFOA si{};
 	PROCESS_INFORMATION pi{};
@@ -35,9 +70,23 @@ class SymTesting {
 	};
 
 	LoadedModules loaded_modules;
+	// the same, fed to resolver_indexed instead of it enumerating the process
+	std::shared_ptr<ModuleMap> module_map = std::make_shared<ModuleMap>();
+
+	void on_module_loaded (HANDLE hFile, void* addr) {
+		char name[1024] = {};
+		GetFinalPathNameByHandleA(hFile, name, sizeof(name), FILE_NAME_NORMALIZED);
+		loaded_modules.add(std::string(name), addr);
+
+		// GetFinalPathNameByHandle returns \\?\C:\..., which GetModuleFileNameEx does not
+		std::string_view path = name;
+		if (path.substr(0, 4) == "\\\\?\\") path.remove_prefix(4);
+		module_map->load(std::string(path), (uintptr_t)addr);
+	}
 
 	std::unique_ptr<Debughelp> dbghelp;
 	std::unique_ptr<SymResolver> resolver;
+	std::unique_ptr<SymResolver> resolver_indexed; // same, but through the global proc index and with modules from module_map
 	
 	void start_debugging_child_process (std::string const& exe_filepath, float max_run_time) {
 		// Start exe as child process with DEBUG_ONLY_THIS_PROCESS
@@ -86,11 +135,9 @@ class SymTesting {
 					HANDLE hFile = de.u.CreateProcessInfo.hFile;
 					LPVOID addr  = de.u.CreateProcessInfo.lpBaseOfImage;
 
-					char name[1024] = {};
-					GetFinalPathNameByHandleA(hFile, name, sizeof(name), FILE_NAME_NORMALIZED);
-					loaded_modules.add(std::string(name), addr);
+					on_module_loaded(hFile, addr);
 
-					//printf("CREATE_PROCESS_DEBUG_EVENT: Module \"%50s\" at %p\n", name, addr);
+					//printf("CREATE_PROCESS_DEBUG_EVENT: Module at %p\n", addr);
 
 					CloseHandle(hFile);
 					de.u.CreateProcessInfo.hFile = NULL;
@@ -99,15 +146,16 @@ class SymTesting {
 					HANDLE hFile = de.u.LoadDll.hFile;
 					LPVOID addr  = de.u.LoadDll.lpBaseOfDll;
 
-					char name[1024] = {};
-					GetFinalPathNameByHandleA(hFile, name, sizeof(name), FILE_NAME_NORMALIZED);
-					loaded_modules.add(std::string(name), addr);
+					on_module_loaded(hFile, addr);
 
-					//printf("LOAD_DLL_DEBUG_EVENT:       Module \"%50s\" at %p\n", name, addr);
+					//printf("LOAD_DLL_DEBUG_EVENT:       Module at %p\n", addr);
 
 					CloseHandle(hFile);
 					de.u.LoadDll.hFile = NULL;
 				} break;
+				case UNLOAD_DLL_DEBUG_EVENT: {
+					module_map->unload((uintptr_t)de.u.UnloadDll.lpBaseOfDll);
+				} break;
 				case CREATE_THREAD_DEBUG_EVENT: {
 					//printf("CREATE_THREAD_DEBUG_EVENT:\n");
 				} break;
@@ -159,11 +207,17 @@ public:
 		start_debugging_child_process(exe_filepath, max_run_time);
 		dbghelp = std::make_unique<Debughelp>(pi.hProcess);
 		resolver = std::make_unique<SymResolver>(pi.hProcess);
+
+		PDB_File::Options indexed_opt;
+		indexed_opt.proc_index = true;
+		indexed_opt.load_threads = 0;
+		resolver_indexed = std::make_unique<SymResolver>(module_map, indexed_opt);
 	}
 
 	~SymTesting () {
 		dbghelp = nullptr;
 		resolver = nullptr;
+		resolver_indexed = nullptr;
 
 		printf("Killing process\n");
 		finish_debugging_and_kill_child_process();
@@ -180,12 +234,20 @@ public:
 	void measure_addr2sym (char* addr) {
 		dbghelp->measure_addr2sym(addr);
 		resolver->measure_addr2sym(addr);
+		resolver_indexed->measure_addr2sym(addr);
 	}
 	void test_addr2sym (char* addr) {
-		SymResolver::Result res={}, res_dbghelp={};
+		SymResolver::Result res={}, res_dbghelp={}, res_indexed={};
 
 		auto err_dbghelp = dbghelp->addr2sym(addr, &res_dbghelp);
 		auto err         = resolver->addr2sym(addr, &res);
+		auto err_indexed = resolver_indexed->addr2sym(addr, &res_indexed);
+
+		if (results_differ(err, res, err_indexed, res_indexed, false)) { // inline frames are compared below, with a listing
+			printf("!!! [%16llx %s] Indexed SymResolver differs: %s / %s\n", (uintptr_t)addr, res.sym_name,
+				err ? err : "ok", err_indexed ? err_indexed : "ok");
+			tests_failed = true;
+		}
 		
 		if (err_dbghelp) {
 			printf("!!! [%16llx %s] dbghelp.dll Error: %s\n", (uintptr_t)addr, res_dbghelp.sym_name, err_dbghelp);
@@ -204,6 +266,35 @@ public:
 			tests_failed = true;
 			return;
 		}
+		if (!res.inline_frames_equal(res_dbghelp) || !res.inline_frames_equal(res_indexed)) {
+			printf("!!! [%16llx %s] Inline frames mismatch:\n", (uintptr_t)addr, res_dbghelp.sym_name);
+			for (auto* r : { &res, &res_indexed, &res_dbghelp }) {
+				printf("> %s:\n", r == &res ? "sym" : r == &res_indexed ? "sym indexed" : "dbghelp.dll");
+				for (uint32_t i=0; i<r->num_inline_frames; i++) {
+					auto& f = r->inline_frames[i];
+					printf(">   %s @ %s:%d\n", f.sym_name, f.src_filepath ? f.src_filepath : "?", f.src_lineno);
+				}
+			}
+			tests_failed = true;
+		}
+
+		test_name2addr(res.sym_name);
+	}
+	void test_name2addr (const char* name) {
+		void* addr = nullptr;
+		void* addr_dbghelp = nullptr;
+		auto err         = resolver->name2addr(name, &addr);
+		auto err_dbghelp = dbghelp->name2addr(name, &addr_dbghelp);
+		if (err_dbghelp)
+			return; // can't compare
+		if (err) {
+			printf("!!! [%s] SymResolver name2addr Error: %s\n", name, err);
+			tests_failed = true;
+		}
+		else if (addr != addr_dbghelp) {
+			// names are not unique (overloads, lambdas), both might just have picked different ones
+			printf("[%s] name2addr differs: %16llx dbghelp.dll: %16llx\n", name, (uintptr_t)addr, (uintptr_t)addr_dbghelp);
+		}
 	}
 
 	template <typename FUNC>
@@ -222,15 +313,516 @@ public:
 		dbghelp->print_timings();
 		printf("---\n");
 		resolver->print_timings();
+		printf("--- indexed\n");
+		resolver_indexed->print_timings();
+
+		std::vector<char*> addrs;
+		run_examples([&] (char* addr) { addrs.push_back(addr); });
+		measure_batch(addrs);
+		measure_hot_cache(addrs);
+		stress_concurrent(addrs);
+		measure_concurrent_scaling(addrs);
+		measure_shared_pdbs(addrs);
+		measure_memory_budget(addrs);
+		measure_compact(addrs);
+		measure_async_loading(addrs);
+	}
+
+	// The first address of every module with the PDB loaded right there (what the warmup timer measures) vs on the background loader,
+	// where that first call only returns PDB_PENDING, and everything resolves once the loads are done
+	void measure_async_loading (std::vector<char*> const& example_addrs) {
+		PdbRegistry::global().set_sharing(false); // PDBs of the other resolvers would make loading free
+
+		for (bool async : { false, true }) {
+			SymResolver r(pi.hProcess);
+			std::atomic<int> loaded = 0;
+			if (async)
+				r.set_async_loading(true, 0, [&] (const char* module_path, bool ok) { loaded++; });
+
+			size_t pending = 0;
+			float worst_sec = 0;
+			auto t = Timer::start();
+			for (auto* addr : example_addrs) {
+				SymResolver::Result res;
+				auto t_call = Timer::start();
+				if (r.addr2sym(addr, &res) == SymResolver::PDB_PENDING)
+					pending++;
+				worst_sec = std::max(worst_sec, t_call.elapsed_sec());
+			}
+			float first_pass_sec = t.elapsed_sec();
+
+			bool done = r.wait_for_loads(60000);
+			float all_loaded_sec = t.elapsed_sec();
+
+			size_t mismatches = count_result_mismatches(r, *resolver, example_addrs);
+
+			printf("|%-5s first pass %8.3f ms (slowest call %8.3f ms, %4zu pending)  all loaded after %8.3f ms  %d callbacks  mismatches %zu\n",
+				async ? "async" : "sync", first_pass_sec * 1000, worst_sec * 1000, pending, all_loaded_sec * 1000, loaded.load(), mismatches);
+			if (!done || mismatches) tests_failed = true;
+		}
+
+		PdbRegistry::global().set_sharing(true);
+	}
+
+	// Resolving and keeping num_samples samples of the examples (like a profiler would) as Results vs CompactResults
+	// Keeping a million Results would take GBs, so those only get resolved into a reused buffer, the bytes are what keeping them would take
+	void measure_compact (std::vector<char*> const& example_addrs, size_t num_samples = 1000000) {
+		std::vector<void*> samples(num_samples);
+		uint32_t rng = 1;
+		for (auto& s : samples) {
+			rng = rng * 1664525u + 1013904223u;
+			s = example_addrs[(rng >> 8) % example_addrs.size()];
+		}
+
+		SymResolver r(pi.hProcess);
+		r.set_hot_cache(false); // compare the resolving itself
+		for (auto* addr : example_addrs) {
+			SymResolver::Result res;
+			r.addr2sym(addr, &res); // load the modules
+		}
+
+		size_t mismatches = 0;
+		for (auto* addr : example_addrs) {
+			SymResolver::Result res, expanded;
+			SymResolver::CompactResult c;
+			auto err = r.addr2sym(addr, &res);
+			auto c_err = r.addr2sym_compact(addr, &c);
+			if (!c_err) c_err = r.expand(c, &expanded);
+			if (results_differ(err, res, c_err, expanded, false)) // compact results don't keep inline frames
+				mismatches++;
+		}
+		if (mismatches) {
+			printf("compact results differ for %zu addresses\n", mismatches);
+			tests_failed = true;
+		}
+
+		auto print = [&] (const char* name, float sec, size_t bytes_per_sample) {
+			printf("|%-22s %8.3f ms  %7.1f ns/sample  keeping %zu samples: %10.3f MB\n", name, sec * 1000, sec / num_samples * 1e9,
+				num_samples, (double)bytes_per_sample * num_samples / (1024*1024));
+		};
+
+		{
+			SymResolver::Result res;
+			auto t = Timer::start();
+			for (auto* s : samples)
+				r.addr2sym(s, &res);
+			print("addr2sym", t.elapsed_sec(), sizeof(SymResolver::Result));
+		}
+		{
+			std::vector<SymResolver::CompactResult> res(num_samples);
+			auto t = Timer::start();
+			for (size_t i=0; i<num_samples; i++)
+				r.addr2sym_compact(samples[i], &res[i]);
+			print("addr2sym_compact", t.elapsed_sec(), sizeof(SymResolver::CompactResult));
+		}
+		{
+			constexpr size_t CHUNK = 4096;
+			std::vector<SymResolver::Result> res(CHUNK);
+			std::vector<SymResolver::err_t> errs(CHUNK);
+			auto t = Timer::start();
+			for (size_t i=0; i<num_samples; i+=CHUNK)
+				r.addr2sym_batch(samples.data() + i, std::min(CHUNK, num_samples - i), res.data(), errs.data());
+			print("addr2sym_batch", t.elapsed_sec(), sizeof(SymResolver::Result));
+		}
+		{
+			std::vector<SymResolver::CompactResult> res(num_samples);
+			std::vector<SymResolver::err_t> errs(num_samples);
+			auto t = Timer::start();
+			r.addr2sym_batch_compact(samples.data(), num_samples, res.data(), errs.data());
+			print("addr2sym_batch_compact", t.elapsed_sec(), sizeof(SymResolver::CompactResult));
+		}
+	}
+
+	// Resolving the examples again and again with the budget at a fraction of what all their PDBs take,
+	// results have to stay the same no matter how often the PDBs got evicted and reloaded in between
+	void measure_memory_budget (std::vector<char*> const& example_addrs, int rounds = 4) {
+		SymResolver full(pi.hProcess);
+		std::vector<SymResolver::Result> expected(example_addrs.size());
+		std::vector<SymResolver::err_t> expected_errs(example_addrs.size());
+		for (size_t i=0; i<example_addrs.size(); i++)
+			expected_errs[i] = full.addr2sym(example_addrs[i], &expected[i]);
+		size_t full_bytes = full.get_memory_stats().resident_bytes;
+
+		for (double fraction : { 1.0, 0.5, 0.25 }) {
+			PDB_File::Options opt;
+			opt.index_cache_dir = "index_cache"; // so reloads don't have to parse again
+			SymResolver r(pi.hProcess, opt);
+			r.set_memory_budget(std::max((size_t)(full_bytes * fraction), (size_t)1));
+
+			size_t mismatches = 0;
+			auto t = Timer::start();
+			for (int round=0; round<rounds; round++) {
+				for (size_t i=0; i<example_addrs.size(); i++) {
+					SymResolver::Result res;
+					auto err = r.addr2sym(example_addrs[i], &res);
+					if (results_differ(err, res, expected_errs[i], expected[i]))
+						mismatches++;
+				}
+			}
+			float sec = t.elapsed_sec();
+
+			auto stats = r.get_memory_stats();
+			printf("|budget %4.0f%% of %8.3f MB: %8.3f ms  evictions %5zu  reloads %5zu  resident %8.3f MB  mismatches %zu\n",
+				fraction * 100, (double)full_bytes / (1024*1024), sec * 1000,
+				stats.evictions, stats.reloads, (double)stats.resident_bytes / (1024*1024), mismatches);
+			if (mismatches) tests_failed = true;
+		}
+	}
+
+	// Attaching num_resolvers resolvers (standing in for one per inspected process) that all load the same modules,
+	// with every resolver loading its own PDBs vs sharing them through PdbRegistry
+	void measure_shared_pdbs (std::vector<char*> const& example_addrs, int num_resolvers = 8) {
+		for (bool sharing : { false, true }) {
+			PdbRegistry::global().set_sharing(sharing);
+
+			size_t rss_before = get_resident_bytes();
+			auto t = Timer::start();
+			std::vector<std::unique_ptr<SymResolver>> resolvers;
+			for (int i=0; i<num_resolvers; i++) {
+				auto& r = resolvers.emplace_back(std::make_unique<SymResolver>(pi.hProcess));
+				SymResolver::Result res;
+				for (auto* addr : example_addrs)
+					r->addr2sym(addr, &res); // loads every module the examples touch
+			}
+			float sec = t.elapsed_sec();
+			size_t rss_after = get_resident_bytes();
+
+			printf("|%d resolvers, %-10s attach %8.3f ms  rss +%8.3f MB  unique pdbs alive %zu\n", num_resolvers,
+				sharing ? "shared" : "not shared", sec * 1000, (double)(rss_after - rss_before) / (1024*1024), PdbRegistry::global().num_loaded());
+		}
+	}
+
+	// Threads resolving the example addresses (and some around them) in different orders on a fresh resolver,
+	// so modules get added while other threads are looking them up, every result has to match the single threaded resolver
+	void stress_concurrent (std::vector<char*> const& example_addrs, uint32_t num_threads = 8, int rounds = 4) {
+		std::vector<void*> addrs;
+		for (auto* addr : example_addrs) {
+			for (int offs=0; offs<64; offs += 13)
+				addrs.push_back(addr + offs);
+		}
+		std::vector<SymResolver::Result> expected(addrs.size());
+		std::vector<SymResolver::err_t> expected_errs(addrs.size());
+		for (size_t i=0; i<addrs.size(); i++) {
+			expected_errs[i] = resolver->addr2sym(addrs[i], &expected[i]);
+		}
+
+		std::atomic<size_t> mismatches = 0;
+		auto t = Timer::start();
+		for (int round=0; round<rounds; round++) {
+			PDB_File::Options opt;
+			opt.proc_index = round % 2 == 1;
+			SymResolver shared(pi.hProcess, opt);
+
+			std::vector<std::thread> threads;
+			for (uint32_t ti=0; ti<num_threads; ti++) {
+				threads.emplace_back([&, ti] () {
+					uint32_t rng = 777 + ti * 31 + round;
+					SymResolver::Result res;
+					for (int pass=0; pass<8; pass++) {
+						for (size_t k=0; k<addrs.size(); k++) {
+							rng = rng * 1664525u + 1013904223u;
+							size_t i = (rng >> 8) % addrs.size();
+							auto err = shared.addr2sym(addrs[i], &res);
+							if (results_differ(err, res, expected_errs[i], expected[i]))
+								mismatches++;
+						}
+					}
+				});
+			}
+			for (auto& th : threads)
+				th.join();
+		}
+		if (mismatches) {
+			printf("!!! concurrent addr2sym differs from single threaded for %zu lookups\n", mismatches.load());
+			tests_failed = true;
+		}
+		printf("|concurrent stress: %u threads x %d rounds over %zu addrs, %zu mismatches, %.3f s\n",
+			num_threads, rounds, addrs.size(), mismatches.load(), t.elapsed_sec());
+	}
+
+	// Lookups per second of one warmed up resolver shared by more and more threads
+	void measure_concurrent_scaling (std::vector<char*> const& example_addrs, size_t lookups_per_thread = 200000) {
+		uint32_t max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+		for (bool hot_cache : { false, true }) {
+			resolver_indexed->set_hot_cache(hot_cache);
+			float base_rate = 0;
+			for (uint32_t num_threads=1; num_threads<=max_threads; num_threads *= 2) {
+				std::vector<std::thread> threads;
+				auto t = Timer::start();
+				for (uint32_t ti=0; ti<num_threads; ti++) {
+					threads.emplace_back([&, ti] () {
+						uint32_t rng = 99 + ti;
+						SymResolver::Result res;
+						for (size_t k=0; k<lookups_per_thread; k++) {
+							rng = rng * 1664525u + 1013904223u;
+							resolver_indexed->addr2sym(example_addrs[(rng >> 8) % example_addrs.size()] + ((rng >> 24) % 64), &res);
+						}
+					});
+				}
+				for (auto& th : threads)
+					th.join();
+				float rate = (float)(num_threads * lookups_per_thread) / t.elapsed_sec();
+				if (num_threads == 1) base_rate = rate;
+				printf("|indexed %-12s %2u threads: %8.3f M lookups/s  scaling %5.2fx\n", hot_cache ? "hot cache" : "no hot cache",
+					num_threads, rate / 1e6f, rate / base_rate);
+			}
+		}
+		resolver_indexed->set_hot_cache(true);
+	}
+
+	// Zipf-distributed replay of the example addresses (a few very hot, long tail), like the return addresses a sampling profiler sees
+	// resolved with the per-thread hot cache on and off
+	void measure_hot_cache (std::vector<char*> const& example_addrs, size_t num_samples = 200000, double zipf_s = 1.1) {
+		// every example address plus some neighbours, ranked in random order
+		std::vector<void*> distinct;
+		for (auto* addr : example_addrs) {
+			for (int offs=0; offs<64; offs += 7)
+				distinct.push_back(addr + offs);
+		}
+		uint32_t rng = 6789;
+		auto next_rand = [&] () { rng = rng * 1664525u + 1013904223u; return rng; };
+		for (size_t i=distinct.size(); i>1; i--) {
+			std::swap(distinct[i-1], distinct[next_rand() % i]);
+		}
+
+		std::vector<double> cdf(distinct.size());
+		double sum = 0;
+		for (size_t k=0; k<distinct.size(); k++) {
+			sum += 1.0 / std::pow((double)(k+1), zipf_s);
+			cdf[k] = sum;
+		}
+		std::vector<void*> samples(num_samples);
+		for (auto& s : samples) {
+			double u = (double)(next_rand() >> 8) / (double)(1u << 24) * sum;
+			size_t k = std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+			s = distinct[std::min(k, distinct.size()-1)];
+		}
+
+		std::vector<SymResolver::Result> results(num_samples), results_cached(num_samples);
+		std::vector<SymResolver::err_t> errs(num_samples), errs_cached(num_samples);
+
+		auto measure = [&] (SymResolver& r, const char* name) {
+			r.set_hot_cache(false);
+			auto t = Timer::start();
+			for (size_t i=0; i<num_samples; i++) {
+				errs[i] = r.addr2sym(samples[i], &results[i]);
+			}
+			float uncached_sec = t.elapsed_sec();
+
+			r.set_hot_cache(true);
+			SymResolver::reset_thread_hot_cache_stats();
+			t = Timer::start();
+			for (size_t i=0; i<num_samples; i++) {
+				errs_cached[i] = r.addr2sym(samples[i], &results_cached[i]);
+			}
+			float cached_sec = t.elapsed_sec();
+			auto stats = SymResolver::get_thread_hot_cache_stats();
+
+			size_t mismatches = count_result_mismatches(errs, results, errs_cached, results_cached);
+			if (mismatches) {
+				printf("!!! hot cache differs from uncached addr2sym for %zu of %zu addresses\n", mismatches, num_samples);
+				tests_failed = true;
+			}
+			printf("|%-8s zipf(%.2f) over %zu addrs x%zu: uncached %9.3f ns/addr  hot cache %9.3f ns/addr  hit rate %6.2f%%\n",
+				name, zipf_s, distinct.size(), num_samples, uncached_sec * 1e9f / (float)num_samples, cached_sec * 1e9f / (float)num_samples,
+				stats.hit_rate() * 100.0f);
+		};
+		measure(*resolver, "linear");
+		measure(*resolver_indexed, "indexed");
+	}
+
+	// Profiler-like sample set: lots of addresses clustered around the example addresses, with plenty of duplicates
+	// resolved once with addr2sym per address and once with addr2sym_batch
+	void measure_batch (std::vector<char*> const& example_addrs, size_t num_samples = 20000) {
+		std::vector<void*> samples(num_samples);
+		uint32_t rng = 12345;
+		for (auto& s : samples) {
+			rng = rng * 1664525u + 1013904223u;
+			s = example_addrs[(rng >> 8) % example_addrs.size()] + ((rng >> 24) % 64);
+		}
+
+		std::vector<SymResolver::Result> results(num_samples), results_batch(num_samples);
+		std::vector<SymResolver::err_t> errs(num_samples), errs_batch(num_samples);
+
+		auto measure = [&] (SymResolver& r, const char* name) {
+			auto t = Timer::start();
+			for (size_t i=0; i<num_samples; i++) {
+				errs[i] = r.addr2sym(samples[i], &results[i]);
+			}
+			float single_sec = t.elapsed_sec();
+
+			t = Timer::start();
+			r.addr2sym_batch(samples.data(), num_samples, results_batch.data(), errs_batch.data());
+			float batch_sec = t.elapsed_sec();
+
+			size_t mismatches = count_result_mismatches(errs, results, errs_batch, results_batch);
+			if (mismatches) {
+				printf("!!! addr2sym_batch differs from addr2sym for %zu of %zu addresses\n", mismatches, num_samples);
+				tests_failed = true;
+			}
+			printf("|%-8s addr2sym x%zu: %9.3f ns/addr  addr2sym_batch: %9.3f ns/addr  speedup %5.2fx\n", name, num_samples,
+				single_sec * 1e9f / (float)num_samples, batch_sec * 1e9f / (float)num_samples, single_sec / batch_sec);
+		};
+		measure(*resolver, "linear");
+		measure(*resolver_indexed, "indexed");
 	}
 	void warmup (char* addr) {
 		dbghelp->warmup_addr2sym(addr);
 		resolver->warmup_addr2sym(addr);
+		resolver_indexed->warmup_addr2sym(addr);
 	}
 };
 
+// Compare the old load path (read whole file, copy and parse every stream) against mapping the file and lazy module loading
+static void compare_pdb_loading (std::string const& pdb_path) {
+	struct Config {
+		const char* name;
+		bool map_file;
+		bool lazy_modules;
+	};
+	Config configs[] = {
+		{ "read",      false, false },
+		{ "mapped",    true,  false },
+		{ "lazy",      true,  true  },
+	};
+	for (auto& cfg : configs) {
+		PDB_File::Options opt;
+		opt.map_file = cfg.map_file;
+		opt.lazy_modules = cfg.lazy_modules;
+
+		size_t rss_before = get_resident_bytes();
+		auto t = Timer::start();
+
+		auto pdb = PDB_File::try_load_pdb(std::string(pdb_path), opt);
+		if (!pdb) {
+			printf("Could not load %s\n", pdb_path.c_str());
+			return;
+		}
+
+		float ms = t.elapsed_sec() * 1000.0f;
+		size_t rss_after = get_resident_bytes();
+
+		printf("|%-6s %-45s: %9.3f ms  RSS +%8.2f MB  (streams in-place %8.2f MB, copied %8.2f MB)\n",
+			cfg.name, pdb_path.c_str(), ms,
+			(double)(rss_after - rss_before) / (1024*1024),
+			(double)pdb->stream_bytes_in_place / (1024*1024),
+			(double)pdb->stream_bytes_copied / (1024*1024));
+	}
+}
+
+// Full (non-lazy) load with 1..N threads, checking that every parallel load produced the same modules as the serial one
+static void measure_load_scaling (std::string const& pdb_path) {
+	auto load = [&] (u32 threads, float* out_ms) {
+		PDB_File::Options opt;
+		opt.lazy_modules = false;
+		opt.load_threads = threads;
+
+		auto t = Timer::start();
+		auto pdb = PDB_File::try_load_pdb(std::string(pdb_path), opt);
+		*out_ms = t.elapsed_sec() * 1000.0f;
+		return pdb;
+	};
+	auto same_modules = [] (PDB_File& a, PDB_File& b) {
+		if (a.num_modules() != b.num_modules()) return false;
+		for (u32 i=0; i<a.num_modules(); i++) {
+			auto& ma = a.get_module(i);
+			auto& mb = b.get_module(i);
+			if (ma.procsyms.size() != mb.procsyms.size()) return false;
+			for (size_t j=0; j<ma.procsyms.size(); j++) {
+				auto* pa = ma.procsyms[j].proc;
+				auto* pb = mb.procsyms[j].proc;
+				if (pa->seg != pb->seg || pa->off != pb->off || pa->len != pb->len || strcmp((char*)pa->name, (char*)pb->name) != 0)
+					return false;
+			}
+		}
+		return true;
+	};
+
+	float serial_ms;
+	auto serial = load(1, &serial_ms);
+	if (!serial) {
+		printf("Could not load %s\n", pdb_path.c_str());
+		return;
+	}
+	printf("|load %-45s  1 threads: %9.3f ms\n", pdb_path.c_str(), serial_ms);
+
+	u32 max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+	for (u32 threads=2; threads < max_threads*2; threads *= 2) {
+		threads = std::min(threads, max_threads);
+
+		float ms;
+		auto pdb = load(threads, &ms);
+		printf("|load %-45s %2d threads: %9.3f ms  speedup %5.2fx%s\n", pdb_path.c_str(), threads, ms, serial_ms / ms,
+			same_modules(*serial, *pdb) ? "" : "  !!! differs from serial load");
+	}
+}
+
+// Cold start builds the proc index and writes the index cache, warm start only maps the cache
+// then checks that every indexed proc resolves to the same name and line either way
+static void measure_index_cache (std::string const& pdb_path) {
+	PDB_File::Options opt;
+	opt.index_cache_dir = "index_cache";
+	opt.load_threads = 0;
+
+	std::error_code ec;
+	std::filesystem::remove_all(opt.index_cache_dir, ec);
+
+	auto load = [&] (const char* name) {
+		size_t rss_before = get_resident_bytes();
+		auto t = Timer::start();
+		auto pdb = PDB_File::try_load_pdb(std::string(pdb_path), opt);
+		float ms = t.elapsed_sec() * 1000.0f;
+		if (pdb) {
+			printf("|%-5s %-45s: %9.3f ms  RSS +%8.2f MB%s\n", name, pdb_path.c_str(), ms,
+				(double)(get_resident_bytes() - rss_before) / (1024*1024),
+				pdb->is_from_index_cache() ? "  (from index cache)" : "");
+		}
+		return pdb;
+	};
+
+	auto cold = load("cold");
+	if (!cold) {
+		printf("Could not load %s\n", pdb_path.c_str());
+		return;
+	}
+	auto warm = load("warm");
+	if (!warm || !warm->is_from_index_cache()) {
+		printf("!!! Index cache for %s was not used\n", pdb_path.c_str());
+		return;
+	}
+
+	auto& index = cold->get_proc_index();
+	size_t mismatches = 0;
+	for (size_t i=0; i<index.size(); i++) {
+		u32 rva = index.rva_begin[i];
+		PDB_File::IndexedSymbol a, b;
+		bool fa = cold->find_symbol_indexed(rva, &a);
+		bool fb = warm->find_symbol_indexed(rva, &b);
+		if (fa != fb || (fa && (strcmp(a.name, b.name) != 0 || a.module != b.module))) {
+			mismatches++;
+			continue;
+		}
+		SourceLoc la = {}, lb = {};
+		bool sa = cold->find_source_loc(cold->get_module(a.module), a.sec_id, a.sec_raddr, &la);
+		bool sb = warm->find_source_loc(warm->get_module(b.module), b.sec_id, b.sec_raddr, &lb);
+		if (sa != sb || (sa && (la.lineno != lb.lineno || strcmp(la.filepath, lb.filepath) != 0)))
+			mismatches++;
+	}
+	printf("|cache %-45s: %zu procs checked, %zu mismatches\n", pdb_path.c_str(), index.size(), mismatches);
+}
+
 int main(int argc, const char** argv) {
 
+	compare_pdb_loading("TinyProgram.pdb");
+	compare_pdb_loading("CityBuilderExample/city_builder_rel.pdb");
+	compare_pdb_loading("RustBevyExample/rust_bevy_test.pdb");
+
+	measure_load_scaling("RustBevyExample/rust_bevy_test.pdb");
+
+	measure_index_cache("CityBuilderExample/city_builder_rel.pdb");
+	measure_index_cache("RustBevyExample/rust_bevy_test.pdb");
+
 	try {
 		SymTesting sym("TinyProgram.exe", 0.5f);
 
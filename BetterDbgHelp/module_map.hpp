@@ -0,0 +1,224 @@
+#pragma once
+#include "util.hpp"
+#include <mutex>
+#include <atomic>
+
+// Where SymResolver learns which module is loaded at an address
+// It only asks on addresses outside of the modules it already knows, and checks the known ones again after changes()
+struct ModuleInfo {
+	std::string path; // of the exe or dll, the pdb is looked for next to it
+	uintptr_t base;
+	size_t size;
+};
+
+class ModuleMapProvider {
+protected:
+	// bump whenever modules were loaded or unloaded, so resolvers drop unloaded modules and retry addresses that were in none
+	std::atomic<u32> change_count = 0;
+public:
+	virtual ~ModuleMapProvider () {}
+
+	// The module addr is in, false if there is none
+	// Called with the resolver's lock held, so it should not call back into the resolver
+	virtual bool find_module (uintptr_t addr, ModuleInfo* out) = 0;
+
+	u32 changes () const { return change_count.load(std::memory_order_acquire); }
+
+	// SizeOfImage from the PE header of the file at path, 0 if it can't be read
+	// for load events that only come with the base address, like LOAD_DLL_DEBUG_EVENT
+	static size_t pe_image_size (std::string const& path) {
+		std::ifstream ifs(path, std::ios::binary);
+		char header[4096];
+		if (!ifs.read(header, sizeof(header)) && ifs.gcount() < 0x40)
+			return 0;
+		size_t len = (size_t)ifs.gcount();
+
+		u32 e_lfanew;
+		memcpy(&e_lfanew, header + 0x3C, sizeof(u32));
+		// "PE\0\0", 20 byte COFF header, then SizeOfImage is at the same offset in the PE32 and PE32+ optional header
+		size_t size_of_image = (size_t)e_lfanew + 4 + 20 + 56;
+		if (header[0] != 'M' || header[1] != 'Z' || size_of_image + sizeof(u32) > len || memcmp(header + e_lfanew, "PE\0\0", 4) != 0)
+			return 0;
+
+		u32 size;
+		memcpy(&size, header + size_of_image, sizeof(u32));
+		return size;
+	}
+};
+
+// Fed with load and unload events (from a debugger loop, ETW or a trace), lookups are a binary search in memory
+// Can also be read from and written to a file of "<path> <base> <size>" lines (hex, # starts a comment), the table PdbSymbolize takes,
+// so a module map captured on one machine can be used to resolve addresses on another one
+class ModuleMap : public ModuleMapProvider {
+	mutable std::mutex mutex;
+	std::vector<ModuleInfo> sorted; // by base, never overlapping
+
+	static bool parse_hex (std::string_view str, u64* out) {
+		std::string s(str);
+		char* end = nullptr;
+		*out = strtoull(s.c_str(), &end, 16);
+		return !s.empty() && *end == '\0';
+	}
+public:
+	// size 0 reads it from the PE header of the file
+	// A module overlapping ones we have replaces them, we must have missed their unload
+	bool load (std::string path, uintptr_t base, size_t size = 0) {
+		if (size == 0)
+			size = pe_image_size(path);
+		if (size == 0)
+			return false;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		auto first = std::lower_bound(sorted.begin(), sorted.end(), base, [] (ModuleInfo const& m, uintptr_t base) {
+			return m.base + m.size <= base;
+		});
+		auto last = first;
+		while (last != sorted.end() && last->base < base + size)
+			++last;
+		first = sorted.erase(first, last);
+		sorted.insert(first, { std::move(path), base, size });
+		change_count++;
+		return true;
+	}
+	void unload (uintptr_t base) {
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = std::lower_bound(sorted.begin(), sorted.end(), base, [] (ModuleInfo const& m, uintptr_t base) {
+			return m.base < base;
+		});
+		if (it != sorted.end() && it->base == base) {
+			sorted.erase(it);
+			change_count++;
+		}
+	}
+
+	bool find_module (uintptr_t addr, ModuleInfo* out) override {
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = std::upper_bound(sorted.begin(), sorted.end(), addr, [] (uintptr_t addr, ModuleInfo const& m) {
+			return addr < m.base;
+		});
+		if (it == sorted.begin() || addr - (it-1)->base >= (it-1)->size)
+			return false;
+		*out = *(it-1);
+		return true;
+	}
+
+	// in address order
+	std::vector<ModuleInfo> get_modules () const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return sorted;
+	}
+
+	// Adds the modules in the file, prints the first bad line and returns false on errors
+	bool load_file (std::string const& filepath) {
+		std::ifstream ifs(filepath);
+		if (!ifs) {
+			fprintf(stderr, "Could not open module table %s\n", filepath.c_str());
+			return false;
+		}
+		std::string line;
+		for (int lineno=1; std::getline(ifs, line); lineno++) {
+			auto comment = line.find('#');
+			if (comment != std::string::npos) line.resize(comment);
+			while (!line.empty() && isspace((unsigned char)line.back())) line.pop_back();
+			if (line.empty())
+				continue;
+
+			// path can contain spaces, base and size are the last two fields
+			auto size_sep = line.find_last_of(" \t");
+			auto base_end = size_sep == std::string::npos ? std::string::npos : line.find_last_not_of(" \t", size_sep);
+			auto base_sep = base_end == std::string::npos ? std::string::npos : line.find_last_of(" \t", base_end);
+			auto path_end = base_sep == std::string::npos ? std::string::npos : line.find_last_not_of(" \t", base_sep);
+			u64 base, size;
+			if (path_end == std::string::npos
+				|| !parse_hex(std::string_view(line).substr(size_sep+1), &size)
+				|| !parse_hex(std::string_view(line).substr(base_sep+1, base_end - base_sep), &base)
+				|| !load(line.substr(0, path_end+1), (uintptr_t)base, (size_t)size)) {
+				fprintf(stderr, "%s:%d: expected <path> <base> <size>\n", filepath.c_str(), lineno);
+				return false;
+			}
+		}
+		return true;
+	}
+	bool save_file (std::string const& filepath) const {
+		FILE* f = fopen(filepath.c_str(), "w");
+		if (!f)
+			return false;
+		fprintf(f, "# <path> <base> <size>\n");
+		for (auto& m : get_modules())
+			fprintf(f, "%s %llx %llx\n", m.path.c_str(), (unsigned long long)m.base, (unsigned long long)m.size);
+		return fclose(f) == 0;
+	}
+};
+
+#if defined(_WIN32)
+#pragma comment(lib, "Kernel32.lib")
+
+// The modules of a live process, enumerated with EnumProcessModules
+// A miss enumerates all of them and keeps them, so only addresses outside of every module known so far cost syscalls,
+// which still happens on every address that is in no module at all
+class ProcessModuleMap : public ModuleMapProvider {
+	HANDLE process;
+	std::mutex mutex;
+	std::vector<ModuleInfo> sorted;
+
+	static const ModuleInfo* find_in (std::vector<ModuleInfo> const& sorted, uintptr_t addr) {
+		auto it = std::upper_bound(sorted.begin(), sorted.end(), addr, [] (uintptr_t addr, ModuleInfo const& m) {
+			return addr < m.base;
+		});
+		if (it == sorted.begin() || addr - (it-1)->base >= (it-1)->size)
+			return nullptr;
+		return &*(it-1);
+	}
+
+	// If the process can't be enumerated (it exited for example) the modules found before are kept and the miss stays a miss
+	void enumerate () {
+		std::vector<HMODULE> modules(1024);
+		for (;;) {
+			DWORD size = (DWORD)(modules.size() * sizeof(HMODULE));
+			DWORD needed = 0;
+			if (!EnumProcessModules(process, modules.data(), size, &needed)) {
+				print_err("EnumProcessModules");
+				return;
+			}
+			modules.resize(needed / sizeof(HMODULE));
+			if (needed <= size)
+				break;
+			// more modules than fit, the list is cut off, so again with room for all of them (more could have been loaded meanwhile)
+		}
+
+		std::vector<ModuleInfo> found;
+		for (size_t i=0; i<modules.size(); i++) {
+			MODULEINFO info = {};
+			char name[1024];
+			if (!GetModuleInformation(process, modules[i], &info, sizeof(info)))
+				continue;
+			auto nameLength = GetModuleFileNameExA(process, modules[i], name, sizeof(name));
+			if (nameLength > 0)
+				found.push_back({ std::string(name, nameLength), (uintptr_t)info.lpBaseOfDll, (size_t)info.SizeOfImage });
+		}
+		std::sort(found.begin(), found.end(), [] (ModuleInfo const& l, ModuleInfo const& r) { return l.base < r.base; });
+
+		bool changed = found.size() != sorted.size();
+		for (size_t i=0; !changed && i<found.size(); i++)
+			changed = found[i].base != sorted[i].base || found[i].path != sorted[i].path;
+		if (changed)
+			change_count++;
+		sorted = std::move(found);
+	}
+public:
+	ProcessModuleMap (HANDLE process): process{process} {}
+
+	bool find_module (uintptr_t addr, ModuleInfo* out) override {
+		std::lock_guard<std::mutex> lock(mutex);
+		auto* m = find_in(sorted, addr);
+		if (!m) {
+			enumerate();
+			m = find_in(sorted, addr);
+		}
+		if (!m)
+			return false;
+		*out = *m;
+		return true;
+	}
+};
+#endif
@@ -0,0 +1,3029 @@
+#pragma once
+#include "util.hpp"
+#include "thread_pool.hpp"
+#include "index_cache.hpp"
+#include "search_layout.hpp"
+
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include <queue>
+
+typedef uint8_t u8;
+typedef int16_t s16;
+typedef uint16_t u16;
+typedef int32_t s32;
+typedef uint32_t u32;
+typedef int64_t s64;
+typedef uint64_t u64;
+
+// cvinfo.h uses long for 32 bit fields, which is 64 bit outside of windows
+typedef uint32_t        CV_uoff32_t;
+typedef int32_t         CV_off32_t;
+typedef unsigned short  CV_uoff16_t;
+typedef          short  CV_off16_t;
+typedef unsigned short  CV_typ16_t;
+typedef uint32_t        CV_typ_t;
+typedef uint32_t        CV_pubsymflag_t;    // must be same as CV_typ_t.
+typedef unsigned short  _2BYTEPAD;
+typedef uint32_t        CV_tkn_t;
+
+typedef enum SYM_ENUM_e : u16 {
+    S_COMPILE       =  0x0001,  // Compile flags symbol
+    S_REGISTER_16t  =  0x0002,  // Register variable
+    S_CONSTANT_16t  =  0x0003,  // constant symbol
+    S_UDT_16t       =  0x0004,  // User defined type
+    S_SSEARCH       =  0x0005,  // Start Search
+    S_END           =  0x0006,  // Block, procedure, "with" or thunk end
+    S_SKIP          =  0x0007,  // Reserve symbol space in $$Symbols table
+    S_CVRESERVE     =  0x0008,  // Reserved symbol for CV internal use
+    S_OBJNAME_ST    =  0x0009,  // path to object file name
+    S_ENDARG        =  0x000a,  // end of argument/return list
+    S_COBOLUDT_16t  =  0x000b,  // special UDT for cobol that does not symbol pack
+    S_MANYREG_16t   =  0x000c,  // multiple register variable
+    S_RETURN        =  0x000d,  // return description symbol
+    S_ENTRYTHIS     =  0x000e,  // description of this pointer on entry
+
+    S_BPREL16       =  0x0100,  // BP-relative
+    S_LDATA16       =  0x0101,  // Module-local symbol
+    S_GDATA16       =  0x0102,  // Global data symbol
+    S_PUB16         =  0x0103,  // a public symbol
+    S_LPROC16       =  0x0104,  // Local procedure start
+    S_GPROC16       =  0x0105,  // Global procedure start
+    S_THUNK16       =  0x0106,  // Thunk Start
+    S_BLOCK16       =  0x0107,  // block start
+    S_WITH16        =  0x0108,  // with start
+    S_LABEL16       =  0x0109,  // code label
+    S_CEXMODEL16    =  0x010a,  // change execution model
+    S_VFTABLE16     =  0x010b,  // address of virtual function table
+    S_REGREL16      =  0x010c,  // register relative address
+
+    S_BPREL32_16t   =  0x0200,  // BP-relative
+    S_LDATA32_16t   =  0x0201,  // Module-local symbol
+    S_GDATA32_16t   =  0x0202,  // Global data symbol
+    S_PUB32_16t     =  0x0203,  // a public symbol (CV internal reserved)
+    S_LPROC32_16t   =  0x0204,  // Local procedure start
+    S_GPROC32_16t   =  0x0205,  // Global procedure start
+    S_THUNK32_ST    =  0x0206,  // Thunk Start
+    S_BLOCK32_ST    =  0x0207,  // block start
+    S_WITH32_ST     =  0x0208,  // with start
+    S_LABEL32_ST    =  0x0209,  // code label
+    S_CEXMODEL32    =  0x020a,  // change execution model
+    S_VFTABLE32_16t =  0x020b,  // address of virtual function table
+    S_REGREL32_16t  =  0x020c,  // register relative address
+    S_LTHREAD32_16t =  0x020d,  // local thread storage
+    S_GTHREAD32_16t =  0x020e,  // global thread storage
+    S_SLINK32       =  0x020f,  // static link for MIPS EH implementation
+
+    S_LPROCMIPS_16t =  0x0300,  // Local procedure start
+    S_GPROCMIPS_16t =  0x0301,  // Global procedure start
+
+    // if these ref symbols have names following then the names are in ST format
+    S_PROCREF_ST    =  0x0400,  // Reference to a procedure
+    S_DATAREF_ST    =  0x0401,  // Reference to data
+    S_ALIGN         =  0x0402,  // Used for page alignment of symbols
+
+    S_LPROCREF_ST   =  0x0403,  // Local Reference to a procedure
+    S_OEM           =  0x0404,  // OEM defined symbol
+
+    // sym records with 32-bit types embedded instead of 16-bit
+    // all have 0x1000 bit set for easy identification
+    // only do the 32-bit target versions since we don't really
+    // care about 16-bit ones anymore.
+    S_TI16_MAX          =  0x1000,
+
+    S_REGISTER_ST   =  0x1001,  // Register variable
+    S_CONSTANT_ST   =  0x1002,  // constant symbol
+    S_UDT_ST        =  0x1003,  // User defined type
+    S_COBOLUDT_ST   =  0x1004,  // special UDT for cobol that does not symbol pack
+    S_MANYREG_ST    =  0x1005,  // multiple register variable
+    S_BPREL32_ST    =  0x1006,  // BP-relative
+    S_LDATA32_ST    =  0x1007,  // Module-local symbol
+    S_GDATA32_ST    =  0x1008,  // Global data symbol
+    S_PUB32_ST      =  0x1009,  // a public symbol (CV internal reserved)
+    S_LPROC32_ST    =  0x100a,  // Local procedure start
+    S_GPROC32_ST    =  0x100b,  // Global procedure start
+    S_VFTABLE32     =  0x100c,  // address of virtual function table
+    S_REGREL32_ST   =  0x100d,  // register relative address
+    S_LTHREAD32_ST  =  0x100e,  // local thread storage
+    S_GTHREAD32_ST  =  0x100f,  // global thread storage
+
+    S_LPROCMIPS_ST  =  0x1010,  // Local procedure start
+    S_GPROCMIPS_ST  =  0x1011,  // Global procedure start
+
+    S_FRAMEPROC     =  0x1012,  // extra frame and proc information
+    S_COMPILE2_ST   =  0x1013,  // extended compile flags and info
+
+    // new symbols necessary for 16-bit enumerates of IA64 registers
+    // and IA64 specific symbols
+
+    S_MANYREG2_ST   =  0x1014,  // multiple register variable
+    S_LPROCIA64_ST  =  0x1015,  // Local procedure start (IA64)
+    S_GPROCIA64_ST  =  0x1016,  // Global procedure start (IA64)
+
+    // Local symbols for IL
+    S_LOCALSLOT_ST  =  0x1017,  // local IL sym with field for local slot index
+    S_PARAMSLOT_ST  =  0x1018,  // local IL sym with field for parameter slot index
+
+    S_ANNOTATION    =  0x1019,  // Annotation string literals
+
+    // symbols to support managed code debugging
+    S_GMANPROC_ST   =  0x101a,  // Global proc
+    S_LMANPROC_ST   =  0x101b,  // Local proc
+    S_RESERVED1     =  0x101c,  // reserved
+    S_RESERVED2     =  0x101d,  // reserved
+    S_RESERVED3     =  0x101e,  // reserved
+    S_RESERVED4     =  0x101f,  // reserved
+    S_LMANDATA_ST   =  0x1020,
+    S_GMANDATA_ST   =  0x1021,
+    S_MANFRAMEREL_ST=  0x1022,
+    S_MANREGISTER_ST=  0x1023,
+    S_MANSLOT_ST    =  0x1024,
+    S_MANMANYREG_ST =  0x1025,
+    S_MANREGREL_ST  =  0x1026,
+    S_MANMANYREG2_ST=  0x1027,
+    S_MANTYPREF     =  0x1028,  // Index for type referenced by name from metadata
+    S_UNAMESPACE_ST =  0x1029,  // Using namespace
+
+    // Symbols w/ SZ name fields. All name fields contain utf8 encoded strings.
+    S_ST_MAX        =  0x1100,  // starting point for SZ name symbols
+
+    S_OBJNAME       =  0x1101,  // path to object file name
+    S_THUNK32       =  0x1102,  // Thunk Start
+    S_BLOCK32       =  0x1103,  // block start
+    S_WITH32        =  0x1104,  // with start
+    S_LABEL32       =  0x1105,  // code label
+    S_REGISTER      =  0x1106,  // Register variable
+    S_CONSTANT      =  0x1107,  // constant symbol
+    S_UDT           =  0x1108,  // User defined type
+    S_COBOLUDT      =  0x1109,  // special UDT for cobol that does not symbol pack
+    S_MANYREG       =  0x110a,  // multiple register variable
+    S_BPREL32       =  0x110b,  // BP-relative
+    S_LDATA32       =  0x110c,  // Module-local symbol
+    S_GDATA32       =  0x110d,  // Global data symbol
+    S_PUB32         =  0x110e,  // a public symbol (CV internal reserved)
+    S_LPROC32       =  0x110f,  // Local procedure start
+    S_GPROC32       =  0x1110,  // Global procedure start
+    S_REGREL32      =  0x1111,  // register relative address
+    S_LTHREAD32     =  0x1112,  // local thread storage
+    S_GTHREAD32     =  0x1113,  // global thread storage
+
+    S_LPROCMIPS     =  0x1114,  // Local procedure start
+    S_GPROCMIPS     =  0x1115,  // Global procedure start
+    S_COMPILE2      =  0x1116,  // extended compile flags and info
+    S_MANYREG2      =  0x1117,  // multiple register variable
+    S_LPROCIA64     =  0x1118,  // Local procedure start (IA64)
+    S_GPROCIA64     =  0x1119,  // Global procedure start (IA64)
+    S_LOCALSLOT     =  0x111a,  // local IL sym with field for local slot index
+    S_SLOT          = S_LOCALSLOT,  // alias for LOCALSLOT
+    S_PARAMSLOT     =  0x111b,  // local IL sym with field for parameter slot index
+
+    // symbols to support managed code debugging
+    S_LMANDATA      =  0x111c,
+    S_GMANDATA      =  0x111d,
+    S_MANFRAMEREL   =  0x111e,
+    S_MANREGISTER   =  0x111f,
+    S_MANSLOT       =  0x1120,
+    S_MANMANYREG    =  0x1121,
+    S_MANREGREL     =  0x1122,
+    S_MANMANYREG2   =  0x1123,
+    S_UNAMESPACE    =  0x1124,  // Using namespace
+
+    // ref symbols with name fields
+    S_PROCREF       =  0x1125,  // Reference to a procedure
+    S_DATAREF       =  0x1126,  // Reference to data
+    S_LPROCREF      =  0x1127,  // Local Reference to a procedure
+    S_ANNOTATIONREF =  0x1128,  // Reference to an S_ANNOTATION symbol
+    S_TOKENREF      =  0x1129,  // Reference to one of the many MANPROCSYM's
+
+    // continuation of managed symbols
+    S_GMANPROC      =  0x112a,  // Global proc
+    S_LMANPROC      =  0x112b,  // Local proc
+
+    // short, light-weight thunks
+    S_TRAMPOLINE    =  0x112c,  // trampoline thunks
+    S_MANCONSTANT   =  0x112d,  // constants with metadata type info
+
+    // native attributed local/parms
+    S_ATTR_FRAMEREL =  0x112e,  // relative to virtual frame ptr
+    S_ATTR_REGISTER =  0x112f,  // stored in a register
+    S_ATTR_REGREL   =  0x1130,  // relative to register (alternate frame ptr)
+    S_ATTR_MANYREG  =  0x1131,  // stored in >1 register
+
+    // Separated code (from the compiler) support
+    S_SEPCODE       =  0x1132,
+
+    S_LOCAL_2005    =  0x1133,  // defines a local symbol in optimized code
+    S_DEFRANGE_2005 =  0x1134,  // defines a single range of addresses in which symbol can be evaluated
+    S_DEFRANGE2_2005 =  0x1135,  // defines ranges of addresses in which symbol can be evaluated
+
+    S_SECTION       =  0x1136,  // A COFF section in a PE executable
+    S_COFFGROUP     =  0x1137,  // A COFF group
+    S_EXPORT        =  0x1138,  // A export
+
+    S_CALLSITEINFO  =  0x1139,  // Indirect call site information
+    S_FRAMECOOKIE   =  0x113a,  // Security cookie information
+
+    S_DISCARDED     =  0x113b,  // Discarded by LINK /OPT:REF (experimental, see richards)
+
+    S_COMPILE3      =  0x113c,  // Replacement for S_COMPILE2
+    S_ENVBLOCK      =  0x113d,  // Environment block split off from S_COMPILE2
+
+    S_LOCAL         =  0x113e,  // defines a local symbol in optimized code
+    S_DEFRANGE      =  0x113f,  // defines a single range of addresses in which symbol can be evaluated
+    S_DEFRANGE_SUBFIELD =  0x1140,           // ranges for a subfield
+
+    S_DEFRANGE_REGISTER =  0x1141,           // ranges for en-registered symbol
+    S_DEFRANGE_FRAMEPOINTER_REL =  0x1142,   // range for stack symbol.
+    S_DEFRANGE_SUBFIELD_REGISTER =  0x1143,  // ranges for en-registered field of symbol
+    S_DEFRANGE_FRAMEPOINTER_REL_FULL_SCOPE =  0x1144, // range for stack symbol span valid full scope of function body, gap might apply.
+    S_DEFRANGE_REGISTER_REL =  0x1145, // range for symbol address as register + offset.
+
+    // S_PROC symbols that reference ID instead of type
+    S_LPROC32_ID     =  0x1146,
+    S_GPROC32_ID     =  0x1147,
+    S_LPROCMIPS_ID   =  0x1148,
+    S_GPROCMIPS_ID   =  0x1149,
+    S_LPROCIA64_ID   =  0x114a,
+    S_GPROCIA64_ID   =  0x114b,
+
+    S_BUILDINFO      = 0x114c, // build information.
+    S_INLINESITE     = 0x114d, // inlined function callsite.
+    S_INLINESITE_END = 0x114e,
+    S_PROC_ID_END    = 0x114f,
+
+    S_DEFRANGE_HLSL  = 0x1150,
+    S_GDATA_HLSL     = 0x1151,
+    S_LDATA_HLSL     = 0x1152,
+
+    S_FILESTATIC     = 0x1153,
+
+#if defined(CC_DP_CXX) && CC_DP_CXX
+
+    S_LOCAL_DPC_GROUPSHARED = 0x1154, // DPC groupshared variable
+    S_LPROC32_DPC = 0x1155, // DPC local procedure start
+    S_LPROC32_DPC_ID =  0x1156,
+    S_DEFRANGE_DPC_PTR_TAG =  0x1157, // DPC pointer tag definition range
+    S_DPC_SYM_TAG_MAP = 0x1158, // DPC pointer tag value to symbol record map
+
+#endif // CC_DP_CXX
+    
+    S_ARMSWITCHTABLE  = 0x1159,
+    S_CALLEES = 0x115a,
+    S_CALLERS = 0x115b,
+    S_POGODATA = 0x115c,
+    S_INLINESITE2 = 0x115d,      // extended inline site information
+
+    S_HEAPALLOCSITE = 0x115e,    // heap allocation site
+
+    S_MOD_TYPEREF = 0x115f,      // only generated at link time
+
+    S_REF_MINIPDB = 0x1160,      // only generated at link time for mini PDB
+    S_PDBMAP      = 0x1161,      // only generated at link time for mini PDB
+
+    S_GDATA_HLSL32 = 0x1162,
+    S_LDATA_HLSL32 = 0x1163,
+
+    S_GDATA_HLSL32_EX = 0x1164,
+    S_LDATA_HLSL32_EX = 0x1165,
+
+    S_RECTYPE_MAX,               // one greater than last
+    S_RECTYPE_LAST  = S_RECTYPE_MAX - 1,
+    S_RECTYPE_PAD   = S_RECTYPE_MAX + 0x100 // Used *only* to verify symbol record types so that current PDB code can potentially read
+                                // future PDBs (assuming no format change, etc).
+
+} SYM_ENUM_e;
+
+
+typedef struct CV_PROCFLAGS {
+    union {
+        unsigned char   bAll;
+        unsigned char   grfAll;
+        struct {
+            unsigned char CV_PFLAG_NOFPO     :1; // frame pointer present
+            unsigned char CV_PFLAG_INT       :1; // interrupt return
+            unsigned char CV_PFLAG_FAR       :1; // far return
+            unsigned char CV_PFLAG_NEVER     :1; // function does not return
+            unsigned char CV_PFLAG_NOTREACHED:1; // label isn't fallen into
+            unsigned char CV_PFLAG_CUST_CALL :1; // custom calling convention
+            unsigned char CV_PFLAG_NOINLINE  :1; // function marked as noinline
+            unsigned char CV_PFLAG_OPTDBGINFO:1; // function has debug information for optimized code
+        };
+    };
+} CV_PROCFLAGS;
+typedef union CV_PUBSYMFLAGS {
+    CV_pubsymflag_t grfFlags;
+    struct {
+        CV_pubsymflag_t fCode       :  1;    // set if public symbol refers to a code address
+        CV_pubsymflag_t fFunction   :  1;    // set if public symbol is a function
+        CV_pubsymflag_t fManaged    :  1;    // set if managed code (native or IL)
+        CV_pubsymflag_t fMSIL       :  1;    // set if managed IL code
+        CV_pubsymflag_t __unused    : 28;    // must be zero
+    };
+} CV_PUBSYMFLAGS;
+
+typedef struct PROCSYM32 {
+    unsigned short  reclen;     // Record length
+    unsigned short  rectyp;     // S_GPROC32, S_LPROC32, S_GPROC32_ID, S_LPROC32_ID, S_LPROC32_DPC or S_LPROC32_DPC_ID
+    uint32_t        pParent;    // pointer to the parent
+    uint32_t        pEnd;       // pointer to this blocks end
+    uint32_t        pNext;      // pointer to next symbol
+    uint32_t        len;        // Proc length
+    uint32_t        DbgStart;   // Debug start offset
+    uint32_t        DbgEnd;     // Debug end offset
+    CV_typ_t        typind;     // Type index or ID
+    CV_uoff32_t     off;
+    unsigned short  seg;
+    CV_PROCFLAGS    flags;      // Proc flags
+    unsigned char   name[1];    // Length-prefixed name
+} PROCSYM32;
+typedef uint32_t CV_ItemId;
+typedef struct INLINESITESYM {
+    unsigned short  reclen;     // Record length
+    unsigned short  rectyp;     // S_INLINESITE
+    uint32_t        pParent;    // pointer to the inliner
+    uint32_t        pEnd;       // pointer to this block's end
+    CV_ItemId       inlinee;    // CV_ItemId of inlinee
+    unsigned char   binaryAnnotations[1];   // an array of compressed binary annotations.
+} INLINESITESYM;
+typedef struct INLINESITESYM2 {
+    unsigned short  reclen;         // Record length
+    unsigned short  rectyp;         // S_INLINESITE2
+    uint32_t        pParent;        // pointer to the inliner
+    uint32_t        pEnd;           // pointer to this block's end
+    CV_ItemId       inlinee;        // CV_ItemId of inlinee
+    uint32_t        invocations;    // entry count
+    unsigned char   binaryAnnotations[1];   // an array of compressed binary annotations.
+} INLINESITESYM2;
+enum BinaryAnnotationOpcode : u32 {
+    BA_OP_Invalid,               // link time pdb contains PADDINGs
+    BA_OP_CodeOffset,            // param : start offset
+    BA_OP_ChangeCodeOffsetBase,  // param : nth separated code chunk (main code chunk == 0)
+    BA_OP_ChangeCodeOffset,      // param : delta of offset
+    BA_OP_ChangeCodeLength,      // param : length of code, default next start
+    BA_OP_ChangeFile,            // param : fileId
+    BA_OP_ChangeLineOffset,      // param : line offset (signed)
+    BA_OP_ChangeLineEndDelta,    // param : how many lines, default 1
+    BA_OP_ChangeRangeKind,       // param : either 1 (default, for statement) or 0 (for expression)
+    BA_OP_ChangeColumnStart,     // param : start column number, 0 means no column info
+    BA_OP_ChangeColumnEndDelta,  // param : end column number delta (signed)
+    BA_OP_ChangeCodeOffsetAndLineOffset,  // param : ((sourceDelta << 4) | CodeDelta)
+    BA_OP_ChangeCodeLengthAndCodeOffset,  // param : codeLength, codeOffset
+    BA_OP_ChangeColumnEnd,       // param : end column number
+};
+typedef struct REFSYM2 {
+    unsigned short  reclen;     // Record length
+    unsigned short  rectyp;     // S_PROCREF, S_DATAREF, or S_LPROCREF
+    uint32_t        sumName;    // SUC of the name
+    uint32_t        ibSym;      // Offset of actual symbol in $$Symbols
+    unsigned short  imod;       // Module containing the actual symbol
+    unsigned char   name[1];    // hidden name made a first class member
+} REFSYM2;
+typedef struct CONSTSYM {
+    unsigned short  reclen;     // Record length
+    unsigned short  rectyp;     // S_CONSTANT or S_MANCONSTANT
+    CV_typ_t        typind;     // Type index (containing enum if enumerate) or metadata token
+    unsigned short  value;      // numeric leaf containing value
+    unsigned char   name[1];     // Length-prefixed name
+} CONSTSYM;
+typedef struct UDTSYM {
+    unsigned short  reclen;     // Record length
+    unsigned short  rectyp;     // S_UDT | S_COBOLUDT
+    CV_typ_t        typind;     // Type index
+    unsigned char   name[1];    // Length-prefixed name
+} UDTSYM;
+typedef struct DATASYM32 {
+    unsigned short  reclen;     // Record length
+    unsigned short  rectyp;     // S_LDATA32, S_GDATA32, S_LMANDATA, S_GMANDATA
+    CV_typ_t        typind;     // Type index, or Metadata token if a managed symbol
+    CV_uoff32_t     off;
+    unsigned short  seg;
+    unsigned char   name[1];    // Length-prefixed name
+} DATASYM32;
+typedef struct PUBSYM32 {
+    unsigned short  reclen;     // Record length
+    unsigned short  rectyp;     // S_PUB32
+    CV_PUBSYMFLAGS  pubsymflags;
+    CV_uoff32_t     off;
+    unsigned short  seg;
+    unsigned char   name[1];    // Length-prefixed name
+} PUBSYM32;
+
+#if !defined(_WIN32)
+typedef struct _GUID {
+	uint32_t Data1;
+	uint16_t Data2;
+	uint16_t Data3;
+	uint8_t  Data4[8];
+} GUID;
+#endif
+
+// Same layout as IMAGE_SECTION_HEADER, which is what the section header dump stream contains
+struct pe_section_header{
+	u8  name[8];
+	u32 virtual_size;
+	u32 virtual_address;
+	u32 size_of_raw_data;
+	u32 pointer_to_raw_data;
+	u32 pointer_to_relocations;
+	u32 pointer_to_linenumbers;
+	u16 number_of_relocations;
+	u16 number_of_linenumbers;
+	u32 characteristics;
+};
+
+// https://github.com/PascalBeyer/PDB-Documentation/?tab=readme-ov-file
+struct msf_header{
+	u8  signature[32];
+	u32 page_size;
+	u32 active_free_page_map;
+	u32 amount_of_pages;
+	u32 stream_table_stream_size;
+	u32 unused;
+	u32 page_list_of_stream_table_stream_page_list[1];
+};
+	
+struct pdb_information_stream_header{
+	u32 version;
+	u32 timestamp;
+	u32 age;
+	GUID guid;
+};
+
+// TPI and IPI stream have the same layout
+struct tpi_stream_header{
+	u32 version;
+	u32 header_size;
+	u32 type_index_begin;
+	u32 type_index_end;
+	u32 type_record_bytes;
+
+	u16 hash_stream_index;
+	u16 hash_aux_stream_index;
+	u32 hash_key_size;
+	u32 number_of_hash_buckets;
+
+	u32 hash_value_buffer_offset;
+	u32 hash_value_buffer_length;
+	u32 index_offset_buffer_offset;
+	u32 index_offset_buffer_length;
+	u32 hash_adj_buffer_offset;
+	u32 hash_adj_buffer_length;
+};
+enum LEAF_ENUM_e : u16 {
+	LF_FUNC_ID  = 0x1601, // global func ID
+	LF_MFUNC_ID = 0x1602, // member func ID
+};
+struct codeview_type_record_header{
+	u16 length; // not including this field
+	LEAF_ENUM_e kind;
+};
+// LF_FUNC_ID and LF_MFUNC_ID, the name is at the same place in both
+struct codeview_func_id{
+	u16 length;
+	LEAF_ENUM_e kind;
+	u32 scope_or_parent_type;
+	u32 type;
+	char name[1];
+};
+
+// Public symbol index stream (PSI), the header is followed by
+//  the GSI hash table (sym_hash_size bytes)
+//  the address map (addr_map_size bytes): u32 offsets of the S_PUB32 records in the symbol record stream, sorted by section and offset
+//  the thunk map and section map
+struct psi_stream_header{
+	u32 sym_hash_size;
+	u32 addr_map_size;
+	u32 number_of_thunks;
+	u32 size_of_thunk;
+	u16 thunk_table_section;
+	u16 padding;
+	u32 thunk_table_offset;
+	u32 number_of_sections;
+};
+
+// Name hash table, all of the GSI stream and the PSI stream after psi_stream_header:
+//  header, hash_records_size bytes of gsi_hash_record,
+//  a bitmap of the non-empty buckets (IPHR_HASH+1 bits, rounded up to 32)
+//  then a u32 per non-empty bucket with the offset of its first record, in units of 12 bytes (the in-memory record size of the 32 bit mspdb)
+constexpr u32 IPHR_HASH = 4096;
+constexpr u32 GSI_HASH_SIGNATURE = 0xffffffff;
+constexpr u32 GSI_HASH_VERSION = 0xeffe0000 + 19990810;
+constexpr u32 GSI_HASH_BUCKET_OFFSET_UNIT = 12;
+
+struct gsi_hash_header{
+	u32 version_signature;
+	u32 version;
+	u32 hash_records_size;
+	u32 buckets_size; // bitmap and bucket offsets
+};
+struct gsi_hash_record{
+	u32 offset; // of the symbol in the symbol record stream, plus 1
+	u32 cref;
+};
+
+// hashStringV1 (LHashPbCb in the microsoft-pdb sources), which the GSI and PSI buckets are hashed with
+// xor of the string as little-endian u32s, then folded, the 0x20 mask makes it mostly case insensitive
+inline u32 pdb_hash_string_v1 (std::string_view str) {
+	u32 res = 0;
+	size_t i = 0;
+	for (; i + 4 <= str.size(); i += 4) {
+		u32 val;
+		memcpy(&val, str.data() + i, sizeof(val));
+		res ^= val;
+	}
+	if (str.size() - i >= 2) {
+		u16 val;
+		memcpy(&val, str.data() + i, sizeof(val));
+		res ^= val;
+		i += 2;
+	}
+	if (str.size() - i == 1) {
+		res ^= (u8)str[i];
+	}
+	res |= 0x20202020;
+	res ^= res >> 11;
+	return res ^ (res >> 16);
+}
+
+struct dbi_stream_header{
+	u32 version_signature;
+	u32 version;
+	u32 age;
+	u16 stream_index_of_the_global_symbol_index_stream;
+	struct{
+		u16 minor_version : 8;
+		u16 major_version : 7;
+		u16 is_new_version_format : 1;
+	} toolchain_version;
+	u16 stream_index_of_the_public_symbol_index_stream;
+	u16 version_number_of_mspdb_dll_which_build_the_pdb;
+	u16 stream_index_of_the_symbol_record_stream;
+	u16 build_number_of_mspdb_dll_which_build_the_pdb;
+		
+	u32 byte_size_of_the_module_information_substream;   // substream 0
+	u32 byte_size_of_the_section_contribution_substream; // substream 1
+	u32 byte_size_of_the_section_map_substream;          // substream 2
+	u32 byte_size_of_the_source_information_substream;   // substream 3
+	u32 byte_size_of_the_type_server_map_substream;      // substream 4
+		
+	u32 index_of_the_MFC_type_server_in_type_server_map_substream;
+		
+	u32 byte_size_of_the_optional_debug_header_substream; // substream 6
+	u32 byte_size_of_the_edit_and_continue_substream;     // substream 5
+		
+	struct{
+		u16 was_linked_incrementally         : 1;
+		u16 private_symbols_were_stripped    : 1;
+		u16 the_pdb_allows_conflicting_types : 1; // undocumented /DEBUG:CTYPES flag.
+	} flags;
+		
+	u16 machine_type;
+	u32 reserved_padding;
+};
+
+struct pdb_section_contribution{
+	s16 section_id;
+	u16 padding1;
+	s32 offset;
+	s32 size;
+	u32 characteristics;
+	s16 module_index;
+	u16 padding2;
+	u32 data_crc;
+	u32 reloc_crc;
+};
+struct pdb_module_information{
+	u32 unused;
+	struct pdb_section_contribution first_code_contribution;
+		
+	struct{
+		u16 was_written : 1;
+		u16 edit_and_continue_enabled : 1;
+		u16 unused : 6;
+		u16 TSM_index : 8;
+	} flags;
+		
+	u16 stream_index_of_module_symbol_stream;
+		
+	u32 byte_size_of_symbol_information;
+	u32 byte_size_of_c11_line_information;
+	u32 byte_size_of_c13_line_information;
+		
+	u16 amount_of_source_files;
+	u16 padding;
+	u32 unused2;
+		
+	u32 edit_and_continue_source_file_string_index;
+	u32 edit_and_continue_pdb_file_string_index;
+		
+	//char module_name_and_file_name_and_padding[1];
+};
+
+struct pdb_section_map_stream_header{
+	u16 number_of_section_descriptors;
+	u16 number_of_logical_section_descriptors;
+};
+struct pdb_section_map_entry{
+	u16 flags;
+	u16 logical_overlay_number;
+	u16 group;
+	u16 frame;
+	u16 section_name;
+	u16 class_name;
+	u32 offset;
+	u32 section_size;
+};
+
+struct optional_debug_header_substream{
+	u16 stream_index_of_fpo_data;
+	u16 stream_index_of_exception_data;
+	u16 stream_index_of_fixup_data;
+	u16 stream_index_of_omap_to_src_data;
+	u16 stream_index_of_omap_from_src_data;
+	u16 stream_index_of_section_header_dump;
+	u16 stream_index_of_clr_token_to_clr_record_id;
+	u16 stream_index_of_xdata;
+	u16 stream_index_of_pdata;
+	u16 stream_index_of_new_fpo_data;
+	u16 stream_index_of_original_section_header_dump;
+};
+
+struct codeview_symbol_header{ // Also see SYMTYPE in cvinfo.h
+	u16 length;
+	//u16 kind;
+	SYM_ENUM_e kind;
+};
+
+enum DEBUG_S_SUBSECTION_TYPE : u32 {
+	DEBUG_S_IGNORE = 0x80000000,    // if this bit is set in a subsection type then ignore the subsection contents
+
+	DEBUG_S_SYMBOLS = 0xf1,
+	DEBUG_S_LINES,
+	DEBUG_S_STRINGTABLE,
+	DEBUG_S_FILECHKSMS,
+	DEBUG_S_FRAMEDATA,
+	DEBUG_S_INLINEELINES,
+	DEBUG_S_CROSSSCOPEIMPORTS,
+	DEBUG_S_CROSSSCOPEEXPORTS,
+
+	DEBUG_S_IL_LINES,
+	DEBUG_S_FUNC_MDTOKEN_MAP,
+	DEBUG_S_TYPE_MDTOKEN_MAP,
+	DEBUG_S_MERGED_ASSEMBLYINPUT,
+
+	DEBUG_S_COFF_SYMBOL_RVA,
+};
+struct codeview_subsection_header{
+	DEBUG_S_SUBSECTION_TYPE type;
+	u32 length;
+};
+struct codeview_file_checksum{
+	u32 offset_in_string_table;
+	u8  checksum_size;
+	u8  checksum_kind;
+	//u8  checksum[];
+};
+struct codeview_line_header{
+	u32 contribution_offset;
+	u16 contribution_section_id;
+	u16 flags;
+	u32 contribution_size;
+};
+struct codeview_line_block_header{
+	u32 offset_in_file_checksums;
+	u32 amount_of_lines; // codeview_line_block_header followed by codeview_line[amount_of_lines]
+	u32 block_size; // unsure what is is for, could be sizeof(codeview_line_block_header + codeview_line[])
+};
+struct codeview_inlinee_source_line{
+	CV_ItemId inlinee;
+	u32 offset_in_file_checksums;
+	u32 source_line_number;
+	// only with CV_INLINEE_SOURCE_LINE_SIGNATURE_EX: u32 count_of_extra_files, u32 extra_files[]
+};
+enum { CV_INLINEE_SOURCE_LINE_SIGNATURE = 0, CV_INLINEE_SOURCE_LINE_SIGNATURE_EX = 1 };
+struct codeview_line{
+	u32 offset;
+	u32 start_line_number     : 24;
+	u32 optional_delta_to_end : 7;
+	u32 is_a_statement        : 1;
+};
+
+struct SourceLoc {
+	const char* filepath;
+	u32         lineno;
+	u32         file; // /names offset of filepath, the same for every line in the file
+};
+
+// PDBs are assumed to be next to exe of the same name for the moment
+// PDBs of microsoft dlls are not gotten yet (which dbghelp.dll does somehow)
+
+class PDB_File {
+public:
+	struct Options {
+		// Map the file read-only instead of reading it into memory
+		// streams whose pages happen to be consecutive are then used in-place, only fragmented streams get copied
+		bool map_file = true;
+		// Only load and index a module's symbol stream the first time a lookup resolves into that module
+		bool lazy_modules = true;
+		// Threads used to load all modules when !lazy_modules, 1 loads on the calling thread, 0 uses all hardware threads
+		u32 load_threads = 1;
+		// Build the global RVA -> proc index while loading, this loads all modules, so it implies !lazy_modules
+		bool proc_index = false;
+		// Page table over the proc index with 1 << proc_page_bits byte pages (12 is 4 KB), so most lookups skip the binary search
+		// costs 4 bytes per page of the image, 0 disables it
+		u32 proc_page_bits = 0;
+		// Directory for the persistent index cache, empty disables it
+		// if a cache matching the PDB's GUID and age exists, the proc index and line tables are mapped from it instead of loading any module
+		// otherwise the index is built (like proc_index) and the cache is (re)written
+		std::string index_cache_dir;
+		// Stop after the info stream, enough for get_identity() to tell whether this PDB is loaded already
+		bool info_only = false;
+		// No progress messages on stdout, for tools that write their results there
+		bool quiet = false;
+	};
+
+	// What identifies a PDB (and the exe built with it), a rebuild changes the GUID, an incremental link bumps the age
+	struct Identity {
+		u8  guid[16];
+		u32 age;
+
+		bool operator< (Identity const& r) const {
+			int cmp = memcmp(guid, r.guid, sizeof(guid));
+			return cmp != 0 ? cmp < 0 : age < r.age;
+		}
+		bool operator== (Identity const& r) const {
+			return memcmp(guid, r.guid, sizeof(guid)) == 0 && age == r.age;
+		}
+	};
+	
+	// Stream contents as one consecutive block of memory
+	// either points directly into the mapped file or into a copy of the (fragmented) stream pages
+	class StreamData {
+		char* ptr = nullptr;
+		u32 len = 0;
+		std::vector<char> copy;
+		friend class PDB_File;
+	public:
+		StreamData () {}
+		StreamData (StreamData&&) = default;
+		StreamData& operator= (StreamData&&) = default;
+		StreamData (StreamData const&) = delete;
+		StreamData& operator= (StreamData const&) = delete;
+
+		char* data () const { return ptr; }
+		u32 size () const { return len; }
+		bool empty () const { return len == 0; }
+		bool is_copy () const { return !copy.empty(); }
+	};
+
+	// how many stream bytes we were able to use in-place vs had to copy
+	std::atomic<size_t> stream_bytes_in_place = 0;
+	std::atomic<size_t> stream_bytes_copied = 0;
+	// decoded tables built so far (module procs, line and inline tables, proc index)
+	std::atomic<size_t> table_bytes = 0;
+
+	// Heap memory held for lookups, grows as modules get loaded lazily
+	// Mapped PDB and index cache pages are not counted, the OS can drop those on its own
+	size_t memory_size () const {
+		return file_buffer.size() + stream_bytes_copied + table_bytes;
+	}
+
+private:
+	Options opt;
+
+	MappedFile mapped;
+	std::vector<char> file_buffer; // only used without Options::map_file
+
+	const char* file_data = nullptr;
+	size_t file_size = 0;
+	
+	void* get_page (u32 idx) {
+		assert((size_t)idx * header->page_size < file_size);
+		return (char*)file_data + (size_t)idx * header->page_size;
+	}
+	u32 ceil_div (u32 a, u32 b) {
+		return (a + (b-1)) / b;
+	}
+	char* align_up (char* ptr, u32 align) {
+		uintptr_t x = (uintptr_t)ptr;
+		return (char*)((x + align-1) / align * align);
+	}
+
+	void* read_sts (u32 ptr) {
+		u32 page_idx    = ptr / header->page_size;
+		u32 ptr_in_page = ptr % header->page_size;
+		
+		//u32 sts_num_pages = ceil_div(header->stream_table_stream_size, header->page_size);
+
+		u32 u32_per_page = header->page_size / sizeof(u32);
+		u32 page_idx_page     = page_idx / u32_per_page;
+		u32 page_idx_page_idx = page_idx % u32_per_page;
+
+		assert(page_idx_page == 0);
+		u32* sts_pages = (u32*)get_page(header->page_list_of_stream_table_stream_page_list[page_idx_page]);
+
+		return (char*)get_page(sts_pages[page_idx_page_idx]) + ptr_in_page;
+	}
+	
+	
+	msf_header* header;
+
+	struct Stream {
+		u32 size;
+		std::vector<u32> pages;
+	};
+	std::vector<Stream> streams;
+	
+	StreamData pdb_info_data;
+	StreamData names_data;
+	StreamData DBI_data;
+	StreamData section_header_dump_data;
+	StreamData IPI_data;
+	StreamData symbol_records_data;
+	StreamData PSI_data;
+	StreamData GSI_data;
+
+	pdb_information_stream_header* info;
+
+	std::unordered_map<std::string_view, u32> named_streams;
+
+	const char* names;
+	u32 names_size = 0;
+
+	optional_debug_header_substream* opt_streams;
+
+	//// Final needed data
+	struct Section {
+		std::string name;
+
+		uintptr_t base_addr;
+		size_t size;
+	};
+	std::vector<Section> sections_sorted;
+
+	u32 num_section_contributions = 0;
+	pdb_section_contribution* section_contributions = nullptr;
+
+	// set if the lookup data was mapped from the index cache, modules then have no mi, procsyms or symbol stream
+	IndexCacheReader index_cache;
+	bool from_index_cache = false;
+
+public:
+	// Wall time of the loading phases in the constructor, 0 for the ones that didn't run
+	struct LoadTimes {
+		float file_sec = 0;         // reading or mapping the file
+		float stream_table_sec = 0; // msf header, stream table and pdb info stream
+		float dbi_sec = 0;          // names, DBI with the section contribution index, section headers
+		float modules_sec = 0;      // module streams, plus the GSI/PSI headers on a full load
+		float index_sec = 0;        // proc index
+		float index_cache_sec = 0;  // mapping the index cache, or writing it after building the index
+	};
+private:
+	LoadTimes load_times;
+	
+	void* read_stream (u32 stream, u32 ptr) {
+		u32 page_idx    = ptr / header->page_size;
+		u32 ptr_in_page = ptr % header->page_size;
+
+		assert(stream < streams.size() && ptr < streams[stream].size);
+		return (char*)get_page(streams[stream].pages[page_idx]) + ptr_in_page;
+	}
+	std::vector<char> copy_into_consecutive (u32 streami) {
+		std::vector<char> data;
+
+		auto& stream = streams[streami];
+		data.resize(stream.size);
+
+		char* cur = data.data();
+		size_t remain = stream.size;
+		for (u32 pg : stream.pages) {
+			memcpy(cur, get_page(pg), (u32)std::min((size_t)header->page_size, remain));
+			remain -= header->page_size;
+			cur += header->page_size;
+		}
+
+		return data;
+	}
+	bool stream_is_consecutive (Stream const& stream) {
+		for (size_t i=1; i<stream.pages.size(); i++) {
+			if (stream.pages[i] != stream.pages[i-1] + 1)
+				return false;
+		}
+		return true;
+	}
+	StreamData get_stream (u32 streami) {
+		assert(streami < streams.size());
+		auto& stream = streams[streami];
+
+		StreamData res;
+		res.len = stream.size;
+		if (stream.size == 0)
+			return res;
+
+		if (opt.map_file && stream_is_consecutive(stream)) {
+			assert((size_t)stream.pages[0] * header->page_size + stream.size <= file_size);
+			res.ptr = (char*)get_page(stream.pages[0]);
+			stream_bytes_in_place += stream.size;
+		}
+		else {
+			res.copy = copy_into_consecutive(streami);
+			res.ptr = res.copy.data();
+			stream_bytes_copied += stream.size;
+		}
+		return res;
+	}
+	
+	void read_header () {
+		if (file_size < sizeof(msf_header))
+			throw std::runtime_error("Not a PDB file");
+		header = (msf_header*)file_data;
+		assert(strncmp((const char*)header->signature, "Microsoft C/C++ MSF 7.00\r\n\032DS\0\0\0", 32) == 0);
+	}
+	void read_stream_table () {
+
+		u32* _sts_ppages = (u32*)get_page(header->page_list_of_stream_table_stream_page_list[0]);
+		u32* _sts_pages = (u32*)get_page(_sts_ppages[0]);
+		char* _sts_start = (char*)read_sts(0);
+
+		u32 cur = 0;
+		u32 amount_of_streams = *(u32*)read_sts(cur);
+		cur += sizeof(u32);
+		
+		while (streams.size() < amount_of_streams) {
+			u32 stream_size = *(u32*)read_sts(cur);
+			cur += sizeof(u32);
+
+			// The assumtion that deleted streams don't count seems to be wrong due to crash and seems to be verified by looking at data
+			//if (stream_size == 0xffffffff) {
+			//	// I think, this deleted stream does not count for amount_of_streams, but the link above is not clear on this
+			//	continue;
+			//}
+			if (stream_size == 0xffffffff) {
+				stream_size = 0;
+			}
+		
+			Stream s;
+			s.size = stream_size;
+			streams.push_back(s);
+		}
+		
+		for (u32 si=0; si<streams.size(); si++) {
+			auto& stream = streams[si];
+			//printf("Stream %3d: { ", si);
+		
+			u32 num_pages = ceil_div(stream.size, header->page_size);
+			for (u32 i=0; i<num_pages; i++) {
+				u32 page_idx = *(u32*)read_sts(cur);
+				cur += sizeof(u32);
+		
+				stream.pages.push_back(page_idx);
+		
+				//printf("%d, ", page_idx);
+			}
+		
+			//printf("}\n");
+		}
+	}
+
+	void read_pdb_info () {
+		
+		pdb_info_data = get_stream(1);
+		char* ptr = pdb_info_data.data();
+
+		info = (pdb_information_stream_header*)ptr;
+		ptr += sizeof(pdb_information_stream_header);
+
+		// read named stream hashmap
+		u32 string_buffer_size = *(u32*)ptr;
+		ptr += sizeof(u32);
+
+		char* string_buffer = ptr;
+		ptr += string_buffer_size;
+
+		u32 amount_of_entries = *(u32*)ptr;
+		ptr += sizeof(u32);
+		u32 capacity = *(u32*)ptr;
+		ptr += sizeof(u32);
+		
+		// bit_array present_bits
+		u32 present_word_count = *(u32*)ptr;
+		ptr += sizeof(u32);
+		u32* present_bits = (u32*)ptr;
+		ptr += present_word_count * sizeof(u32);
+
+		// bit_array deleted_bits
+		u32 deleted_word_count = *(u32*)ptr;
+		ptr += sizeof(u32);
+		u32* deleted_bits = (u32*)ptr;
+		ptr += deleted_word_count * sizeof(u32);
+
+		struct KeyValue {
+			u32 key;
+			u32 value;
+		};
+		KeyValue* entries = (KeyValue*)ptr;
+		ptr += amount_of_entries * sizeof(KeyValue);
+
+		// unused
+		ptr += sizeof(u32);
+		
+		//printf("Named Streams:\n");
+		for(u32 index = 0, entry_index = 0; index < capacity && entry_index < amount_of_entries; index++){
+			u32 word_index = index / (sizeof(u32) * 8);
+			u32 bit_index  = index % (sizeof(u32) * 8);
+			
+			if(word_index < present_word_count && (present_bits[word_index] & (1u << bit_index))){
+				auto& kv = entries[entry_index++];
+
+				//std::string key = std::string(&string_buffer[kv.key]);
+				//printf("> %s: %d\n", key.c_str(), kv.value);
+				//named_streams[std::move(key)] = kv.value;
+				std::string key = std::string(&string_buffer[kv.key]);
+				//printf("> %s: %d\n", &string_buffer[kv.key], kv.value);
+				named_streams[std::string_view(&string_buffer[kv.key])] = kv.value;
+				continue;
+			}
+		}
+	}
+
+	void read_names () {
+		names_data = get_stream(named_streams["/names"]);
+		char* ptr = names_data.data();
+		
+		u32 signature = *(u32*)ptr;
+		ptr += sizeof(u32);
+		assert(signature == 0xEFFEEFFE);
+		
+		u32 hash_version = *(u32*)ptr;
+		ptr += sizeof(u32);
+		
+		u32 string_buffer_size = *(u32*)ptr;
+		ptr += sizeof(u32);
+		
+		names = ptr;
+		names_size = string_buffer_size;
+		ptr += string_buffer_size;
+		
+		u32 bucket_count = *(u32*)ptr;
+		ptr += sizeof(u32);
+
+		u32* buckets = (u32*)ptr;
+		ptr += bucket_count * sizeof(u32);
+
+		u32* amount_of_strings = (u32*)ptr;
+		ptr += sizeof(u32);
+	}
+	
+	void read_DBI () {
+		DBI_data = get_stream(3);
+		char* ptr = DBI_data.data();
+
+		auto* header = (dbi_stream_header*)ptr;
+		ptr += sizeof(dbi_stream_header);
+		
+		//// module_information_substream
+		auto* ptr2 = ptr;
+
+		// Module can't be moved because of its once_flag, so count them first
+		u32 num_modules = 0;
+		for (char* p = ptr; p < ptr2+header->byte_size_of_the_module_information_substream; num_modules++) {
+			p += sizeof(pdb_module_information);
+			p += strlen(p)+1; // module name
+			p += strlen(p)+1; // file name
+			p = align_up(p, 4);
+		}
+		assert(num_modules < 0xffff);
+		modules = std::vector<Module>(num_modules);
+
+		u32 module_index = 0;
+		while (ptr < ptr2+header->byte_size_of_the_module_information_substream) {
+			auto* mi = (pdb_module_information*)ptr;
+			ptr += sizeof(pdb_module_information);
+
+			const char* mod_name = ptr;
+			size_t mod_name_len = strlen(mod_name);
+			ptr += mod_name_len+1;
+
+			const char* file_name = ptr;
+			size_t file_name_len = strlen(file_name);
+			ptr += file_name_len+1;
+
+			ptr = align_up(ptr, 4);
+
+			//printf("> %d %-50s %-50s\n", mi->stream_index_of_module_symbol_stream, mod_name, file_name);
+
+			auto& m = modules[module_index++];
+			m.mi = mi;
+			m.name = std::string_view(mod_name, mod_name_len);
+			m.file_name = std::string_view(file_name, file_name_len);
+		}
+		assert((ptr - ptr2) == header->byte_size_of_the_module_information_substream);
+		ptr = ptr2 + header->byte_size_of_the_module_information_substream;
+		
+		//// section_contribution_substream
+		ptr2 = ptr;
+
+		u32 DBISCImpv = *(u32*)ptr;
+		ptr += sizeof(u32);
+
+		assert(DBISCImpv == (0xeffe0000 + 19970605));
+
+		num_section_contributions = header->byte_size_of_the_section_contribution_substream / sizeof(pdb_section_contribution);
+		section_contributions = (pdb_section_contribution*)ptr;
+
+		//while (ptr < ptr2+header->byte_size_of_the_section_contribution_substream) {
+			//auto* sc = (pdb_section_contribution*)ptr;
+			//ptr += sizeof(pdb_section_contribution);
+		for (u32 i=0; i<num_section_contributions; i++) {
+			auto* sc = &section_contributions[i];
+			//printf("> %d %8x %8x %d\n", sc->section_id, sc->offset, sc->size, sc->module_index);
+		}
+		ptr += sizeof(pdb_section_contribution) * num_section_contributions;
+		assert((ptr - ptr2) == header->byte_size_of_the_section_contribution_substream); // Why is this not correct?
+		build_section_contribution_index();
+		
+		//// section_map_substream
+		//ptr2 = ptr;
+		//
+		//auto* sec_header = (pdb_section_map_stream_header*)ptr;
+		//ptr += sizeof(pdb_section_map_stream_header);
+		//assert(sec_header->number_of_section_descriptors == sec_header->number_of_logical_section_descriptors);
+		//
+		////while (ptr < ptr2+header->byte_size_of_the_section_map_substream) {
+		//for (u32 i=0; i<sec_header->number_of_section_descriptors; i++) {
+		//	auto* sm = (pdb_section_map_entry*)ptr;
+		//	ptr += sizeof(pdb_section_map_entry);
+		//}
+		//
+		//assert((ptr - ptr2) == header->byte_size_of_the_section_map_substream);
+		ptr += header->byte_size_of_the_section_map_substream;
+
+		//// source_information_substream
+		//ptr2 = ptr;
+		//
+		//u16 amount_of_modules = *(u16*)ptr;
+		//ptr += sizeof(u16);
+		//u16 truncated_amount_of_source_files = *(u16*)ptr;
+		//ptr += sizeof(u16);
+		//
+		//assert(amount_of_modules == modules.size());
+		//
+		//u16* source_file_base_index_per_module = (u16*)ptr;
+		//ptr += amount_of_modules * sizeof(u16);
+		//u16* amount_of_source_files_per_module = (u16*)ptr;
+		//ptr += amount_of_modules * sizeof(u16);
+		//
+		//u32* source_file_name_offset_in_string_buffer = (u32*)ptr;
+		////ptr += amount_of_source_files * sizeof(u32);
+		//
+		//u32 byte_size_of_the_source_information_substream;   // substream 3
+		//u32 byte_size_of_the_type_server_map_substream;      // substream 4
+		//
+		//u32 index_of_the_MFC_type_server_in_type_server_map_substream;
+		//
+		//u32 byte_size_of_the_optional_debug_header_substream; // substream 6
+		//u32 byte_size_of_the_edit_and_continue_substream;     // substream 5
+		
+		ptr += header->byte_size_of_the_source_information_substream;
+
+		ptr += header->byte_size_of_the_type_server_map_substream;
+
+		ptr += header->byte_size_of_the_edit_and_continue_substream;
+
+		//// optional_debug_header_substream
+		opt_streams = (optional_debug_header_substream*)ptr;
+		
+		//byte_size_of_the_optional_debug_header_substream
+	}
+
+	void read_section_header_dump () {
+		section_header_dump_data = get_stream(opt_streams->stream_index_of_section_header_dump);
+		assert(section_header_dump_data.size() == streams[opt_streams->stream_index_of_section_header_dump].size);
+
+		char* ptr = section_header_dump_data.data();
+		char* ptr2 = ptr;
+
+		while (ptr < ptr2 + section_header_dump_data.size()) {
+			auto* sh = (pe_section_header*)ptr;
+			ptr += sizeof(pe_section_header);
+
+			sections_sorted.push_back({ std::string((const char*)sh->name, strnlen((const char*)sh->name, 8)), sh->virtual_address, sh->virtual_size });
+			
+			//char name[9] = {};
+			//strncpy_s(name, (const char*)sh->Name, 8); // properly null-terminate
+			//printf("> %7s %8x %8x\n", name, sh->VirtualAddress, sh->Misc.VirtualSize);
+		}
+
+		_assert_sections_sorted();
+	}
+	
+	// Only item names are needed from the IPI (for inline frames), so just index where each record starts
+	std::vector<u32> ipi_record_offsets;
+	u32 ipi_index_begin = 0;
+	std::once_flag ipi_loaded;
+
+	void read_IPI () {
+		if (streams.size() <= 4 || streams[4].size < sizeof(tpi_stream_header))
+			return;
+		IPI_data = get_stream(4);
+		auto* h = (tpi_stream_header*)IPI_data.data();
+		ipi_index_begin = h->type_index_begin;
+
+		char* ptr = IPI_data.data() + h->header_size;
+		char* end = ptr + std::min(h->type_record_bytes, IPI_data.size() - h->header_size);
+		ipi_record_offsets.reserve(h->type_index_end - h->type_index_begin);
+		while (ptr + sizeof(codeview_type_record_header) <= end) {
+			auto* rec = (codeview_type_record_header*)ptr;
+			ipi_record_offsets.push_back((u32)(ptr - IPI_data.data()));
+			ptr += sizeof(u16) + rec->length;
+		}
+	}
+
+	// The PSI address map is used as is for the public symbol fallback, it points into the symbol record stream
+	const u32* psi_addr_map = nullptr;
+	u32 psi_addr_map_count = 0;
+
+	// GSI or PSI name hash table, the records stay in the stream data
+	struct SymbolHashTable {
+		const gsi_hash_record* records = nullptr;
+		u32 num_records = 0;
+		std::vector<u32> bucket_begin; // bucket b has the records [bucket_begin[b], bucket_begin[b+1]), empty if there is no table
+	};
+	SymbolHashTable gsi_hash;
+	SymbolHashTable psi_hash;
+
+	std::once_flag global_symbols_loaded;
+
+	static bool read_symbol_hash_table (const char* ptr, u64 size, SymbolHashTable* out) {
+		if (size < sizeof(gsi_hash_header))
+			return false;
+		auto* h = (gsi_hash_header*)ptr;
+		if (h->version_signature != GSI_HASH_SIGNATURE || h->version != GSI_HASH_VERSION)
+			return false;
+		if ((u64)sizeof(gsi_hash_header) + h->hash_records_size + h->buckets_size > size)
+			return false;
+
+		constexpr u32 bitmap_words = (IPHR_HASH + 1 + 31) / 32;
+		if (h->buckets_size < bitmap_words * sizeof(u32))
+			return false;
+		auto* bitmap = (const u32*)(ptr + sizeof(gsi_hash_header) + h->hash_records_size);
+		auto* offsets = bitmap + bitmap_words;
+		u32 num_offsets = h->buckets_size / sizeof(u32) - bitmap_words;
+
+		out->records = (const gsi_hash_record*)(ptr + sizeof(gsi_hash_header));
+		out->num_records = h->hash_records_size / sizeof(gsi_hash_record);
+
+		// only non-empty buckets have an offset, empty ones end up starting (and ending) where the next one starts
+		out->bucket_begin.assign(IPHR_HASH + 1, 0xffffffff);
+		out->bucket_begin[IPHR_HASH] = out->num_records;
+		u32 n = 0;
+		for (u32 b=0; b<IPHR_HASH; b++) {
+			if (bitmap[b / 32] & (1u << (b % 32))) {
+				if (n >= num_offsets)
+					return false;
+				out->bucket_begin[b] = std::min(offsets[n++] / GSI_HASH_BUCKET_OFFSET_UNIT, out->num_records);
+			}
+		}
+		for (u32 b=IPHR_HASH; b-- > 0;) {
+			if (out->bucket_begin[b] == 0xffffffff)
+				out->bucket_begin[b] = out->bucket_begin[b+1];
+		}
+		return true;
+	}
+
+	void read_global_symbols () {
+		// DBI_data is not read when loading from the index cache, the PDB is still mapped though
+		StreamData dbi_data;
+		if (DBI_data.empty()) {
+			if (streams.size() <= 3 || streams[3].size < sizeof(dbi_stream_header))
+				return;
+			dbi_data = get_stream(3);
+		}
+		auto* dbi = (dbi_stream_header*)(DBI_data.empty() ? dbi_data.data() : DBI_data.data());
+
+		u16 srs_stream = dbi->stream_index_of_the_symbol_record_stream;
+		u16 psi_stream = dbi->stream_index_of_the_public_symbol_index_stream;
+		u16 gsi_stream = dbi->stream_index_of_the_global_symbol_index_stream;
+		if (srs_stream >= streams.size())
+			return;
+		symbol_records_data = get_stream(srs_stream);
+
+		if (gsi_stream < streams.size()) {
+			GSI_data = get_stream(gsi_stream);
+			if (!GSI_data.empty() && !read_symbol_hash_table(GSI_data.data(), GSI_data.size(), &gsi_hash)) {
+				fprintf(stderr, "Corrupted GSI stream\n");
+				gsi_hash = {};
+			}
+		}
+
+		if (psi_stream >= streams.size() || streams[psi_stream].size < sizeof(psi_stream_header))
+			return;
+		PSI_data = get_stream(psi_stream);
+		auto* h = (psi_stream_header*)PSI_data.data();
+		if ((u64)sizeof(psi_stream_header) + h->sym_hash_size + h->addr_map_size > PSI_data.size()) {
+			fprintf(stderr, "Corrupted PSI stream\n");
+			return;
+		}
+		psi_addr_map = (const u32*)(PSI_data.data() + sizeof(psi_stream_header) + h->sym_hash_size);
+		psi_addr_map_count = h->addr_map_size / sizeof(u32);
+
+		if (h->sym_hash_size > 0 && !read_symbol_hash_table(PSI_data.data() + sizeof(psi_stream_header), h->sym_hash_size, &psi_hash)) {
+			fprintf(stderr, "Corrupted PSI hash table\n");
+			psi_hash = {};
+		}
+	}
+	const PUBSYM32* get_public (u32 addr_map_index) {
+		u32 offs = psi_addr_map[addr_map_index];
+		if ((u64)offs + sizeof(PUBSYM32) > symbol_records_data.size())
+			return nullptr;
+		auto* sym = (PUBSYM32*)(symbol_records_data.data() + offs);
+		return sym->rectyp == S_PUB32 ? sym : nullptr;
+	}
+
+	void read_module_symbol_stream (u32 module_index) {
+		auto& mod = modules[module_index];
+		auto* mi = mod.mi;
+
+		if (mi->stream_index_of_module_symbol_stream == 0xffff)
+			return; // no symbol data
+		mod.symbol_stream_data = get_stream(mi->stream_index_of_module_symbol_stream);
+		char* ptr = mod.symbol_stream_data.data();
+		
+		//// Symbol info
+		char* ptr2 = ptr;
+		u32 signature = *(u32*)ptr;
+		ptr += sizeof(u32);
+		assert(signature == 4); // CV_SIGNATURE_C13
+		
+		// inline sites can only be decoded once we have the DEBUG_S_INLINEELINES from the C13 data below
+		struct RawInlineSite {
+			codeview_symbol_header* sym;
+			PROCSYM32* proc;
+			u32 parent;
+			u16 depth;
+		};
+		std::vector<RawInlineSite> raw_sites;
+		std::vector<u32> site_stack; // currently open S_INLINESITEs
+		PROCSYM32* cur_proc = nullptr;
+
+		while (ptr < ptr2 + mi->byte_size_of_symbol_information) {
+			auto sym = (codeview_symbol_header*)ptr;
+			
+			ptr += sizeof(u16) + sym->length; // length field of codeview_symbol_header not contained in length (but kind is)
+			ptr = align_up(ptr, 4);
+
+			//printf("> %4x %d\n", sym->kind, sym->length);
+
+			switch (sym->kind) {
+				case S_GPROC32: case S_LPROC32:
+				case S_GPROC32_ID: case S_LPROC32_ID: {
+					auto* proc = (PROCSYM32*)sym;
+					//printf(">> %s %4d %4d %8x %s\n",
+					//	sym->kind == S_LPROC32 ? "L":"G",
+					//	proc->seg, proc->len, proc->off, proc->name);
+
+					mod.procsyms.push_back({ proc });
+					cur_proc = proc;
+					site_stack.clear();
+				} break;
+				case S_INLINESITE: case S_INLINESITE2: {
+					u32 parent = site_stack.empty() ? InlineSite::NO_PARENT : site_stack.back();
+					site_stack.push_back((u32)raw_sites.size());
+					raw_sites.push_back({ sym, cur_proc, parent, (u16)(site_stack.size()-1) });
+				} break;
+				case S_INLINESITE_END: {
+					if (!site_stack.empty())
+						site_stack.pop_back();
+				} break;
+			}
+		}
+		assert((ptr - ptr2) == mi->byte_size_of_symbol_information);
+		
+		//auto* c11_line_information = (u8*)ptr;
+		ptr += mi->byte_size_of_c11_line_information;
+		
+		//// C13 line info
+		//printf("> c13_line_information\n");
+
+		ptr2 = ptr;
+
+		// first pass to find FILECHKSMS ptr
+		char* filechksms_ptr = nullptr;
+		while (ptr < ptr2 + mi->byte_size_of_c13_line_information) {
+			auto* header = (codeview_subsection_header*)ptr;
+			ptr += sizeof(codeview_subsection_header);
+
+			if (header->type == DEBUG_S_FILECHKSMS) {
+				filechksms_ptr = ptr;
+				//read_file_checksum(header);
+				break;
+			}
+			else {
+				ptr += header->length;
+			}
+		}
+		ptr = ptr2; // reset ptr
+		
+		std::vector<LineContrib> contribs;
+		std::vector<u32> line_offsets;
+		std::vector<u32> line_numbers;
+
+		struct InlineeLines {
+			u32 file_chksm; // offset in FILECHKSMS
+			u32 line;
+		};
+		std::unordered_map<CV_ItemId, InlineeLines> inlinee_lines;
+
+		auto read_line_numbers = [&] (codeview_subsection_header* header) {
+			auto* ptr3 = ptr;
+
+			// With usual compiler, this is once per function
+			auto* lines = (codeview_line_header*)ptr;
+			ptr += sizeof(codeview_line_header);
+			assert(lines->flags == 0); // CV_LINES_HAVE_COLUMNS not implemented
+
+			//printf(">> Header %d, %8x %8x\n", lines->contribution_section_id, lines->contribution_offset, lines->contribution_size);
+			
+			bool decoded = false;
+			while (ptr < ptr3 + header->length) {
+				auto* line_block = (codeview_line_block_header*)ptr;
+				ptr += sizeof(codeview_line_block_header);
+
+				auto* cksm = (codeview_file_checksum*)(filechksms_ptr + line_block->offset_in_file_checksums);
+				auto* name = &names[cksm->offset_in_string_table];
+
+				//printf(">> Block %d %d %s\n", line_block->block_size, line_block->offset_in_file_checksums, name);
+
+				auto* block_lines = (codeview_line*)ptr;
+				ptr += line_block->amount_of_lines * sizeof(codeview_line);
+
+				// find_source_loc always used the first non-empty block of a contribution, so that's all we keep
+				// blocks for other files (code from force-inlined functions in headers) are never looked at, like before
+				if (decoded || line_block->amount_of_lines == 0)
+					continue;
+				decoded = true;
+
+				LineContrib lc = {};
+				lc.sec_id     = lines->contribution_section_id;
+				lc.sec_offset = lines->contribution_offset;
+				lc.size       = lines->contribution_size;
+				lc.file       = cksm->offset_in_string_table;
+				lc.first_line = (u32)line_offsets.size();
+
+				// The old scan stopped at the first offset past the address, which is only the same as a search for the last offset <= address
+				// if the offsets never decrease, so the rare out of order block is kept as is and scanned like before
+				for (u32 i=1; i<line_block->amount_of_lines; i++) {
+					if (block_lines[i].offset < block_lines[i-1].offset)
+						lc.flags |= LineContrib::LINES_UNSORTED;
+				}
+				// The same offset can appear multiple times with different lines, only the first of these was ever returned
+				// so drop the others, which turns the lookup into a plain search for the last offset <= address
+				for (u32 i=0; i<line_block->amount_of_lines; i++) {
+					auto& line = block_lines[i];
+					if (i > 0 && line.offset == line_offsets.back() && !(lc.flags & LineContrib::LINES_UNSORTED))
+						continue;
+					line_offsets.push_back(line.offset);
+					line_numbers.push_back(line.start_line_number);
+				}
+				lc.num_lines = (u32)line_offsets.size() - lc.first_line;
+				contribs.push_back(lc);
+			}
+			assert((ptr - ptr3) == header->length);
+		};
+		auto read_file_checksums = [&] (codeview_subsection_header* header) {
+			auto* ptr3 = ptr;
+			while (ptr < ptr3 + header->length) {
+				auto* file = (codeview_file_checksum*)ptr;
+				ptr += sizeof(codeview_file_checksum);
+				ptr += file->checksum_size;
+				ptr = align_up(ptr, 4);
+
+				auto* name = &names[file->offset_in_string_table];
+
+				//printf(">> File Checksum %s\n", name);
+			}
+			assert((ptr - ptr3) == header->length);
+		};
+
+		while (ptr < ptr2 + mi->byte_size_of_c13_line_information) {
+			auto* header = (codeview_subsection_header*)ptr;
+			ptr += sizeof(codeview_subsection_header);
+
+			switch (header->type) {
+				case DEBUG_S_LINES: {
+					read_line_numbers(header);
+				} break;
+				case DEBUG_S_INLINEELINES: {
+					auto* ptr3 = ptr;
+					u32 sig = *(u32*)ptr;
+					ptr += sizeof(u32);
+					while (ptr < ptr3 + header->length) {
+						auto* il = (codeview_inlinee_source_line*)ptr;
+						ptr += sizeof(codeview_inlinee_source_line);
+						if (sig == CV_INLINEE_SOURCE_LINE_SIGNATURE_EX) {
+							u32 extra_files = *(u32*)ptr;
+							ptr += sizeof(u32) + extra_files * sizeof(u32);
+						}
+						inlinee_lines[il->inlinee] = { il->offset_in_file_checksums, il->source_line_number };
+					}
+					assert((ptr - ptr3) == header->length);
+				} break;
+				//case DEBUG_S_FILECHKSMS: {
+				//	read_file_checksum(header);
+				//} break;
+				default: {
+					ptr += header->length;
+				}
+			}
+		}
+		assert((ptr - ptr2) == mi->byte_size_of_c13_line_information);
+
+		// usually already in order, but the lookup relies on it
+		// for contributions with the same start the first one was found by the old scan, so keep that one
+		std::stable_sort(contribs.begin(), contribs.end(), [] (LineContrib const& l, LineContrib const& r) {
+			return l.key() < r.key();
+		});
+		contribs.erase(std::unique(contribs.begin(), contribs.end(), [] (LineContrib const& l, LineContrib const& r) {
+			return l.key() == r.key();
+		}), contribs.end());
+
+		mod.line_table.contribs.assign(std::move(contribs));
+		mod.line_table.line_offsets.assign(std::move(line_offsets));
+		mod.line_table.line_numbers.assign(std::move(line_numbers));
+		mod.line_table.build_search();
+
+		if (!raw_sites.empty()) {
+			auto file_name_offset = [&] (u32 file_chksm) -> u32 {
+				if (!filechksms_ptr) return 0;
+				return ((codeview_file_checksum*)(filechksms_ptr + file_chksm))->offset_in_string_table;
+			};
+
+			std::vector<InlineSite> sites(raw_sites.size());
+			std::vector<InlineRange> ranges;
+			for (u32 si=0; si<(u32)raw_sites.size(); si++) {
+				auto& rs = raw_sites[si];
+				auto& site = sites[si];
+				site.parent = rs.parent;
+				site.first_range = (u32)ranges.size();
+
+				const u8* ann;
+				if (rs.sym->kind == S_INLINESITE2) {
+					auto* s = (INLINESITESYM2*)rs.sym;
+					site.inlinee = s->inlinee;
+					ann = s->binaryAnnotations;
+				}
+				else {
+					auto* s = (INLINESITESYM*)rs.sym;
+					site.inlinee = s->inlinee;
+					ann = s->binaryAnnotations;
+				}
+				const u8* ann_end = (u8*)rs.sym + sizeof(u16) + rs.sym->length;
+
+				auto il = inlinee_lines.find(site.inlinee);
+				if (!rs.proc || il == inlinee_lines.end())
+					continue; // no ranges, frames still get reported through its children
+
+				decode_inline_site_ranges(ann, ann_end, rs.proc, rs.depth, si,
+					il->second.file_chksm, il->second.line, file_name_offset, &ranges);
+				site.num_ranges = (u32)ranges.size() - site.first_range;
+			}
+			mod.inline_table.segments.assign(build_inline_segments(ranges));
+			mod.inline_table.sites.assign(std::move(sites));
+			mod.inline_table.ranges.assign(std::move(ranges));
+		}
+		table_bytes += mod.procsyms.capacity() * sizeof(ProcSym) + mod.line_table.memory_size() + mod.inline_table.memory_size();
+
+		auto global_references_bytes_size = *(u32*)ptr;
+		auto num_global_references = global_references_bytes_size / 4;
+		ptr += sizeof(u32);
+		
+		auto* global_references = (u32*)ptr;
+		ptr += global_references_bytes_size;
+		
+		assert((ptr - mod.symbol_stream_data.data()) == streams[mi->stream_index_of_module_symbol_stream].size);
+	}
+	
+public:
+	struct ProcSym {
+		PROCSYM32* proc;
+	};
+
+	// One DEBUG_S_LINES subsection, with usual compilers this is one function
+	// also the on-disk layout in the index cache, so the padding is explicit
+	struct LineContrib {
+		static constexpr u16 LINES_UNSORTED = 1; // line offsets decrease somewhere, kept with repeats and scanned like the old lookup
+		u16 sec_id;
+		u16 flags;
+		u32 sec_offset;
+		u32 size;
+		u32 file; // offset of the file name in /names, which is unique per file name, so doubles as interned file id
+		u32 first_line; // range in LineTable::line_offsets/line_numbers
+		u32 num_lines;
+
+		u64 key () const { return (u64)sec_id << 32 | sec_offset; }
+	};
+	// C13 line info of a module decoded once on load
+	// contribs are sorted by section and offset, the lines of each contrib are in file order,
+	// which is by offset (with repeated offsets removed) unless the contrib has LINES_UNSORTED
+	// owned, or views into the index cache
+	struct LineTable {
+		FlatArray<LineContrib> contribs;
+		FlatArray<u32> line_offsets; // relative to the contribution
+		FlatArray<u32> line_numbers;
+		// LineContrib::key() of each contrib for contrib_search, built on load (not in the index cache)
+		// only for modules with many contribs, on the usual few hundred bytes the extra keys array just costs another cache miss
+		// compared to binary searching the contribs directly
+		static constexpr size_t SEARCH_LAYOUT_MIN = 256;
+		std::vector<u64> contrib_keys;
+		SearchLayout<u64> contrib_search;
+
+		// index of the first contrib with key() > key
+		size_t upper_bound (u64 key) const {
+			if (!contrib_keys.empty())
+				return contrib_search.upper_bound(key);
+			return std::upper_bound(contribs.begin(), contribs.end(), key, [] (u64 key, LineContrib const& c) {
+				return key < c.key();
+			}) - contribs.begin();
+		}
+		void build_search () {
+			if (contribs.size() <= SEARCH_LAYOUT_MIN)
+				return;
+			contrib_keys.resize(contribs.size());
+			for (size_t i=0; i<contribs.size(); i++)
+				contrib_keys[i] = contribs[i].key();
+			contrib_search.build(contrib_keys.data(), contrib_keys.size());
+		}
+		size_t memory_size () const {
+			return contribs.size() * sizeof(LineContrib) + line_offsets.size() * sizeof(u32) * 2
+			     + contrib_keys.size() * sizeof(u64) + contrib_search.memory_size();
+		}
+	};
+	// Inline sites of a module decoded once on load, from S_INLINESITE(2) binary annotations and DEBUG_S_INLINEELINES
+	struct InlineSite {
+		static constexpr u32 NO_PARENT = 0xffffffff;
+		u32 parent = NO_PARENT; // index into InlineTable::sites, NO_PARENT if inlined directly into the proc
+		CV_ItemId inlinee = 0; // LF_FUNC_ID or LF_MFUNC_ID in the IPI stream
+		u32 first_range = 0; // range in InlineTable::ranges, sorted by offset
+		u32 num_ranges = 0;
+	};
+	// Code range of an inline site and the line in the inlinee it belongs to
+	struct InlineRange {
+		u16 sec_id;
+		u16 depth; // 0 for sites inlined directly into the proc
+		u32 sec_offset;
+		u32 size;
+		u32 site;
+		u32 file; // /names offset, like LineContrib::file
+		u32 line;
+
+		u64 key () const { return (u64)sec_id << 32 | sec_offset; }
+	};
+	// Inline ranges nest, so they are flattened into non-overlapping segments that each point at the innermost range
+	// then a single binary search finds the innermost frame, and the outer ones follow from InlineSite::parent
+	struct InlineSegment {
+		u16 sec_id;
+		u16 _pad;
+		u32 sec_offset;
+		u32 size;
+		u32 range; // innermost InlineRange covering the segment
+
+		u64 key () const { return (u64)sec_id << 32 | sec_offset; }
+	};
+	struct InlineTable {
+		FlatArray<InlineSite> sites;
+		FlatArray<InlineRange> ranges;
+		FlatArray<InlineSegment> segments; // sorted
+		FlatArray<u32> site_name; // only if loaded from the index cache: offset into ProcIndex::strings, there is no IPI to look names up in
+
+		size_t memory_size () const {
+			return sites.size() * sizeof(InlineSite) + ranges.size() * sizeof(InlineRange) + segments.size() * sizeof(InlineSegment)
+			     + site_name.size() * sizeof(u32);
+		}
+	};
+private:
+	// CVUncompressData
+	static u32 read_compressed (const u8*& ptr, const u8* end) {
+		if (ptr >= end) return 0xffffffff;
+		u8 b = *ptr++;
+		if ((b & 0x80) == 0x00)
+			return b;
+		if ((b & 0xC0) == 0x80) {
+			if (ptr >= end) return 0xffffffff;
+			return (u32)(b & 0x3f) << 8 | *ptr++;
+		}
+		if ((b & 0xE0) == 0xC0) {
+			if (end - ptr < 3) return 0xffffffff;
+			u32 val = (u32)(b & 0x1f) << 24 | (u32)ptr[0] << 16 | (u32)ptr[1] << 8 | ptr[2];
+			ptr += 3;
+			return val;
+		}
+		return 0xffffffff;
+	}
+	static s32 decode_signed (u32 val) {
+		return val & 1 ? -(s32)(val >> 1) : (s32)(val >> 1);
+	}
+
+	// Runs the binary annotation "line program" of one inline site, every op that changes the code offset starts a new range
+	// whose length is either given explicitly or ends at the start of the next one, like in the PDB of the pdb crate / LLVM
+	template <typename FILE_NAME_OFFSET>
+	static void decode_inline_site_ranges (const u8* ann, const u8* ann_end, PROCSYM32* proc, u16 depth, u32 site,
+			u32 file_chksm, u32 line, FILE_NAME_OFFSET file_name_offset, std::vector<InlineRange>* out_ranges) {
+		auto& ranges = *out_ranges;
+		u32 first = (u32)ranges.size();
+
+		u32 code_base = 0, code = 0;
+		s64 cur_line = line;
+		bool last_open = false; // length of the last range not known yet
+
+		auto emit = [&] (u32 length) {
+			u32 offs = proc->off + code_base + code;
+			if (last_open) {
+				auto& last = ranges.back();
+				last.size = offs > last.sec_offset ? offs - last.sec_offset : 0;
+			}
+			ranges.push_back({ proc->seg, depth, offs, length, site, file_name_offset(file_chksm), (u32)cur_line });
+			last_open = length == 0;
+		};
+
+		while (ann < ann_end) {
+			u32 op = read_compressed(ann, ann_end);
+			if (op == BA_OP_Invalid || op == 0xffffffff)
+				break; // padding at the end
+
+			u32 a = read_compressed(ann, ann_end);
+			switch (op) {
+				case BA_OP_CodeOffset:           code = a; break;
+				case BA_OP_ChangeCodeOffsetBase: code_base = a; break;
+				case BA_OP_ChangeCodeOffset:     code += a; emit(0); break;
+				case BA_OP_ChangeCodeLength: {
+					if (last_open) {
+						ranges.back().size = a;
+						last_open = false;
+					}
+					code += a;
+				} break;
+				case BA_OP_ChangeFile:           file_chksm = a; break;
+				case BA_OP_ChangeLineOffset:     cur_line += decode_signed(a); break;
+				case BA_OP_ChangeCodeOffsetAndLineOffset: {
+					code += a & 0xf;
+					cur_line += decode_signed(a >> 4);
+					emit(0);
+				} break;
+				case BA_OP_ChangeCodeLengthAndCodeOffset: {
+					u32 offs = read_compressed(ann, ann_end);
+					code += offs;
+					emit(a);
+				} break;
+				case BA_OP_ChangeLineEndDelta: case BA_OP_ChangeRangeKind:
+				case BA_OP_ChangeColumnStart: case BA_OP_ChangeColumnEndDelta: case BA_OP_ChangeColumnEnd:
+					break; // no columns
+				default:
+					ann = ann_end; // unknown op, can't continue
+			}
+		}
+		// a range without an end can't be placed
+		if (last_open)
+			ranges.pop_back();
+
+		ranges.erase(std::remove_if(ranges.begin() + first, ranges.end(), [] (InlineRange const& r) { return r.size == 0; }), ranges.end());
+		std::sort(ranges.begin() + first, ranges.end(), [] (InlineRange const& l, InlineRange const& r) { return l.key() < r.key(); });
+	}
+
+	static std::vector<InlineSegment> build_inline_segments (std::vector<InlineRange> const& ranges) {
+		std::vector<u32> order(ranges.size());
+		for (u32 i=0; i<(u32)order.size(); i++) order[i] = i;
+		std::sort(order.begin(), order.end(), [&] (u32 l, u32 r) { return ranges[l].key() < ranges[r].key(); });
+
+		std::vector<u64> points;
+		points.reserve(ranges.size() * 2);
+		for (auto& r : ranges) {
+			points.push_back(r.key());
+			points.push_back(r.key() + r.size);
+		}
+		std::sort(points.begin(), points.end());
+		points.erase(std::unique(points.begin(), points.end()), points.end());
+
+		// sweep over the elementary intervals between all range boundaries, keeping the set of ranges covering the current one
+		std::vector<InlineSegment> segments;
+		std::vector<u32> active;
+		size_t next = 0;
+		for (size_t p=0; p+1<points.size(); p++) {
+			u64 begin = points[p], end = points[p+1];
+			while (next < order.size() && ranges[order[next]].key() <= begin)
+				active.push_back(order[next++]);
+			active.erase(std::remove_if(active.begin(), active.end(), [&] (u32 r) {
+				return ranges[r].key() + ranges[r].size <= begin;
+			}), active.end());
+
+			if (active.empty() || (begin >> 32) != (end >> 32))
+				continue;
+
+			u32 inner = active[0];
+			for (u32 r : active) {
+				if (ranges[r].depth >= ranges[inner].depth)
+					inner = r;
+			}
+
+			if (!segments.empty()) { // extend the previous segment if it continues the same range
+				auto& last = segments.back();
+				if (last.range == inner && last.key() + last.size == begin) {
+					last.size += (u32)(end - begin);
+					continue;
+				}
+			}
+			InlineSegment seg = {};
+			seg.sec_id = (u16)(begin >> 32);
+			seg.sec_offset = (u32)begin;
+			seg.size = (u32)(end - begin);
+			seg.range = inner;
+			segments.push_back(seg);
+		}
+		return segments;
+	}
+public:
+	struct Module {
+		pdb_module_information* mi = nullptr; // null if loaded from the index cache
+		std::string_view name;
+		std::string_view file_name;
+
+		// symbol_stream_data and procsyms are only valid after get_module() loaded the module
+		std::once_flag loaded;
+
+		StreamData symbol_stream_data;
+		std::vector<ProcSym> procsyms;
+		LineTable line_table;
+		InlineTable inline_table;
+	};
+private:
+	std::vector<Module> modules;
+
+public:
+	u32 num_modules () const {
+		return (u32)modules.size();
+	}
+	// Loads the module symbol stream on first access, safe to call from multiple threads
+	Module& get_module (u32 module_index) {
+		assert(module_index < modules.size());
+		auto& mod = modules[module_index];
+		std::call_once(mod.loaded, [&] () {
+			read_module_symbol_stream(module_index);
+		});
+		return mod;
+	}
+	void load_all_modules () {
+		for (u32 i=0; i<num_modules(); i++) {
+			get_module(i);
+		}
+	}
+	// Modules are independent of each other, so they can be loaded on a thread pool, every module still only writes its own data
+	void load_all_modules (ThreadPool& pool) {
+		if (from_index_cache)
+			return; // nothing to load, and no mi to sort by
+		// push the biggest modules first, so the small ones fill the gaps at the end
+		std::vector<u32> order(num_modules());
+		for (u32 i=0; i<num_modules(); i++) order[i] = i;
+		std::sort(order.begin(), order.end(), [&] (u32 l, u32 r) {
+			return modules[l].mi->byte_size_of_symbol_information + modules[l].mi->byte_size_of_c13_line_information
+			     > modules[r].mi->byte_size_of_symbol_information + modules[r].mi->byte_size_of_c13_line_information;
+		});
+
+		for (u32 i : order) {
+			pool.push([this, i] () { get_module(i); });
+		}
+		pool.wait();
+	}
+
+	// in address order, section ids are one based indices into this
+	std::vector<Section> const& get_sections () const {
+		return sections_sorted;
+	}
+	const Section* find_section_for_addr (uintptr_t raddr, u32* out_sec_id) {
+		for (u32 id=0; id<sections_sorted.size(); id++) {
+			auto& sec = sections_sorted[id];
+			if (raddr < sec.base_addr)
+				break;
+			if (/*raddr >= sec.base_addr && */raddr < sec.base_addr + sec.size) {
+				*out_sec_id = id+1; // one based!
+				return &sec;
+			}
+		}
+		return nullptr;
+	}
+	void _assert_sections_sorted () {
+		for (size_t i=1; i<sections_sorted.size(); i++) {
+			assert(sections_sorted[i].base_addr > sections_sorted[i-1].base_addr + sections_sorted[i-1].size);
+		}
+	}
+	
+private:
+	// Possibly overlapping ranges cut into sorted non-overlapping pieces, each with the lowest prio of the ranges covering it,
+	// which is the range a linear scan in prio order finds first (adjacent pieces of the same range are merged)
+	struct PrioRange {
+		u64 begin, end;
+		u32 prio;
+	};
+	static std::vector<PrioRange> first_match_pieces (std::vector<PrioRange> ranges) {
+		std::sort(ranges.begin(), ranges.end(), [] (PrioRange const& l, PrioRange const& r) {
+			return l.begin < r.begin;
+		});
+
+		// sweep over the ranges with the ones covering pos in a queue, lowest prio first, ended ones are dropped once they get to the top
+		auto later = [] (PrioRange const& l, PrioRange const& r) { return l.prio > r.prio; };
+		std::priority_queue<PrioRange, std::vector<PrioRange>, decltype(later)> active(later);
+		std::vector<PrioRange> pieces;
+		size_t next_range = 0;
+		u64 pos = 0;
+		while (next_range < ranges.size() || !active.empty()) {
+			if (active.empty())
+				pos = ranges[next_range].begin;
+			while (next_range < ranges.size() && ranges[next_range].begin <= pos)
+				active.push(ranges[next_range++]);
+			while (!active.empty() && active.top().end <= pos)
+				active.pop();
+			if (active.empty())
+				continue;
+
+			auto& top = active.top();
+			u64 piece_end = top.end;
+			if (next_range < ranges.size())
+				piece_end = std::min(piece_end, ranges[next_range].begin);
+
+			if (!pieces.empty() && pieces.back().prio == top.prio && pieces.back().end == pos)
+				pieces.back().end = piece_end;
+			else
+				pieces.push_back({ pos, piece_end, top.prio });
+			pos = piece_end;
+		}
+		return pieces;
+	}
+
+	// The section contributions cut into sorted non-overlapping pieces, each pointing at the first contribution in file order covering it
+	// so a search finds the same one the linear scan does, even where contributions overlap
+	struct SectionContribIndex {
+		std::vector<u64> begin; // section id << 32 | offset
+		std::vector<u32> end;   // offset
+		std::vector<u32> contrib;
+		SearchLayout<u64> search; // over begin
+		bool complete = false;  // false until built (never for PDBs from the index cache), then the lookup falls back to the scan
+	};
+	SectionContribIndex sc_index;
+
+	void build_section_contribution_index () {
+		std::vector<PrioRange> ranges;
+		ranges.reserve(num_section_contributions);
+		for (u32 i=0; i<num_section_contributions; i++) {
+			auto& sc = section_contributions[i];
+			// the scan compares offset + size as s32, so a contribution past that never matches, and negative offsets only
+			// match negative addresses, which don't go through the index
+			s64 begin = std::max(sc.offset, 0), end = (s64)sc.offset + sc.size;
+			if (sc.section_id < 0 || sc.size <= 0 || end > 0x7fffffff || begin >= end)
+				continue; // never matches
+			u64 key = (u64)sc.section_id << 32;
+			ranges.push_back({ key | (u64)begin, key | (u64)end, i });
+		}
+
+		auto& ci = sc_index;
+		for (auto& piece : first_match_pieces(std::move(ranges))) {
+			ci.begin  .push_back(piece.begin);
+			ci.end    .push_back((u32)piece.end);
+			ci.contrib.push_back(piece.prio);
+		}
+		ci.search.build(ci.begin.data(), ci.begin.size());
+		ci.complete = true;
+		table_bytes += ci.begin.size() * (sizeof(u64) + sizeof(u32)*2) + ci.search.memory_size();
+	}
+public:
+	// in file order, which is the order find_section_contribution searches them in, none if loaded from the index cache
+	const pdb_section_contribution* get_section_contributions (u32* out_count) const {
+		*out_count = num_section_contributions;
+		return section_contributions;
+	}
+
+	// section_contributions.offset & size are explicitly signed for some reason despite the fact that they logically cannot be negative
+	// (as negative sizes don't make sense and the relative address had to be positive to even cause us to look up this section)
+	const pdb_section_contribution* find_section_contribution (u32 sec_id, s32 raddr) {
+		auto& ci = sc_index;
+		if (!ci.complete || raddr < 0 || sec_id > 0xffff)
+			return find_section_contribution_linear(sec_id, raddr);
+
+		size_t ub = ci.search.upper_bound((u64)sec_id << 32 | (u32)raddr);
+		if (ub == 0)
+			return nullptr;
+		size_t i = ub-1;
+		if ((ci.begin[i] >> 32) != sec_id || (u32)raddr >= ci.end[i])
+			return nullptr;
+		return &section_contributions[ci.contrib[i]];
+	}
+	// The scan find_section_contribution replaces, the first contribution in file order that contains the address
+	const pdb_section_contribution* find_section_contribution_linear (u32 sec_id, s32 raddr) {
+		for (u32 i=0; i<num_section_contributions; i++) {
+			auto& sc = section_contributions[i];
+			if (sec_id == sc.section_id && raddr >= sc.offset && raddr < sc.offset + sc.size) {
+				return &sc;
+			}
+		}
+
+		return nullptr;
+	}
+
+	const ProcSym* find_procsym (Module& mod, u32 sec_id, u32 sec_raddr) {
+		for (auto& ps : mod.procsyms) {
+			// I am not sure proc->len actually refers to the length of the instructions belonging to the function or now
+			// other symbols stored inside the pdb do not have a length
+			// and dbghelp.dll actually SymFromAddr the function name for addresses clearly past the function (padding before the next function)
+			// not sure if that's what I should do as well, I plan to do comparisons with dbghelp with fuzzed inputs/scan the entire exe address space
+			if (sec_id == ps.proc->seg && sec_raddr >= ps.proc->off && sec_raddr < ps.proc->off + ps.proc->len) {
+				return &ps;
+			}
+		}
+
+		return nullptr;
+	}
+
+	// Sorted structure-of-arrays of all procs of all modules, so that an RVA resolves to its proc with a single binary search
+	// instead of the section -> section contribution -> module procsyms scans above
+	// Entries are the non-overlapping pieces of the procs the scans would return there, usually one per proc,
+	// but a proc split by an earlier nested proc or by another module's contribution gets one per piece
+	// The rva_begin column is searched, the rest is only touched once for the found entry
+	struct ProcIndex {
+		FlatArray<u32> rva_begin;
+		FlatArray<u32> rva_end;
+		FlatArray<u32> sym_rva; // start of the proc, before rva_begin for all but its first piece
+		FlatArray<u16> module;
+		FlatArray<u32> proc; // index into Module::procsyms, empty if loaded from the index cache
+		// only if loaded from the index cache, where there are no procsyms to get the names from
+		FlatArray<u32> name; // offset into strings
+		FlatArray<char> strings;
+		SearchLayout<u32> rva_search; // over rva_begin
+
+		// Optional page table, page_first[p] is the number of procs starting before page p (rva >> page_bits)
+		// so a lookup in page p only has to look at the procs [page_first[p], page_first[p+1]), which usually fit in a cache line
+		// pages with more of them than PAGE_SCAN_MAX go through rva_search instead of being scanned
+		FlatArray<u32> page_first;
+		u32 page_bits = 0;
+		static constexpr u32 PAGE_SCAN_MAX = 16;
+
+		size_t size () const { return rva_begin.size(); }
+
+		// returns index of the proc containing rva or -1
+		s64 find (u32 rva) const {
+			if (page_first.empty())
+				return find_binary_search(rva);
+
+			size_t p = rva >> page_bits;
+			size_t last = page_first.size()-1; // every proc starts before the last page
+			size_t lo = page_first[std::min(p, last)];
+			size_t hi = p < last ? page_first[p+1] : size();
+			if (hi - lo > PAGE_SCAN_MAX) {
+				// the layout only searches the whole array, but that beats a binary search of a dense page (its levels stay cached)
+				lo = rva_search.upper_bound(rva);
+			}
+			else {
+				lo += search_layout::count_le(rva_begin.data() + lo, hi - lo, rva);
+			}
+			// lo is now the first proc starting after rva, like the upper_bound in find_binary_search
+			if (lo == 0)
+				return -1;
+			size_t i = lo - 1;
+			if (rva >= rva_end[i])
+				return -1;
+			return (s64)i;
+		}
+		// find without the page table, through rva_search
+		s64 find_binary_search (u32 rva) const {
+			size_t ub = rva_search.upper_bound(rva);
+			if (ub == 0)
+				return -1;
+			size_t i = ub - 1;
+			if (rva >= rva_end[i])
+				return -1;
+			return (s64)i;
+		}
+		// Same as find, for ascending rvas: gallops forward from the previous result in *cursor instead of searching everything
+		// start with *cursor = 0
+		s64 find_from (u32 rva, size_t* cursor) const {
+			size_t n = size();
+			// everything before lo is <= rva, everything from hi on is > rva
+			size_t lo = std::min(*cursor, n), step = 1, hi = lo + 1;
+			while (hi < n && rva_begin[hi] <= rva) {
+				lo = hi;
+				step *= 2;
+				hi = lo + step;
+			}
+			hi = std::min(hi, n);
+
+			size_t ub = std::upper_bound(rva_begin.begin() + lo, rva_begin.begin() + hi, rva) - rva_begin.begin();
+			if (ub == 0)
+				return -1;
+			size_t i = ub - 1;
+			*cursor = i;
+			if (rva >= rva_end[i])
+				return -1;
+			return (s64)i;
+		}
+
+		// once the columns are filled in (or mapped)
+		void build_search (u32 page_bits) {
+			rva_search.build(rva_begin.data(), rva_begin.size());
+			build_page_table(page_bits);
+		}
+		// bits 0 removes the page table
+		void build_page_table (u32 bits) {
+			assert(bits < 32);
+			page_first = {};
+			page_bits = bits;
+			if (bits == 0 || rva_begin.empty())
+				return;
+
+			u32 image_end = *std::max_element(rva_end.begin(), rva_end.end());
+			size_t num_pages = (size_t)(image_end >> bits) + 1;
+			std::vector<u32> first(num_pages + 1);
+			size_t i = 0;
+			for (size_t p=0; p<first.size(); p++) {
+				u64 page_rva = (u64)p << bits;
+				while (i < size() && rva_begin[i] < page_rva)
+					i++;
+				first[p] = (u32)i;
+			}
+			page_first.assign(std::move(first));
+		}
+
+		struct PageTableStats {
+			size_t pages;
+			size_t dense_pages;   // with more than PAGE_SCAN_MAX procs, which fall back to rva_search
+			size_t max_procs;     // in a single page
+			size_t bytes;
+		};
+		PageTableStats page_table_stats () const {
+			PageTableStats stats = {};
+			if (page_first.empty())
+				return stats;
+			stats.pages = page_first.size()-1;
+			for (size_t p=0; p<stats.pages; p++) {
+				size_t n = page_first[p+1] - page_first[p];
+				if (n > PAGE_SCAN_MAX) stats.dense_pages++;
+				stats.max_procs = std::max(stats.max_procs, n);
+			}
+			stats.bytes = page_first.size() * sizeof(u32);
+			return stats;
+		}
+
+		size_t memory_size () const {
+			return rva_begin.size() * sizeof(u32) + rva_end.size() * sizeof(u32) + sym_rva.size() * sizeof(u32) + module.size() * sizeof(u16)
+			     + proc.size() * sizeof(u32) + name.size() * sizeof(u32) + strings.size() + page_first.size() * sizeof(u32) + rva_search.memory_size();
+		}
+	};
+private:
+	ProcIndex proc_index;
+	std::once_flag proc_index_built;
+	std::atomic<bool> proc_index_ready = false;
+
+	void build_proc_index (ThreadPool* pool) {
+		if (pool) load_all_modules(*pool);
+		else      load_all_modules();
+
+		// The reference lookup only searches the procs of the module that owns the address (the first section contribution in file order
+		// covering it, like find_section_contribution), and of those returns the first in module order that covers it
+		// So cut every module's procs into the pieces where a proc is the first one covering them, then cut those again into the pieces
+		// of sc_index their module owns, procs folded into other modules by the linker or covered by an earlier proc drop out that way
+		// Everything stays keyed by section id << 32 | section offset like sc_index until the pieces get turned into rvas
+		auto& ci = sc_index;
+		struct Entry {
+			u64 begin, end;
+			u16 module;
+			u32 proc;
+		};
+		std::vector<Entry> entries;
+		for (u32 m=0; m<num_modules(); m++) {
+			auto& mod = modules[m];
+			std::vector<PrioRange> ranges;
+			for (u32 p=0; p<(u32)mod.procsyms.size(); p++) {
+				auto* proc = mod.procsyms[p].proc;
+				if (proc->seg < 1 || proc->seg > sections_sorted.size())
+					continue;
+				// find_procsym compares against off + len as u32, so a proc wrapping around never matches
+				u64 end = std::min((u64)proc->off + proc->len, (u64)sections_sorted[proc->seg-1].size);
+				if (proc->off >= end || (u64)proc->off + proc->len > 0xffffffff)
+					continue;
+				u64 key = (u64)proc->seg << 32;
+				ranges.push_back({ key | proc->off, key | end, p });
+			}
+
+			for (auto& piece : first_match_pieces(std::move(ranges))) {
+				size_t j = ci.search.upper_bound(piece.begin);
+				if (j > 0) j--;
+				for (; j<ci.begin.size() && ci.begin[j] < piece.end; j++) {
+					u64 owner_end = (ci.begin[j] & 0xffffffff00000000) | ci.end[j];
+					if ((u16)section_contributions[ci.contrib[j]].module_index != m)
+						continue;
+					u64 b = std::max(piece.begin, ci.begin[j]), e = std::min(piece.end, owner_end);
+					if (b >= e)
+						continue;
+					if (!entries.empty() && entries.back().end == b && entries.back().module == m && entries.back().proc == piece.prio)
+						entries.back().end = e;
+					else
+						entries.push_back({ b, e, (u16)m, piece.prio });
+				}
+			}
+		}
+		// the pieces of different modules don't overlap, as every address has only one owner
+		std::sort(entries.begin(), entries.end(), [] (Entry const& l, Entry const& r) {
+			return l.begin < r.begin;
+		});
+
+		auto to_rva = [&] (u64 key) { return (u32)sections_sorted[(key >> 32) - 1].base_addr + (u32)key; };
+		std::vector<u32> rva_begin, rva_end, sym_rva, proc;
+		std::vector<u16> module;
+		rva_begin.reserve(entries.size());
+		rva_end  .reserve(entries.size());
+		sym_rva  .reserve(entries.size());
+		module   .reserve(entries.size());
+		proc     .reserve(entries.size());
+		for (auto& e : entries) {
+			auto* ps = modules[e.module].procsyms[e.proc].proc;
+			rva_begin.push_back(to_rva(e.begin));
+			rva_end  .push_back(to_rva(e.end - 1) + 1); // a piece can end right at the end of its section
+			sym_rva  .push_back((u32)sections_sorted[ps->seg-1].base_addr + ps->off);
+			module   .push_back(e.module);
+			proc     .push_back(e.proc);
+		}
+
+		proc_index = {};
+		proc_index.rva_begin.assign(std::move(rva_begin));
+		proc_index.rva_end  .assign(std::move(rva_end));
+		proc_index.sym_rva  .assign(std::move(sym_rva));
+		proc_index.module   .assign(std::move(module));
+		proc_index.proc     .assign(std::move(proc));
+		proc_index.build_search(opt.proc_page_bits);
+		table_bytes += proc_index.memory_size();
+		print_page_table_stats();
+
+		proc_index_ready = true;
+	}
+	void print_page_table_stats () {
+		auto stats = proc_index.page_table_stats();
+		if (!opt.quiet && stats.pages > 0) {
+			printf("Proc page table: %zu pages of %u bytes, %zu dense (through the search layout), at most %zu procs in a page, %.1f KB\n",
+				stats.pages, 1u << proc_index.page_bits, stats.dense_pages, stats.max_procs, (double)stats.bytes / 1024);
+		}
+	}
+public:
+	// Builds the index on first call (loading all modules), safe to call from multiple threads
+	ProcIndex const& get_proc_index (ThreadPool* pool=nullptr) {
+		std::call_once(proc_index_built, [&] () { build_proc_index(pool); });
+		return proc_index;
+	}
+	bool has_proc_index () const {
+		return proc_index_ready;
+	}
+
+	const char* get_proc_name (size_t index_i) {
+		if (!proc_index.name.empty())
+			return &proc_index.strings[proc_index.name[index_i]];
+		return (const char*)modules[proc_index.module[index_i]].procsyms[proc_index.proc[index_i]].proc->name;
+	}
+
+	// Proc found through the proc index, works the same whether the index was built or mapped from the index cache
+	struct IndexedSymbol {
+		const char* name;
+		u32 module;
+		u32 sec_id; // one based
+		u32 sec_raddr; // needed by find_source_loc
+		u32 sym_rva; // start of the proc
+		// every rva in [rva_begin, rva_end) resolves to this same proc, the piece of it rva is in
+		u32 rva_begin, rva_end;
+	};
+	// pass a cursor (starting at 0) to look up ascending rvas with ProcIndex::find_from
+	bool find_symbol_indexed (u32 rva, IndexedSymbol* out, size_t* cursor=nullptr) {
+		auto& index = get_proc_index();
+		s64 i = cursor ? index.find_from(rva, cursor) : index.find(rva);
+		if (i < 0)
+			return false;
+
+		// only procs within their section are indexed, so this always finds one
+		u32 sec_id = 0;
+		auto* sec = find_section_for_addr(rva, &sec_id);
+		assert(sec);
+
+		out->name = get_proc_name((size_t)i);
+		out->module = index.module[i];
+		out->sec_id = sec_id;
+		out->sec_raddr = rva - (u32)sec->base_addr;
+		out->sym_rva = index.sym_rva[i];
+		out->rva_begin = index.rva_begin[i];
+		out->rva_end = index.rva_end[i];
+		return true;
+	}
+
+	// Start of the first indexed proc after rva (or 0xffffffff), how far a public symbol hit holds when no proc covers rva
+	u32 next_indexed_proc_rva (u32 rva) {
+		auto& index = get_proc_index();
+		auto it = std::upper_bound(index.rva_begin.begin(), index.rva_begin.end(), rva);
+		return it != index.rva_begin.end() ? *it : 0xffffffff;
+	}
+
+	static constexpr u32 LINE_SCAN_MAX = 64; // lines of a contribution that are counted with search_layout::count_le instead of binary searched
+	bool find_source_loc (Module& mod, u32 sec_id, u32 sec_raddr, SourceLoc* out_src_loc) {
+		auto& lt = mod.line_table;
+
+		size_t ub = lt.upper_bound((u64)sec_id << 32 | sec_raddr);
+		if (ub == 0)
+			return false;
+		auto& lc = lt.contribs[ub-1];
+		if (lc.sec_id != sec_id || sec_raddr >= lc.sec_offset + lc.size)
+			return false;
+
+		// last line with offset <= address, or the first line if the address is before all of them (like the old scan did)
+		u32 proc_raddr = sec_raddr - lc.sec_offset;
+		auto* offsets = &lt.line_offsets[lc.first_line];
+		u32 i;
+		if (lc.flags & LineContrib::LINES_UNSORTED) {
+			// same as the old scan: first line of the last run of equal offsets before the first line (after the first) past the address
+			i = 0;
+			for (u32 j=1; j<lc.num_lines && offsets[j] <= proc_raddr; j++) {
+				if (offsets[j] != offsets[i])
+					i = j;
+			}
+		}
+		else {
+			i = lc.num_lines <= LINE_SCAN_MAX ? (u32)search_layout::count_le(offsets, lc.num_lines, proc_raddr)
+			                                  : (u32)(std::upper_bound(offsets, offsets + lc.num_lines, proc_raddr) - offsets);
+			i = i > 0 ? i-1 : 0;
+		}
+
+		*out_src_loc = { &names[lc.file], lt.line_numbers[lc.first_line + i], lc.file };
+		return true;
+	}
+	// SourceLoc::file back to the path
+	const char* get_file_name (u32 file) const {
+		return &names[file];
+	}
+
+	struct PublicSymbol {
+		const char* name; // decorated, unlike the proc names
+		u32 sec_id;
+		u32 sec_offset;
+		u32 size; // up to the next public in the section or the section end, publics have no size of their own
+		CV_PUBSYMFLAGS flags;
+	};
+	// Nearest public symbol at or before the address, for addresses no proc covers (modules without private symbols)
+	// Binary searches the PSI address map in the file, so nothing is built for this, the streams are read on first use
+	// Ties at the same address resolve to the first entry in the map
+	bool find_public_symbol (u32 sec_id, u32 sec_raddr, PublicSymbol* out) {
+		std::call_once(global_symbols_loaded, [this] () { read_global_symbols(); });
+
+		auto key_of = [this] (u32 i) -> u64 {
+			auto* sym = get_public(i);
+			return sym ? (u64)sym->seg << 32 | sym->off : 0;
+		};
+		u64 key = (u64)sec_id << 32 | sec_raddr;
+
+		// last entry with key <= address
+		u32 lo = 0, hi = psi_addr_map_count;
+		while (lo < hi) {
+			u32 mid = lo + (hi - lo) / 2;
+			if (key_of(mid) <= key) lo = mid + 1;
+			else                    hi = mid;
+		}
+		if (lo == 0)
+			return false;
+		u32 i = lo - 1;
+		u64 found = key_of(i);
+		if ((u32)(found >> 32) != sec_id)
+			return false;
+		u32 first = i;
+		while (first > 0 && key_of(first-1) == found)
+			first--;
+
+		assert(sec_id >= 1 && sec_id <= sections_sorted.size());
+		auto* sym = get_public(first);
+		u32 end = (u32)sections_sorted[sec_id-1].size;
+		if (lo < psi_addr_map_count && (u32)(key_of(lo) >> 32) == sec_id)
+			end = std::min(end, (u32)key_of(lo));
+		if (sym->off >= end)
+			return false; // past the end of the section
+
+		out->name = (const char*)sym->name;
+		out->sec_id = sec_id;
+		out->sec_offset = sym->off;
+		out->size = end - sym->off;
+		out->flags = sym->pubsymflags;
+		return true;
+	}
+	// The scan find_public_symbol replaces, over every public in the PSI address map without relying on its order
+	bool find_public_symbol_linear (u32 sec_id, u32 sec_raddr, PublicSymbol* out) {
+		std::call_once(global_symbols_loaded, [this] () { read_global_symbols(); });
+		if (sec_id < 1 || sec_id > sections_sorted.size())
+			return false;
+
+		const PUBSYM32* sym = nullptr;
+		u32 end = (u32)sections_sorted[sec_id-1].size;
+		for (u32 i=0; i<psi_addr_map_count; i++) {
+			auto* pub = get_public(i);
+			if (!pub || pub->seg != sec_id)
+				continue;
+			if (pub->off > sec_raddr)
+				end = std::min(end, pub->off);
+			else if (!sym || pub->off > sym->off)
+				sym = pub; // the first of several at the same address
+		}
+		if (!sym || sym->off >= end)
+			return false;
+
+		out->name = (const char*)sym->name;
+		out->sec_id = sec_id;
+		out->sec_offset = sym->off;
+		out->size = end - sym->off;
+		out->flags = sym->pubsymflags;
+		return true;
+	}
+
+	struct NamedSymbol {
+		const char* name;
+		SYM_ENUM_e kind; // S_PUB32, S_GPROC32, S_LPROC32(_ID), S_GDATA32, S_LDATA32, S_GTHREAD32 or S_LTHREAD32
+		u32 sec_id;
+		u32 sec_offset;
+		u32 rva;
+	};
+	// Symbol with exactly this name, procs and data from the GSI first, then publics (which have decorated names) from the PSI
+	// Hashes the name into the on-disk buckets and compares the few records in there, the streams are read on first use
+	// Procs are only found through the publics when loaded from the index cache, as their records are in the module streams
+	bool find_symbol_by_name (std::string_view name, NamedSymbol* out) {
+		std::call_once(global_symbols_loaded, [this] () { read_global_symbols(); });
+		return find_in_symbol_hash(gsi_hash, name, out) || find_in_symbol_hash(psi_hash, name, out);
+	}
+private:
+	bool find_in_symbol_hash (SymbolHashTable const& ht, std::string_view name, NamedSymbol* out) {
+		if (ht.bucket_begin.empty())
+			return false;
+		u32 b = pdb_hash_string_v1(name) % IPHR_HASH;
+		for (u32 i=ht.bucket_begin[b]; i<ht.bucket_begin[b+1]; i++) {
+			u32 offs = ht.records[i].offset - 1;
+			if ((u64)offs + sizeof(codeview_symbol_header) > symbol_records_data.size())
+				continue;
+			auto* sym = (codeview_symbol_header*)(symbol_records_data.data() + offs);
+			if (resolve_global_symbol(sym, name, out))
+				return true;
+		}
+		return false;
+	}
+	bool resolve_global_symbol (const codeview_symbol_header* sym, std::string_view name, NamedSymbol* out) {
+		const char* rec_end = (const char*)sym + sizeof(u16) + sym->length;
+		if (rec_end > symbol_records_data.data() + symbol_records_data.size())
+			return false;
+		auto name_matches = [&] (const unsigned char* sym_name) {
+			auto* str = (const char*)sym_name;
+			return str < rec_end && std::string_view(str, strnlen(str, rec_end - str)) == name;
+		};
+
+		SYM_ENUM_e kind = sym->kind;
+		u32 seg = 0, off = 0;
+		const unsigned char* sym_name = nullptr;
+		switch (sym->kind) {
+			case S_PUB32: {
+				auto* s = (PUBSYM32*)sym;
+				if (!name_matches(s->name)) return false;
+				seg = s->seg; off = s->off; sym_name = s->name;
+			} break;
+			case S_GDATA32: case S_LDATA32: case S_GTHREAD32: case S_LTHREAD32: {
+				auto* s = (DATASYM32*)sym;
+				if (!name_matches(s->name)) return false;
+				seg = s->seg; off = s->off; sym_name = s->name;
+			} break;
+			case S_PROCREF: case S_LPROCREF: {
+				// the actual proc is in the module symbol stream, imod is one based
+				auto* s = (REFSYM2*)sym;
+				if (!name_matches(s->name)) return false;
+				if (from_index_cache || s->imod < 1 || s->imod > modules.size())
+					return false;
+				auto& mod = get_module(s->imod - 1);
+				if ((u64)s->ibSym + sizeof(PROCSYM32) > mod.symbol_stream_data.size())
+					return false;
+				auto* ps = (PROCSYM32*)(mod.symbol_stream_data.data() + s->ibSym);
+				kind = (SYM_ENUM_e)ps->rectyp;
+				seg = ps->seg; off = ps->off; sym_name = s->name;
+			} break;
+			default:
+				return false; // S_CONSTANT, S_UDT etc. have no address
+		}
+
+		if (seg < 1 || seg > sections_sorted.size())
+			return false;
+		out->name = (const char*)sym_name;
+		out->kind = kind;
+		out->sec_id = seg;
+		out->sec_offset = off;
+		out->rva = (u32)sections_sorted[seg-1].base_addr + off;
+		return true;
+	}
+public:
+
+	// Name of an LF_FUNC_ID/LF_MFUNC_ID, the IPI is indexed on first use
+	const char* get_item_name (CV_ItemId id) {
+		std::call_once(ipi_loaded, [this] () { read_IPI(); });
+		if (id < ipi_index_begin || id - ipi_index_begin >= ipi_record_offsets.size())
+			return nullptr;
+		auto* rec = (codeview_func_id*)(IPI_data.data() + ipi_record_offsets[id - ipi_index_begin]);
+		if (rec->kind != LF_FUNC_ID && rec->kind != LF_MFUNC_ID)
+			return nullptr;
+		return rec->name;
+	}
+	const char* get_inlinee_name (Module const& mod, u32 site) {
+		if (!mod.inline_table.site_name.empty())
+			return &proc_index.strings[mod.inline_table.site_name[site]];
+		auto* name = get_item_name(mod.inline_table.sites[site].inlinee);
+		return name ? name : "<unknown inlinee>";
+	}
+
+	struct InlineFrame {
+		const char* name;
+		SourceLoc src; // filepath null if the site has no line info for this address
+	};
+	// Inline frames at the address, innermost first, the last one was inlined directly into the proc
+	// returns the number of frames written, at most max_frames (dropping the outermost ones)
+	u32 find_inline_frames (Module& mod, u32 sec_id, u32 sec_raddr, InlineFrame* out_frames, u32 max_frames) {
+		auto& it = mod.inline_table;
+		if (it.segments.empty() || max_frames == 0)
+			return 0;
+
+		u64 key = (u64)sec_id << 32 | sec_raddr;
+		auto seg = std::upper_bound(it.segments.begin(), it.segments.end(), key, [] (u64 key, InlineSegment const& s) {
+			return key < s.key();
+		});
+		if (seg == it.segments.begin())
+			return 0;
+		--seg;
+		if (key >= seg->key() + seg->size)
+			return 0;
+
+		auto& inner = it.ranges[seg->range];
+		u32 n = 0;
+		out_frames[n++] = { get_inlinee_name(mod, inner.site), { &names[inner.file], inner.line, inner.file } };
+
+		for (u32 s = it.sites[inner.site].parent; s != InlineSite::NO_PARENT && n < max_frames; s = it.sites[s].parent) {
+			auto& site = it.sites[s];
+			// line of the call into the inner frame, from the range of this site containing the address
+			SourceLoc loc = {};
+			auto* first = it.ranges.data() + site.first_range;
+			auto* last = first + site.num_ranges;
+			auto r = std::upper_bound(first, last, key, [] (u64 key, InlineRange const& r) {
+				return key < r.key();
+			});
+			if (r != first && key < (r-1)->key() + (r-1)->size) {
+				loc = { &names[(r-1)->file], (r-1)->line, (r-1)->file };
+			}
+			out_frames[n++] = { get_inlinee_name(mod, s), loc };
+		}
+		return n;
+	}
+
+	// Scans the raw C13 line info for every lookup, kept as reference for the decoded LineTable
+	bool find_source_loc_reference (Module& mod, u32 sec_id, u32 sec_raddr, SourceLoc* out_src_loc) {
+		auto* mi = mod.mi;
+
+		assert(mod.symbol_stream_data.empty() == (mi->stream_index_of_module_symbol_stream == 0xffff));
+		if (mi->stream_index_of_module_symbol_stream == 0xffff) {
+			return false; // no symbol data
+		}
+		char* ptr = mod.symbol_stream_data.data();
+		
+		ptr += mi->byte_size_of_symbol_information;
+		ptr += mi->byte_size_of_c11_line_information;
+		
+		//// C13 line info
+		char* c13_line_information = ptr;
+
+		// first pass to find FILECHKSMS ptr
+		char* filechksms_ptr = nullptr;
+		while (ptr < c13_line_information + mi->byte_size_of_c13_line_information) {
+			auto* header = (codeview_subsection_header*)ptr;
+			ptr += sizeof(codeview_subsection_header);
+
+			if (header->type == DEBUG_S_FILECHKSMS) {
+				filechksms_ptr = ptr;
+				break;
+			}
+			else {
+				ptr += header->length;
+			}
+		}
+		ptr = c13_line_information; // reset ptr
+		
+		while (ptr < c13_line_information + mi->byte_size_of_c13_line_information) {
+			auto* header = (codeview_subsection_header*)ptr;
+			ptr += sizeof(codeview_subsection_header);
+
+			if (header->type == DEBUG_S_LINES) {
+				auto* lines = (codeview_line_header*)ptr;
+				ptr += sizeof(codeview_line_header);
+				assert(lines->flags == 0); // CV_LINES_HAVE_COLUMNS not implemented
+					
+				if (  lines->contribution_section_id == sec_id &&
+					  sec_raddr >= lines->contribution_offset && sec_raddr < lines->contribution_offset + lines->contribution_size) {
+					u32 proc_raddr = sec_raddr - lines->contribution_offset;
+
+					while (ptr < (char*)lines + header->length) {
+						auto* line_block = (codeview_line_block_header*)ptr;
+						ptr += sizeof(codeview_line_block_header);
+						if (line_block->amount_of_lines > 0) {
+							auto* lines = (codeview_line*)ptr;
+
+							// codeview_lines seems to be sorted by offset, ie code address relative to start of function
+							// there is only offset, no size, so I assume any addresses between this offset and the next belong to the line as well
+							// lines can be out of order (earlier instructions belonging to later lines due to compiler optimizations for example)
+							// lines will be missing (empty lines or lines with no generated code)
+							// different entries can have the same line (single line to multiple instruction spans)
+							// the same offset can appear twice with different lines (I guess multiple related lines that do one thing, maybe also when a statement is split over lines?)
+							//  -> this part makes it confusing to resolve line numbers, as we would usually only return one (but go to disassembly and possibly breakpoints need info for each line!)
+							//     tracy should never double count samples, and indeed dbghelp only reports one line, which appears like the lower one
+							//     but it's unclear if the first match in the list is chosen or if the lower line number is actively chosen TODO:
+
+							codeview_line* prev_line_with_lower_offset = &lines[0];
+							for (u32 i=1; i<line_block->amount_of_lines; i++) {
+								auto* line = &lines[i];
+
+								// scan all lines and pick lowest lineno TODO: this could probably be simplified/accelerated by first deduplicating lines and storing the list of end addresses instead
+								if (proc_raddr < line->offset) {
+									// proc_raddr is in range [prev_offset, offset), so it belongs to all instructions with prev_offset
+									// prev_line_with_lower_offset is the first one of these (lowest line number?)
+									break;
+								}
+								if (line->offset != prev_line_with_lower_offset->offset)
+									prev_line_with_lower_offset = line;
+							}
+							codeview_line* found_line = prev_line_with_lower_offset;
+
+							auto* cksm = (codeview_file_checksum*)(filechksms_ptr + line_block->offset_in_file_checksums);
+							auto* name = &names[cksm->offset_in_string_table];
+
+							*out_src_loc = { name, found_line->start_line_number, cksm->offset_in_string_table };
+							return true;
+						}
+					}
+					assert(ptr == (char*)lines + header->length);
+				}
+			}
+			
+			ptr = (char*)header + sizeof(codeview_subsection_header) + header->length;
+		}
+		return false;
+	}
+
+private:
+	// <cache_dir>/<name>.pdb/<GUID><age>/<name>.pdb.bdhidx like the symbol store layout,
+	// so the many PDBs called app.pdb or vc140.pdb don't keep replacing each other's cache
+	static std::string index_cache_path (std::string const& cache_dir, std::string const& pdb_path, GUID const& guid, u32 age) {
+		auto name = std::filesystem::path(pdb_path).filename();
+		char id[48];
+		snprintf(id, sizeof(id), "%08X%04X%04X%02X%02X%02X%02X%02X%02X%02X%02X%X", guid.Data1, guid.Data2, guid.Data3,
+			guid.Data4[0], guid.Data4[1], guid.Data4[2], guid.Data4[3], guid.Data4[4], guid.Data4[5], guid.Data4[6], guid.Data4[7], age);
+		return (std::filesystem::path(cache_dir) / name / id / name).string() + ".bdhidx";
+	}
+
+	// The reader only checks that the arrays are inside the file, this checks every index stored in them,
+	// so a corrupted cache with the right GUID and age gets rebuilt instead of reading outside the mapping
+	bool check_index_cache () const {
+		auto& ic = index_cache;
+		u32 num_mods = ic.get_header().num_modules;
+
+		if (ic.count<index_cache_module_lines>(ICA_MODULE_LINES) != num_mods ||
+		    ic.count<index_cache_module_inlines>(ICA_MODULE_INLINES) != num_mods)
+			return false;
+
+		// names are looked up as C strings, so both string buffers have to end in a null
+		size_t num_names = ic.count<char>(ICA_NAMES), num_strings = ic.count<char>(ICA_STRINGS);
+		if ((num_names   > 0 && ic.get<char>(ICA_NAMES)  [num_names-1]   != '\0') ||
+		    (num_strings > 0 && ic.get<char>(ICA_STRINGS)[num_strings-1] != '\0'))
+			return false;
+		auto in_range = [] (u64 first, u64 num, u64 size) { return first + num <= size; };
+
+		size_t num_procs = ic.count<u32>(ICA_PROC_RVA_BEGIN);
+		if (ic.count<u32>(ICA_PROC_RVA_END) != num_procs || ic.count<u32>(ICA_PROC_SYM_RVA) != num_procs ||
+		    ic.count<u16>(ICA_PROC_MODULE) != num_procs || ic.count<u32>(ICA_PROC_NAME) != num_procs)
+			return false;
+		auto* proc_begin  = ic.get<u32>(ICA_PROC_RVA_BEGIN);
+		auto* proc_end    = ic.get<u32>(ICA_PROC_RVA_END);
+		auto* proc_sym    = ic.get<u32>(ICA_PROC_SYM_RVA);
+		auto* proc_module = ic.get<u16>(ICA_PROC_MODULE);
+		auto* proc_name   = ic.get<u32>(ICA_PROC_NAME);
+		// the searches need the pieces sorted and not overlapping, and find_symbol_indexed relies on every piece being inside a section
+		auto* secs = ic.get<index_cache_section>(ICA_SECTIONS);
+		size_t num_secs = ic.count<index_cache_section>(ICA_SECTIONS);
+		for (size_t i=1; i<num_secs; i++) {
+			if (secs[i].rva < (u64)secs[i-1].rva + secs[i-1].size)
+				return false;
+		}
+		size_t sec = 0;
+		for (size_t i=0; i<num_procs; i++) {
+			if (proc_module[i] >= num_mods || proc_name[i] >= num_strings)
+				return false;
+			if ((i > 0 && proc_begin[i] < proc_end[i-1]) || proc_end[i] <= proc_begin[i] || proc_sym[i] > proc_begin[i])
+				return false;
+			while (sec < num_secs && proc_begin[i] >= (u64)secs[sec].rva + secs[sec].size)
+				sec++;
+			if (sec == num_secs || proc_begin[i] < secs[sec].rva || proc_end[i] > (u64)secs[sec].rva + secs[sec].size)
+				return false;
+		}
+
+		auto* contribs  = ic.get<LineContrib>(ICA_LINE_CONTRIBS);
+		auto* mod_lines = ic.get<index_cache_module_lines>(ICA_MODULE_LINES);
+		size_t num_lines = ic.count<u32>(ICA_LINE_OFFSETS);
+		if (ic.count<u32>(ICA_LINE_NUMBERS) != num_lines)
+			return false;
+		for (u32 i=0; i<num_mods; i++) {
+			auto& ml = mod_lines[i];
+			if (!in_range(ml.first_contrib, ml.num_contribs, ic.count<LineContrib>(ICA_LINE_CONTRIBS)) || !in_range(ml.first_line, ml.num_lines, num_lines))
+				return false;
+			for (u32 c=0; c<ml.num_contribs; c++) {
+				auto& lc = contribs[ml.first_contrib + c];
+				if (lc.file >= num_names || !in_range(lc.first_line, lc.num_lines, ml.num_lines))
+					return false;
+			}
+		}
+
+		auto* sites       = ic.get<InlineSite>(ICA_INLINE_SITES);
+		auto* site_names  = ic.get<u32>(ICA_INLINE_SITE_NAME);
+		auto* inl_ranges  = ic.get<InlineRange>(ICA_INLINE_RANGES);
+		auto* segments    = ic.get<InlineSegment>(ICA_INLINE_SEGMENTS);
+		auto* mod_inlines = ic.get<index_cache_module_inlines>(ICA_MODULE_INLINES);
+		size_t num_sites = ic.count<InlineSite>(ICA_INLINE_SITES);
+		if (ic.count<u32>(ICA_INLINE_SITE_NAME) != num_sites)
+			return false;
+		for (u32 i=0; i<num_mods; i++) {
+			auto& mi = mod_inlines[i];
+			if (!in_range(mi.first_site, mi.num_sites, num_sites) ||
+			    !in_range(mi.first_range, mi.num_ranges, ic.count<InlineRange>(ICA_INLINE_RANGES)) ||
+			    !in_range(mi.first_segment, mi.num_segments, ic.count<InlineSegment>(ICA_INLINE_SEGMENTS)))
+				return false;
+			for (u32 s=0; s<mi.num_sites; s++) {
+				auto& site = sites[mi.first_site + s];
+				if ((site.parent != InlineSite::NO_PARENT && site.parent >= mi.num_sites) ||
+				    !in_range(site.first_range, site.num_ranges, mi.num_ranges) || site_names[mi.first_site + s] >= num_strings)
+					return false;
+			}
+			for (u32 r=0; r<mi.num_ranges; r++) {
+				auto& range = inl_ranges[mi.first_range + r];
+				if (range.site >= mi.num_sites || range.file >= num_names)
+					return false;
+			}
+			for (u32 g=0; g<mi.num_segments; g++) {
+				if (segments[mi.first_segment + g].range >= mi.num_ranges)
+					return false;
+			}
+		}
+		return true;
+	}
+
+	bool load_index_cache (std::string const& cache_path) {
+		if (!index_cache.open(cache_path, (const u8*)&info->guid, info->age))
+			return false;
+		if (!check_index_cache()) {
+			index_cache.close(); // windows won't let write_index_cache replace it while mapped
+			return false;
+		}
+		auto& ic = index_cache;
+		u32 num_mods = ic.get_header().num_modules;
+
+		auto* secs = ic.get<index_cache_section>(ICA_SECTIONS);
+		for (size_t i=0; i<ic.count<index_cache_section>(ICA_SECTIONS); i++) {
+			sections_sorted.push_back({ std::string(secs[i].name, strnlen(secs[i].name, 8)), secs[i].rva, secs[i].size });
+		}
+
+		names = ic.get<char>(ICA_NAMES);
+		names_size = (u32)ic.count<char>(ICA_NAMES);
+
+		auto* contribs = ic.get<LineContrib>(ICA_LINE_CONTRIBS);
+		auto* offsets  = ic.get<u32>(ICA_LINE_OFFSETS);
+		auto* numbers  = ic.get<u32>(ICA_LINE_NUMBERS);
+		auto* mod_lines = ic.get<index_cache_module_lines>(ICA_MODULE_LINES);
+
+		auto* sites       = ic.get<InlineSite>(ICA_INLINE_SITES);
+		auto* site_names  = ic.get<u32>(ICA_INLINE_SITE_NAME);
+		auto* inl_ranges  = ic.get<InlineRange>(ICA_INLINE_RANGES);
+		auto* segments    = ic.get<InlineSegment>(ICA_INLINE_SEGMENTS);
+		auto* mod_inlines = ic.get<index_cache_module_inlines>(ICA_MODULE_INLINES);
+
+		modules = std::vector<Module>(num_mods);
+		for (u32 i=0; i<num_mods; i++) {
+			auto& ml = mod_lines[i];
+			auto& mod = modules[i];
+			mod.line_table.contribs.view(contribs + ml.first_contrib, ml.num_contribs);
+			mod.line_table.line_offsets.view(offsets + ml.first_line, ml.num_lines);
+			mod.line_table.line_numbers.view(numbers + ml.first_line, ml.num_lines);
+			mod.line_table.build_search();
+			table_bytes += mod.line_table.contrib_keys.size() * sizeof(u64) + mod.line_table.contrib_search.memory_size();
+
+			auto& mi = mod_inlines[i];
+			mod.inline_table.sites.view(sites + mi.first_site, mi.num_sites);
+			mod.inline_table.site_name.view(site_names + mi.first_site, mi.num_sites);
+			mod.inline_table.ranges.view(inl_ranges + mi.first_range, mi.num_ranges);
+			mod.inline_table.segments.view(segments + mi.first_segment, mi.num_segments);
+
+			std::call_once(mod.loaded, [] () {}); // nothing left to load
+		}
+
+		ic.view(ICA_PROC_RVA_BEGIN, &proc_index.rva_begin);
+		ic.view(ICA_PROC_RVA_END,   &proc_index.rva_end);
+		ic.view(ICA_PROC_SYM_RVA,   &proc_index.sym_rva);
+		ic.view(ICA_PROC_MODULE,    &proc_index.module);
+		ic.view(ICA_PROC_NAME,      &proc_index.name);
+		ic.view(ICA_STRINGS,        &proc_index.strings);
+		proc_index.build_search(opt.proc_page_bits); // not in the cache, it's cheap and the page table depends on the options
+		table_bytes += proc_index.page_first.size() * sizeof(u32) + proc_index.rva_search.memory_size();
+		print_page_table_stats();
+		std::call_once(proc_index_built, [] () {});
+		proc_index_ready = true;
+
+		from_index_cache = true;
+		return true;
+	}
+
+	bool write_index_cache (std::string const& cache_path) {
+		auto& index = get_proc_index();
+
+		IndexCacheWriter w((const u8*)&info->guid, info->age, num_modules());
+
+		std::vector<index_cache_section> secs;
+		for (auto& sec : sections_sorted) {
+			index_cache_section s = {};
+			memcpy(s.name, sec.name.data(), std::min(sec.name.size(), sizeof(s.name)));
+			s.rva = (u32)sec.base_addr;
+			s.size = (u32)sec.size;
+			secs.push_back(s);
+		}
+		w.add(ICA_SECTIONS, secs);
+
+		std::vector<u32> name_offsets(index.size());
+		std::vector<char> strings;
+		for (size_t i=0; i<index.size(); i++) {
+			const char* name = get_proc_name(i);
+			name_offsets[i] = (u32)strings.size();
+			strings.insert(strings.end(), name, name + strlen(name)+1);
+		}
+		w.add(ICA_PROC_RVA_BEGIN, index.rva_begin);
+		w.add(ICA_PROC_RVA_END, index.rva_end);
+		w.add(ICA_PROC_SYM_RVA, index.sym_rva);
+		w.add(ICA_PROC_MODULE, index.module);
+		w.add(ICA_PROC_NAME, name_offsets);
+
+		std::vector<index_cache_module_lines> mod_lines;
+		std::vector<LineContrib> contribs;
+		std::vector<u32> offsets, numbers;
+		for (u32 i=0; i<num_modules(); i++) {
+			auto& lt = get_module(i).line_table;
+			mod_lines.push_back({ (u32)contribs.size(), (u32)lt.contribs.size(), (u32)offsets.size(), (u32)lt.line_offsets.size() });
+			contribs.insert(contribs.end(), lt.contribs.begin(), lt.contribs.end());
+			offsets .insert(offsets .end(), lt.line_offsets.begin(), lt.line_offsets.end());
+			numbers .insert(numbers .end(), lt.line_numbers.begin(), lt.line_numbers.end());
+		}
+		w.add(ICA_MODULE_LINES, mod_lines);
+		w.add(ICA_LINE_CONTRIBS, contribs);
+		w.add(ICA_LINE_OFFSETS, offsets);
+		w.add(ICA_LINE_NUMBERS, numbers);
+
+		// inlinee names go into the same string pool as the proc names
+		std::vector<index_cache_module_inlines> mod_inlines;
+		std::vector<InlineSite> sites;
+		std::vector<u32> site_names;
+		std::vector<InlineRange> inl_ranges;
+		std::vector<InlineSegment> segments;
+		for (u32 i=0; i<num_modules(); i++) {
+			auto& mod = get_module(i);
+			auto& it = mod.inline_table;
+			mod_inlines.push_back({ (u32)sites.size(), (u32)it.sites.size(), (u32)inl_ranges.size(), (u32)it.ranges.size(),
+				(u32)segments.size(), (u32)it.segments.size() });
+			for (u32 s=0; s<(u32)it.sites.size(); s++) {
+				const char* name = get_inlinee_name(mod, s);
+				site_names.push_back((u32)strings.size());
+				strings.insert(strings.end(), name, name + strlen(name)+1);
+			}
+			sites     .insert(sites     .end(), it.sites.begin(), it.sites.end());
+			inl_ranges.insert(inl_ranges.end(), it.ranges.begin(), it.ranges.end());
+			segments  .insert(segments  .end(), it.segments.begin(), it.segments.end());
+		}
+		w.add(ICA_MODULE_INLINES, mod_inlines);
+		w.add(ICA_INLINE_SITES, sites);
+		w.add(ICA_INLINE_SITE_NAME, site_names);
+		w.add(ICA_INLINE_RANGES, inl_ranges);
+		w.add(ICA_INLINE_SEGMENTS, segments);
+
+		w.add(ICA_STRINGS, strings);
+
+		w.add(ICA_NAMES, names, names_size);
+
+		return w.write(cache_path);
+	}
+
+public:
+	bool is_from_index_cache () const {
+		return from_index_cache;
+	}
+	LoadTimes const& get_load_times () const {
+		return load_times;
+	}
+	Identity get_identity () const {
+		Identity id;
+		memcpy(id.guid, &info->guid, sizeof(id.guid));
+		id.age = info->age;
+		return id;
+	}
+
+	static std::unique_ptr<PDB_File> try_load_pdb (std::string&& path) {
+		return try_load_pdb(std::move(path), Options());
+	}
+	static std::unique_ptr<PDB_File> try_load_pdb (std::string&& path, Options const& opt) {
+		try {
+			return std::make_unique<PDB_File>(std::move(path), opt);
+		} catch (std::exception&) {
+			//fprintf(stderr, "PDB loading exception: %s\n", ex.what());
+		}
+		return nullptr;
+	}
+	PDB_File (std::string&& path): PDB_File(std::move(path), Options()) {}
+	PDB_File (std::string&& path, Options const& opt): opt{opt} {
+		auto t = Timer::start();
+		auto lap = [&t] () {
+			float sec = t.elapsed_sec();
+			t = Timer::start();
+			return sec;
+		};
+
+		if (opt.map_file) {
+			if (!mapped.open(path)) {
+				throw std::runtime_error("File not found: "+ path);
+			}
+			file_data = mapped.data();
+			file_size = mapped.size();
+		}
+		else {
+			if (!load_file(path, &file_buffer)) {
+				throw std::runtime_error("File not found: "+ path);
+			}
+			file_data = file_buffer.data();
+			file_size = file_buffer.size();
+		}
+
+		load_times.file_sec = lap();
+
+		read_header();
+		read_stream_table();
+		read_pdb_info();
+		load_times.stream_table_sec = lap();
+		if (opt.info_only)
+			return;
+
+		if (!opt.quiet) printf("%s data loaded\n", path.c_str());
+
+		// the info stream is all we need to check the cache against
+		std::string cache_path;
+		if (!opt.index_cache_dir.empty()) {
+			cache_path = index_cache_path(opt.index_cache_dir, path, info->guid, info->age);
+			bool loaded = load_index_cache(cache_path);
+			load_times.index_cache_sec = lap();
+			if (loaded) {
+				if (!opt.quiet) printf("PDB index mapped from %s\n", cache_path.c_str());
+				return;
+			}
+		}
+
+		read_names();
+		read_DBI();
+		
+		assert(opt_streams->stream_index_of_section_header_dump != 0xFFFF);
+		read_section_header_dump();
+		load_times.dbi_sec = lap();
+
+		bool build_index = opt.proc_index || !cache_path.empty();
+
+		// the GSI/PSI are only needed for the public symbol fallback and name lookups, which read them on first use,
+		// so building the index alone doesn't touch them, a full load reads their headers and hash tables up front (the records are never walked)
+		auto read_globals = [this] () { std::call_once(global_symbols_loaded, [this] () { read_global_symbols(); }); };
+		if (!opt.lazy_modules || build_index) {
+			if (opt.load_threads != 1) {
+				ThreadPool pool(opt.load_threads);
+				if (!opt.lazy_modules) pool.push(read_globals);
+				load_all_modules(pool);
+				load_times.modules_sec = lap();
+				if (build_index) get_proc_index(&pool);
+				load_times.index_sec = lap();
+			}
+			else {
+				load_all_modules();
+				if (!opt.lazy_modules) read_globals();
+				load_times.modules_sec = lap();
+				if (build_index) get_proc_index();
+				load_times.index_sec = lap();
+			}
+		}
+
+		if (!cache_path.empty()) {
+			if (!write_index_cache(cache_path))
+				fprintf(stderr, "Could not write index cache %s\n", cache_path.c_str());
+			load_times.index_cache_sec += lap();
+		}
+
+		if (!opt.quiet) printf("PDB read.\n");
+	}
+};
+
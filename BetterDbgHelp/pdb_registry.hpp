@@ -0,0 +1,84 @@
+#pragma once
+#include "pdb_file.hpp"
+#include <map>
+
+// Process-wide registry of loaded PDBs keyed by GUID and age
+// Resolvers for several processes that load the same DLLs then share one PDB_File per unique PDB,
+// instead of parsing and holding it once per process
+// Only weak_ptrs are kept here, a PDB is freed once the last LoadedModule using it is gone
+class PdbRegistry {
+	struct Slot {
+		std::mutex load_mutex; // held while loading, so concurrent requests for the same PDB wait for a single load
+		std::weak_ptr<PDB_File> pdb; // written with both load_mutex and mutex held
+	};
+	std::mutex mutex;
+	std::map<PDB_File::Identity, std::shared_ptr<Slot>> slots;
+	std::atomic<bool> sharing = true;
+
+	// drop slots of freed PDBs that nobody is loading into right now
+	void prune () {
+		for (auto it = slots.begin(); it != slots.end();) {
+			if (it->second->pdb.expired() && it->second.use_count() == 1) it = slots.erase(it);
+			else                                                           ++it;
+		}
+	}
+public:
+	static PdbRegistry& global () {
+		static PdbRegistry registry;
+		return registry;
+	}
+
+	// off loads every PDB separately, to compare against
+	void set_sharing (bool enable) {
+		sharing = enable;
+	}
+
+	// PDB_File for path, shared with everyone who acquired the same PDB (by GUID and age, not path) before
+	// The options of the first load win, except that proc_index gets built on the shared PDB if asked for
+	std::shared_ptr<PDB_File> acquire (std::string const& path, PDB_File::Options const& opt) {
+		if (!sharing)
+			return PDB_File::try_load_pdb(std::string(path), opt);
+
+		// only maps the file and reads the info stream
+		PDB_File::Options probe_opt = opt;
+		probe_opt.info_only = true;
+		auto probe = PDB_File::try_load_pdb(std::string(path), probe_opt);
+		if (!probe)
+			return nullptr;
+		auto id = probe->get_identity();
+		probe = nullptr;
+
+		std::shared_ptr<Slot> slot;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			prune();
+			auto& s = slots[id];
+			if (!s) s = std::make_shared<Slot>();
+			slot = s;
+		}
+
+		std::lock_guard<std::mutex> lock(slot->load_mutex);
+		if (auto pdb = slot->pdb.lock()) {
+			if (opt.proc_index)
+				pdb->get_proc_index();
+			return pdb;
+		}
+
+		std::shared_ptr<PDB_File> pdb = PDB_File::try_load_pdb(std::string(path), opt);
+		if (pdb && pdb->get_identity() == id) { // the file could have been replaced since the probe
+			std::lock_guard<std::mutex> lock(mutex); // prune and num_loaded read it under that one
+			slot->pdb = pdb;
+		}
+		return pdb;
+	}
+
+	// PDBs currently alive
+	size_t num_loaded () {
+		std::lock_guard<std::mutex> lock(mutex);
+		size_t n = 0;
+		for (auto& it : slots) {
+			if (!it.second->pdb.expired()) n++;
+		}
+		return n;
+	}
+};
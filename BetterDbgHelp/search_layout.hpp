@@ -0,0 +1,294 @@
+#pragma once
+#include "util.hpp"
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+#if defined(__x86_64__) || defined(_M_X64)
+	#define SEARCH_LAYOUT_X64 1
+	#include <immintrin.h>
+	#if defined(_MSC_VER)
+		#define SEARCH_TARGET_AVX2
+	#else
+		#define SEARCH_TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#endif
+
+// Layouts for searching sorted key arrays (rvas or section:offset keys)
+// std::upper_bound jumps all over a big array, so every step of the search misses the cache, these lay the keys out so the steps stay close together
+// They are template policies with the same interface, PDB_File uses SearchLayout (picked with PDB_SEARCH_LAYOUT at compile time),
+// and PdbBench instantiates all of them over the same arrays to compare them
+//
+//   build(keys, n)     keys sorted ascending, they are not copied (except by EytzingerSearch), so they have to stay where they are
+//   upper_bound(key)   index of the first key > key in the sorted keys, n if there is none, like std::upper_bound
+//   memory_size()      bytes used in addition to the keys
+
+namespace search_layout {
+	inline void prefetch (const void* ptr) {
+	#if defined(_MSC_VER)
+		_mm_prefetch((const char*)ptr, _MM_HINT_T0);
+	#else
+		__builtin_prefetch(ptr);
+	#endif
+	}
+	inline uint32_t trailing_ones (uint64_t x) {
+		x = ~x;
+	#if defined(_MSC_VER)
+		unsigned long i;
+		return _BitScanForward64(&i, x) ? (uint32_t)i : 64;
+	#else
+		return x ? (uint32_t)__builtin_ctzll(x) : 64;
+	#endif
+	}
+
+	// Keys in a std::vector with the first one on a cache line boundary
+	template <typename T>
+	struct AlignedKeys {
+		std::vector<T> storage;
+		T* ptr = nullptr;
+
+		void resize (size_t n) {
+			constexpr size_t PAD = 64 / sizeof(T);
+			storage.assign(n + PAD, T{});
+			ptr = storage.data();
+			while ((uintptr_t)ptr % 64 != 0) ptr++;
+		}
+	};
+
+	// Which count_le kernel runs, detected once on startup
+	// can be lowered (never raised above what the cpu has) to compare the kernels, like PdbBench -simd does
+	enum SimdLevel { SIMD_SCALAR, SIMD_SSE2, SIMD_AVX2 };
+	inline SimdLevel detect_simd () {
+	#if defined(SEARCH_LAYOUT_X64)
+		#if defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 1);
+			bool os_avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6; // OSXSAVE, AVX and the OS saves ymm
+			__cpuidex(info, 7, 0);
+			if (os_avx && (info[1] & (1 << 5)))
+				return SIMD_AVX2;
+		#else
+			if (__builtin_cpu_supports("avx2"))
+				return SIMD_AVX2;
+		#endif
+		return SIMD_SSE2; // part of x64
+	#else
+		return SIMD_SCALAR;
+	#endif
+	}
+	inline SimdLevel simd_level = detect_simd();
+	inline const char* simd_level_name (SimdLevel level) {
+		return level == SIMD_AVX2 ? "avx2" : level == SIMD_SSE2 ? "sse2" : "scalar";
+	}
+
+	// Number of keys <= key, which for sorted keys is their upper_bound
+	// the leaf scan of every index: B+-tree nodes, page table pages and the lines of a contribution
+	template <typename T>
+	inline size_t count_le_scalar (const T* keys, size_t n, T key) {
+		size_t c = 0;
+		for (size_t i=0; i<n; i++)
+			c += keys[i] <= key;
+		return c;
+	}
+
+#if defined(SEARCH_LAYOUT_X64)
+	// There are only signed compares, flipping the sign bit of both sides makes them compare like unsigned
+	// a compare gives -1 in every lane that is greater, subtracting those counts them per lane until the sum at the end
+	inline size_t count_le_sse2 (const uint32_t* keys, size_t n, uint32_t key) {
+		const __m128i bias = _mm_set1_epi32((int)0x80000000);
+		const __m128i k = _mm_xor_si128(_mm_set1_epi32((int)key), bias);
+		__m128i greater = _mm_setzero_si128();
+		size_t i = 0;
+		for (; i+4 <= n; i+=4) {
+			__m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(keys + i)), bias);
+			greater = _mm_sub_epi32(greater, _mm_cmpgt_epi32(v, k));
+		}
+		greater = _mm_add_epi32(greater, _mm_shuffle_epi32(greater, 0x4e));
+		greater = _mm_add_epi32(greater, _mm_shuffle_epi32(greater, 0xb1));
+		size_t c = i - (uint32_t)_mm_cvtsi128_si32(greater);
+		return c + count_le_scalar(keys + i, n - i, key);
+	}
+	SEARCH_TARGET_AVX2 inline size_t count_le_avx2 (const uint32_t* keys, size_t n, uint32_t key) {
+		const __m256i bias = _mm256_set1_epi32((int)0x80000000);
+		const __m256i k = _mm256_xor_si256(_mm256_set1_epi32((int)key), bias);
+		__m256i greater = _mm256_setzero_si256();
+		size_t i = 0;
+		for (; i+8 <= n; i+=8) {
+			__m256i v = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(keys + i)), bias);
+			greater = _mm256_sub_epi32(greater, _mm256_cmpgt_epi32(v, k));
+		}
+		__m128i sum = _mm_add_epi32(_mm256_castsi256_si128(greater), _mm256_extracti128_si256(greater, 1));
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+		size_t c = i - (uint32_t)_mm_cvtsi128_si32(sum);
+		return c + count_le_scalar(keys + i, n - i, key);
+	}
+	// 64 bit compares need SSE4.2 or AVX2, so there is no SSE2 version of this one
+	SEARCH_TARGET_AVX2 inline size_t count_le_avx2 (const uint64_t* keys, size_t n, uint64_t key) {
+		const __m256i bias = _mm256_set1_epi64x((long long)0x8000000000000000ull);
+		const __m256i k = _mm256_xor_si256(_mm256_set1_epi64x((long long)key), bias);
+		__m256i greater = _mm256_setzero_si256();
+		size_t i = 0;
+		for (; i+4 <= n; i+=4) {
+			__m256i v = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(keys + i)), bias);
+			greater = _mm256_sub_epi64(greater, _mm256_cmpgt_epi64(v, k));
+		}
+		__m128i sum = _mm_add_epi64(_mm256_castsi256_si128(greater), _mm256_extracti128_si256(greater, 1));
+		sum = _mm_add_epi64(sum, _mm_unpackhi_epi64(sum, sum));
+		size_t c = i - (size_t)_mm_cvtsi128_si64(sum);
+		return c + count_le_scalar(keys + i, n - i, key);
+	}
+#endif
+
+	template <typename T>
+	inline size_t count_le (const T* keys, size_t n, T key) {
+		return count_le_scalar(keys, n, key);
+	}
+	inline size_t count_le (const uint32_t* keys, size_t n, uint32_t key) {
+	#if defined(SEARCH_LAYOUT_X64)
+		if (simd_level == SIMD_AVX2) return count_le_avx2(keys, n, key);
+		if (simd_level == SIMD_SSE2) return count_le_sse2(keys, n, key);
+	#endif
+		return count_le_scalar(keys, n, key);
+	}
+	inline size_t count_le (const uint64_t* keys, size_t n, uint64_t key) {
+	#if defined(SEARCH_LAYOUT_X64)
+		if (simd_level == SIMD_AVX2) return count_le_avx2(keys, n, key);
+	#endif
+		return count_le_scalar(keys, n, key);
+	}
+}
+
+// Plain binary search of the sorted keys
+template <typename T>
+class SortedSearch {
+	const T* keys = nullptr;
+	size_t n = 0;
+public:
+	void build (const T* keys, size_t n) {
+		this->keys = keys;
+		this->n = n;
+	}
+	size_t upper_bound (T key) const {
+		return std::upper_bound(keys, keys + n, key) - keys;
+	}
+	size_t memory_size () const { return 0; }
+};
+
+// Keys copied into breadth first order of the implicit binary search tree (children of k at 2k and 2k+1)
+// so the first levels of every search share the same few cache lines, and the descendants 4 levels down (one cache line of them) are prefetched
+// Costs a copy of the keys plus their sorted index
+template <typename T>
+class EytzingerSearch {
+	search_layout::AlignedKeys<T> tree; // 1 based, tree.ptr[0] unused
+	std::vector<uint32_t> sorted_index; // of each tree node
+	size_t n = 0;
+
+	void fill (const T* keys, size_t* i, size_t k) {
+		if (k > n) return;
+		fill(keys, i, 2*k);
+		sorted_index[k] = (uint32_t)*i;
+		tree.ptr[k] = keys[(*i)++];
+		fill(keys, i, 2*k+1);
+	}
+public:
+	void build (const T* keys, size_t n) {
+		this->n = n;
+		tree.resize(n+1);
+		sorted_index.assign(n+1, 0);
+		size_t i = 0;
+		fill(keys, &i, 1);
+	}
+	size_t upper_bound (T key) const {
+		constexpr size_t PER_LINE = 64 / sizeof(T);
+		size_t k = 1;
+		while (k <= n) {
+			search_layout::prefetch((const char*)tree.ptr + k * PER_LINE * sizeof(T));
+			k = 2*k + (tree.ptr[k] <= key);
+		}
+		// k went right (1 bits) after the last node > key, drop those and the left step to get back to it
+		k >>= search_layout::trailing_ones(k) + 1;
+		return k == 0 ? n : sorted_index[k];
+	}
+	size_t memory_size () const {
+		return tree.storage.size() * sizeof(T) + sorted_index.size() * sizeof(uint32_t);
+	}
+};
+
+// Static B+-tree with 64 byte nodes, the leaves are the sorted keys themselves, the levels above them hold the first key of every leaf (or node) below
+// A search scans one node per level, so a million keys take 5 cache lines instead of 20 scattered ones, and it only costs 1/15th of the keys on top
+// Arrays of a few nodes (like the line contribs of one module) are binary searched, the separate node levels would only add cache misses there
+template <typename T>
+class BTreeSearch {
+	static constexpr size_t B = 64 / sizeof(T); // keys per node
+	static constexpr size_t SMALL = 4 * B;
+	static constexpr size_t MAX_LEVELS = 16; // 8 keys per node still covers 2^48 keys
+
+	struct Level {
+		const T* keys;
+		size_t n;
+	};
+	const T* keys = nullptr;
+	size_t n = 0;
+	search_layout::AlignedKeys<T> storage;
+	Level levels[MAX_LEVELS]; // top level (a single node) first, the leaves are not in here
+	size_t num_levels = 0;
+
+	static size_t scan (Level const& level, size_t node, T key) {
+		size_t first = node * B;
+		if (level.n - first >= B)
+			return search_layout::count_le(level.keys + first, B, key);
+		return search_layout::count_le(level.keys + first, level.n - first, key);
+	}
+public:
+	void build (const T* keys, size_t n) {
+		this->keys = keys;
+		this->n = n;
+		num_levels = 0;
+		storage = {};
+		if (n <= SMALL)
+			return;
+
+		// sizes of the levels above the leaves, bottom up, each one padded to whole nodes so they all start on a cache line
+		std::vector<size_t> sizes;
+		for (size_t below = n; below > B; ) {
+			below = (below + B-1) / B;
+			sizes.push_back(below);
+		}
+		size_t total = 0;
+		for (auto s : sizes) total += (s + B-1) / B * B;
+		storage.resize(total);
+
+		assert(sizes.size() <= MAX_LEVELS);
+		T* out = storage.ptr;
+		Level below = { keys, n };
+		num_levels = sizes.size();
+		for (size_t l=0; l<num_levels; l++) {
+			size_t s = sizes[l];
+			for (size_t i=0; i<s; i++)
+				out[i] = below.keys[i * B];
+			below = levels[num_levels-1 - l] = { out, s };
+			out += (s + B-1) / B * B;
+		}
+	}
+	size_t upper_bound (T key) const {
+		if (n <= SMALL)
+			return std::upper_bound(keys, keys + n, key) - keys;
+		size_t node = 0;
+		for (size_t l=0; l<num_levels; l++) {
+			size_t c = scan(levels[l], node, key);
+			if (c == 0)
+				return 0; // only possible in the top level, below it the first key of the node is the one we came through
+			node = node * B + c-1;
+		}
+		return node * B + scan({ keys, n }, node, key);
+	}
+	size_t memory_size () const {
+		return storage.storage.size() * sizeof(T);
+	}
+};
+
+#ifndef PDB_SEARCH_LAYOUT
+	#define PDB_SEARCH_LAYOUT BTreeSearch
+#endif
+template <typename T> using SearchLayout = PDB_SEARCH_LAYOUT<T>;
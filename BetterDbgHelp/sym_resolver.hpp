@@ -1,1381 +1,367 @@
 #pragma once
 #include "util.hpp"
+#include "pdb_file.hpp"
+#include "pdb_registry.hpp"
+#include "hazard_ptr.hpp"
+#include "module_map.hpp"
 
-#include <psapi.h>
-#pragma comment(lib, "Kernel32.lib")
-
-#include <unordered_map>
-
-typedef uint8_t u8;
-typedef int16_t s16;
-typedef uint16_t u16;
-typedef int32_t s32;
-typedef uint32_t u32;
-
-typedef unsigned long   CV_uoff32_t;
-typedef          long   CV_off32_t;
-typedef unsigned short  CV_uoff16_t;
-typedef          short  CV_off16_t;
-typedef unsigned short  CV_typ16_t;
-typedef unsigned long   CV_typ_t;
-typedef unsigned long   CV_pubsymflag_t;    // must be same as CV_typ_t.
-typedef unsigned short  _2BYTEPAD;
-typedef unsigned long   CV_tkn_t;
-
-typedef enum SYM_ENUM_e : u16 {
-    S_COMPILE       =  0x0001,  // Compile flags symbol
-    S_REGISTER_16t  =  0x0002,  // Register variable
-    S_CONSTANT_16t  =  0x0003,  // constant symbol
-    S_UDT_16t       =  0x0004,  // User defined type
-    S_SSEARCH       =  0x0005,  // Start Search
-    S_END           =  0x0006,  // Block, procedure, "with" or thunk end
-    S_SKIP          =  0x0007,  // Reserve symbol space in $$Symbols table
-    S_CVRESERVE     =  0x0008,  // Reserved symbol for CV internal use
-    S_OBJNAME_ST    =  0x0009,  // path to object file name
-    S_ENDARG        =  0x000a,  // end of argument/return list
-    S_COBOLUDT_16t  =  0x000b,  // special UDT for cobol that does not symbol pack
-    S_MANYREG_16t   =  0x000c,  // multiple register variable
-    S_RETURN        =  0x000d,  // return description symbol
-    S_ENTRYTHIS     =  0x000e,  // description of this pointer on entry
-
-    S_BPREL16       =  0x0100,  // BP-relative
-    S_LDATA16       =  0x0101,  // Module-local symbol
-    S_GDATA16       =  0x0102,  // Global data symbol
-    S_PUB16         =  0x0103,  // a public symbol
-    S_LPROC16       =  0x0104,  // Local procedure start
-    S_GPROC16       =  0x0105,  // Global procedure start
-    S_THUNK16       =  0x0106,  // Thunk Start
-    S_BLOCK16       =  0x0107,  // block start
-    S_WITH16        =  0x0108,  // with start
-    S_LABEL16       =  0x0109,  // code label
-    S_CEXMODEL16    =  0x010a,  // change execution model
-    S_VFTABLE16     =  0x010b,  // address of virtual function table
-    S_REGREL16      =  0x010c,  // register relative address
-
-    S_BPREL32_16t   =  0x0200,  // BP-relative
-    S_LDATA32_16t   =  0x0201,  // Module-local symbol
-    S_GDATA32_16t   =  0x0202,  // Global data symbol
-    S_PUB32_16t     =  0x0203,  // a public symbol (CV internal reserved)
-    S_LPROC32_16t   =  0x0204,  // Local procedure start
-    S_GPROC32_16t   =  0x0205,  // Global procedure start
-    S_THUNK32_ST    =  0x0206,  // Thunk Start
-    S_BLOCK32_ST    =  0x0207,  // block start
-    S_WITH32_ST     =  0x0208,  // with start
-    S_LABEL32_ST    =  0x0209,  // code label
-    S_CEXMODEL32    =  0x020a,  // change execution model
-    S_VFTABLE32_16t =  0x020b,  // address of virtual function table
-    S_REGREL32_16t  =  0x020c,  // register relative address
-    S_LTHREAD32_16t =  0x020d,  // local thread storage
-    S_GTHREAD32_16t =  0x020e,  // global thread storage
-    S_SLINK32       =  0x020f,  // static link for MIPS EH implementation
-
-    S_LPROCMIPS_16t =  0x0300,  // Local procedure start
-    S_GPROCMIPS_16t =  0x0301,  // Global procedure start
-
-    // if these ref symbols have names following then the names are in ST format
-    S_PROCREF_ST    =  0x0400,  // Reference to a procedure
-    S_DATAREF_ST    =  0x0401,  // Reference to data
-    S_ALIGN         =  0x0402,  // Used for page alignment of symbols
-
-    S_LPROCREF_ST   =  0x0403,  // Local Reference to a procedure
-    S_OEM           =  0x0404,  // OEM defined symbol
-
-    // sym records with 32-bit types embedded instead of 16-bit
-    // all have 0x1000 bit set for easy identification
-    // only do the 32-bit target versions since we don't really
-    // care about 16-bit ones anymore.
-    S_TI16_MAX          =  0x1000,
-
-    S_REGISTER_ST   =  0x1001,  // Register variable
-    S_CONSTANT_ST   =  0x1002,  // constant symbol
-    S_UDT_ST        =  0x1003,  // User defined type
-    S_COBOLUDT_ST   =  0x1004,  // special UDT for cobol that does not symbol pack
-    S_MANYREG_ST    =  0x1005,  // multiple register variable
-    S_BPREL32_ST    =  0x1006,  // BP-relative
-    S_LDATA32_ST    =  0x1007,  // Module-local symbol
-    S_GDATA32_ST    =  0x1008,  // Global data symbol
-    S_PUB32_ST      =  0x1009,  // a public symbol (CV internal reserved)
-    S_LPROC32_ST    =  0x100a,  // Local procedure start
-    S_GPROC32_ST    =  0x100b,  // Global procedure start
-    S_VFTABLE32     =  0x100c,  // address of virtual function table
-    S_REGREL32_ST   =  0x100d,  // register relative address
-    S_LTHREAD32_ST  =  0x100e,  // local thread storage
-    S_GTHREAD32_ST  =  0x100f,  // global thread storage
-
-    S_LPROCMIPS_ST  =  0x1010,  // Local procedure start
-    S_GPROCMIPS_ST  =  0x1011,  // Global procedure start
-
-    S_FRAMEPROC     =  0x1012,  // extra frame and proc information
-    S_COMPILE2_ST   =  0x1013,  // extended compile flags and info
-
-    // new symbols necessary for 16-bit enumerates of IA64 registers
-    // and IA64 specific symbols
-
-    S_MANYREG2_ST   =  0x1014,  // multiple register variable
-    S_LPROCIA64_ST  =  0x1015,  // Local procedure start (IA64)
-    S_GPROCIA64_ST  =  0x1016,  // Global procedure start (IA64)
-
-    // Local symbols for IL
-    S_LOCALSLOT_ST  =  0x1017,  // local IL sym with field for local slot index
-    S_PARAMSLOT_ST  =  0x1018,  // local IL sym with field for parameter slot index
-
-    S_ANNOTATION    =  0x1019,  // Annotation string literals
-
-    // symbols to support managed code debugging
-    S_GMANPROC_ST   =  0x101a,  // Global proc
-    S_LMANPROC_ST   =  0x101b,  // Local proc
-    S_RESERVED1     =  0x101c,  // reserved
-    S_RESERVED2     =  0x101d,  // reserved
-    S_RESERVED3     =  0x101e,  // reserved
-    S_RESERVED4     =  0x101f,  // reserved
-    S_LMANDATA_ST   =  0x1020,
-    S_GMANDATA_ST   =  0x1021,
-    S_MANFRAMEREL_ST=  0x1022,
-    S_MANREGISTER_ST=  0x1023,
-    S_MANSLOT_ST    =  0x1024,
-    S_MANMANYREG_ST =  0x1025,
-    S_MANREGREL_ST  =  0x1026,
-    S_MANMANYREG2_ST=  0x1027,
-    S_MANTYPREF     =  0x1028,  // Index for type referenced by name from metadata
-    S_UNAMESPACE_ST =  0x1029,  // Using namespace
-
-    // Symbols w/ SZ name fields. All name fields contain utf8 encoded strings.
-    S_ST_MAX        =  0x1100,  // starting point for SZ name symbols
-
-    S_OBJNAME       =  0x1101,  // path to object file name
-    S_THUNK32       =  0x1102,  // Thunk Start
-    S_BLOCK32       =  0x1103,  // block start
-    S_WITH32        =  0x1104,  // with start
-    S_LABEL32       =  0x1105,  // code label
-    S_REGISTER      =  0x1106,  // Register variable
-    S_CONSTANT      =  0x1107,  // constant symbol
-    S_UDT           =  0x1108,  // User defined type
-    S_COBOLUDT      =  0x1109,  // special UDT for cobol that does not symbol pack
-    S_MANYREG       =  0x110a,  // multiple register variable
-    S_BPREL32       =  0x110b,  // BP-relative
-    S_LDATA32       =  0x110c,  // Module-local symbol
-    S_GDATA32       =  0x110d,  // Global data symbol
-    S_PUB32         =  0x110e,  // a public symbol (CV internal reserved)
-    S_LPROC32       =  0x110f,  // Local procedure start
-    S_GPROC32       =  0x1110,  // Global procedure start
-    S_REGREL32      =  0x1111,  // register relative address
-    S_LTHREAD32     =  0x1112,  // local thread storage
-    S_GTHREAD32     =  0x1113,  // global thread storage
-
-    S_LPROCMIPS     =  0x1114,  // Local procedure start
-    S_GPROCMIPS     =  0x1115,  // Global procedure start
-    S_COMPILE2      =  0x1116,  // extended compile flags and info
-    S_MANYREG2      =  0x1117,  // multiple register variable
-    S_LPROCIA64     =  0x1118,  // Local procedure start (IA64)
-    S_GPROCIA64     =  0x1119,  // Global procedure start (IA64)
-    S_LOCALSLOT     =  0x111a,  // local IL sym with field for local slot index
-    S_SLOT          = S_LOCALSLOT,  // alias for LOCALSLOT
-    S_PARAMSLOT     =  0x111b,  // local IL sym with field for parameter slot index
-
-    // symbols to support managed code debugging
-    S_LMANDATA      =  0x111c,
-    S_GMANDATA      =  0x111d,
-    S_MANFRAMEREL   =  0x111e,
-    S_MANREGISTER   =  0x111f,
-    S_MANSLOT       =  0x1120,
-    S_MANMANYREG    =  0x1121,
-    S_MANREGREL     =  0x1122,
-    S_MANMANYREG2   =  0x1123,
-    S_UNAMESPACE    =  0x1124,  // Using namespace
-
-    // ref symbols with name fields
-    S_PROCREF       =  0x1125,  // Reference to a procedure
-    S_DATAREF       =  0x1126,  // Reference to data
-    S_LPROCREF      =  0x1127,  // Local Reference to a procedure
-    S_ANNOTATIONREF =  0x1128,  // Reference to an S_ANNOTATION symbol
-    S_TOKENREF      =  0x1129,  // Reference to one of the many MANPROCSYM's
-
-    // continuation of managed symbols
-    S_GMANPROC      =  0x112a,  // Global proc
-    S_LMANPROC      =  0x112b,  // Local proc
-
-    // short, light-weight thunks
-    S_TRAMPOLINE    =  0x112c,  // trampoline thunks
-    S_MANCONSTANT   =  0x112d,  // constants with metadata type info
-
-    // native attributed local/parms
-    S_ATTR_FRAMEREL =  0x112e,  // relative to virtual frame ptr
-    S_ATTR_REGISTER =  0x112f,  // stored in a register
-    S_ATTR_REGREL   =  0x1130,  // relative to register (alternate frame ptr)
-    S_ATTR_MANYREG  =  0x1131,  // stored in >1 register
-
-    // Separated code (from the compiler) support
-    S_SEPCODE       =  0x1132,
-
-    S_LOCAL_2005    =  0x1133,  // defines a local symbol in optimized code
-    S_DEFRANGE_2005 =  0x1134,  // defines a single range of addresses in which symbol can be evaluated
-    S_DEFRANGE2_2005 =  0x1135,  // defines ranges of addresses in which symbol can be evaluated
-
-    S_SECTION       =  0x1136,  // A COFF section in a PE executable
-    S_COFFGROUP     =  0x1137,  // A COFF group
-    S_EXPORT        =  0x1138,  // A export
-
-    S_CALLSITEINFO  =  0x1139,  // Indirect call site information
-    S_FRAMECOOKIE   =  0x113a,  // Security cookie information
-
-    S_DISCARDED     =  0x113b,  // Discarded by LINK /OPT:REF (experimental, see richards)
-
-    S_COMPILE3      =  0x113c,  // Replacement for S_COMPILE2
-    S_ENVBLOCK      =  0x113d,  // Environment block split off from S_COMPILE2
-
-    S_LOCAL         =  0x113e,  // defines a local symbol in optimized code
-    S_DEFRANGE      =  0x113f,  // defines a single range of addresses in which symbol can be evaluated
-    S_DEFRANGE_SUBFIELD =  0x1140,           // ranges for a subfield
-
-    S_DEFRANGE_REGISTER =  0x1141,           // ranges for en-registered symbol
-    S_DEFRANGE_FRAMEPOINTER_REL =  0x1142,   // range for stack symbol.
-    S_DEFRANGE_SUBFIELD_REGISTER =  0x1143,  // ranges for en-registered field of symbol
-    S_DEFRANGE_FRAMEPOINTER_REL_FULL_SCOPE =  0x1144, // range for stack symbol span valid full scope of function body, gap might apply.
-    S_DEFRANGE_REGISTER_REL =  0x1145, // range for symbol address as register + offset.
-
-    // S_PROC symbols that reference ID instead of type
-    S_LPROC32_ID     =  0x1146,
-    S_GPROC32_ID     =  0x1147,
-    S_LPROCMIPS_ID   =  0x1148,
-    S_GPROCMIPS_ID   =  0x1149,
-    S_LPROCIA64_ID   =  0x114a,
-    S_GPROCIA64_ID   =  0x114b,
-
-    S_BUILDINFO      = 0x114c, // build information.
-    S_INLINESITE     = 0x114d, // inlined function callsite.
-    S_INLINESITE_END = 0x114e,
-    S_PROC_ID_END    = 0x114f,
-
-    S_DEFRANGE_HLSL  = 0x1150,
-    S_GDATA_HLSL     = 0x1151,
-    S_LDATA_HLSL     = 0x1152,
-
-    S_FILESTATIC     = 0x1153,
-
-#if defined(CC_DP_CXX) && CC_DP_CXX
-
-    S_LOCAL_DPC_GROUPSHARED = 0x1154, // DPC groupshared variable
-    S_LPROC32_DPC = 0x1155, // DPC local procedure start
-    S_LPROC32_DPC_ID =  0x1156,
-    S_DEFRANGE_DPC_PTR_TAG =  0x1157, // DPC pointer tag definition range
-    S_DPC_SYM_TAG_MAP = 0x1158, // DPC pointer tag value to symbol record map
-
-#endif // CC_DP_CXX
-    
-    S_ARMSWITCHTABLE  = 0x1159,
-    S_CALLEES = 0x115a,
-    S_CALLERS = 0x115b,
-    S_POGODATA = 0x115c,
-    S_INLINESITE2 = 0x115d,      // extended inline site information
-
-    S_HEAPALLOCSITE = 0x115e,    // heap allocation site
-
-    S_MOD_TYPEREF = 0x115f,      // only generated at link time
-
-    S_REF_MINIPDB = 0x1160,      // only generated at link time for mini PDB
-    S_PDBMAP      = 0x1161,      // only generated at link time for mini PDB
-
-    S_GDATA_HLSL32 = 0x1162,
-    S_LDATA_HLSL32 = 0x1163,
-
-    S_GDATA_HLSL32_EX = 0x1164,
-    S_LDATA_HLSL32_EX = 0x1165,
-
-    S_RECTYPE_MAX,               // one greater than last
-    S_RECTYPE_LAST  = S_RECTYPE_MAX - 1,
-    S_RECTYPE_PAD   = S_RECTYPE_MAX + 0x100 // Used *only* to verify symbol record types so that current PDB code can potentially read
-                                // future PDBs (assuming no format change, etc).
-
-} SYM_ENUM_e;
-
-
-typedef struct CV_PROCFLAGS {
-    union {
-        unsigned char   bAll;
-        unsigned char   grfAll;
-        struct {
-            unsigned char CV_PFLAG_NOFPO     :1; // frame pointer present
-            unsigned char CV_PFLAG_INT       :1; // interrupt return
-            unsigned char CV_PFLAG_FAR       :1; // far return
-            unsigned char CV_PFLAG_NEVER     :1; // function does not return
-            unsigned char CV_PFLAG_NOTREACHED:1; // label isn't fallen into
-            unsigned char CV_PFLAG_CUST_CALL :1; // custom calling convention
-            unsigned char CV_PFLAG_NOINLINE  :1; // function marked as noinline
-            unsigned char CV_PFLAG_OPTDBGINFO:1; // function has debug information for optimized code
-        };
-    };
-} CV_PROCFLAGS;
-typedef union CV_PUBSYMFLAGS {
-    CV_pubsymflag_t grfFlags;
-    struct {
-        CV_pubsymflag_t fCode       :  1;    // set if public symbol refers to a code address
-        CV_pubsymflag_t fFunction   :  1;    // set if public symbol is a function
-        CV_pubsymflag_t fManaged    :  1;    // set if managed code (native or IL)
-        CV_pubsymflag_t fMSIL       :  1;    // set if managed IL code
-        CV_pubsymflag_t __unused    : 28;    // must be zero
-    };
-} CV_PUBSYMFLAGS;
-
-typedef struct PROCSYM32 {
-    unsigned short  reclen;     // Record length
-    unsigned short  rectyp;     // S_GPROC32, S_LPROC32, S_GPROC32_ID, S_LPROC32_ID, S_LPROC32_DPC or S_LPROC32_DPC_ID
-    unsigned long   pParent;    // pointer to the parent
-    unsigned long   pEnd;       // pointer to this blocks end
-    unsigned long   pNext;      // pointer to next symbol
-    unsigned long   len;        // Proc length
-    unsigned long   DbgStart;   // Debug start offset
-    unsigned long   DbgEnd;     // Debug end offset
-    CV_typ_t        typind;     // Type index or ID
-    CV_uoff32_t     off;
-    unsigned short  seg;
-    CV_PROCFLAGS    flags;      // Proc flags
-    unsigned char   name[1];    // Length-prefixed name
-} PROCSYM32;
-typedef struct REFSYM2 {
-    unsigned short  reclen;     // Record length
-    unsigned short  rectyp;     // S_PROCREF, S_DATAREF, or S_LPROCREF
-    unsigned long   sumName;    // SUC of the name
-    unsigned long   ibSym;      // Offset of actual symbol in $$Symbols
-    unsigned short  imod;       // Module containing the actual symbol
-    unsigned char   name[1];    // hidden name made a first class member
-} REFSYM2;
-typedef struct CONSTSYM {
-    unsigned short  reclen;     // Record length
-    unsigned short  rectyp;     // S_CONSTANT or S_MANCONSTANT
-    CV_typ_t        typind;     // Type index (containing enum if enumerate) or metadata token
-    unsigned short  value;      // numeric leaf containing value
-    unsigned char   name[1];     // Length-prefixed name
-} CONSTSYM;
-typedef struct UDTSYM {
-    unsigned short  reclen;     // Record length
-    unsigned short  rectyp;     // S_UDT | S_COBOLUDT
-    CV_typ_t        typind;     // Type index
-    unsigned char   name[1];    // Length-prefixed name
-} UDTSYM;
-typedef struct DATASYM32 {
-    unsigned short  reclen;     // Record length
-    unsigned short  rectyp;     // S_LDATA32, S_GDATA32, S_LMANDATA, S_GMANDATA
-    CV_typ_t        typind;     // Type index, or Metadata token if a managed symbol
-    CV_uoff32_t     off;
-    unsigned short  seg;
-    unsigned char   name[1];    // Length-prefixed name
-} DATASYM32;
-typedef struct PUBSYM32 {
-    unsigned short  reclen;     // Record length
-    unsigned short  rectyp;     // S_PUB32
-    CV_PUBSYMFLAGS  pubsymflags;
-    CV_uoff32_t     off;
-    unsigned short  seg;
-    unsigned char   name[1];    // Length-prefixed name
-} PUBSYM32;
-
-// https://github.com/PascalBeyer/PDB-Documentation/?tab=readme-ov-file
-struct msf_header{
-	u8  signature[32];
-	u32 page_size;
-	u32 active_free_page_map;
-	u32 amount_of_pages;
-	u32 stream_table_stream_size;
-	u32 unused;
-	u32 page_list_of_stream_table_stream_page_list[1];
-};
-	
-struct pdb_information_stream_header{
-	u32 version;
-	u32 timestamp;
-	u32 age;
-	GUID guid;
-};
-
-struct dbi_stream_header{
-	u32 version_signature;
-	u32 version;
-	u32 age;
-	u16 stream_index_of_the_global_symbol_index_stream;
-	struct{
-		u16 minor_version : 8;
-		u16 major_version : 7;
-		u16 is_new_version_format : 1;
-	} toolchain_version;
-	u16 stream_index_of_the_public_symbol_index_stream;
-	u16 version_number_of_mspdb_dll_which_build_the_pdb;
-	u16 stream_index_of_the_symbol_record_stream;
-	u16 build_number_of_mspdb_dll_which_build_the_pdb;
-		
-	u32 byte_size_of_the_module_information_substream;   // substream 0
-	u32 byte_size_of_the_section_contribution_substream; // substream 1
-	u32 byte_size_of_the_section_map_substream;          // substream 2
-	u32 byte_size_of_the_source_information_substream;   // substream 3
-	u32 byte_size_of_the_type_server_map_substream;      // substream 4
-		
-	u32 index_of_the_MFC_type_server_in_type_server_map_substream;
-		
-	u32 byte_size_of_the_optional_debug_header_substream; // substream 6
-	u32 byte_size_of_the_edit_and_continue_substream;     // substream 5
-		
-	struct{
-		u16 was_linked_incrementally         : 1;
-		u16 private_symbols_were_stripped    : 1;
-		u16 the_pdb_allows_conflicting_types : 1; // undocumented /DEBUG:CTYPES flag.
-	} flags;
-		
-	u16 machine_type;
-	u32 reserved_padding;
-};
-
-struct pdb_section_contribution{
-	s16 section_id;
-	u16 padding1;
-	s32 offset;
-	s32 size;
-	u32 characteristics;
-	s16 module_index;
-	u16 padding2;
-	u32 data_crc;
-	u32 reloc_crc;
-};
-struct pdb_module_information{
-	u32 unused;
-	struct pdb_section_contribution first_code_contribution;
-		
-	struct{
-		u16 was_written : 1;
-		u16 edit_and_continue_enabled : 1;
-		u16 unused : 6;
-		u16 TSM_index : 8;
-	} flags;
-		
-	u16 stream_index_of_module_symbol_stream;
-		
-	u32 byte_size_of_symbol_information;
-	u32 byte_size_of_c11_line_information;
-	u32 byte_size_of_c13_line_information;
-		
-	u16 amount_of_source_files;
-	u16 padding;
-	u32 unused2;
-		
-	u32 edit_and_continue_source_file_string_index;
-	u32 edit_and_continue_pdb_file_string_index;
-		
-	//char module_name_and_file_name_and_padding[1];
-};
-
-struct pdb_section_map_stream_header{
-	u16 number_of_section_descriptors;
-	u16 number_of_logical_section_descriptors;
-};
-struct pdb_section_map_entry{
-	u16 flags;
-	u16 logical_overlay_number;
-	u16 group;
-	u16 frame;
-	u16 section_name;
-	u16 class_name;
-	u32 offset;
-	u32 section_size;
-};
-
-struct optional_debug_header_substream{
-	u16 stream_index_of_fpo_data;
-	u16 stream_index_of_exception_data;
-	u16 stream_index_of_fixup_data;
-	u16 stream_index_of_omap_to_src_data;
-	u16 stream_index_of_omap_from_src_data;
-	u16 stream_index_of_section_header_dump;
-	u16 stream_index_of_clr_token_to_clr_record_id;
-	u16 stream_index_of_xdata;
-	u16 stream_index_of_pdata;
-	u16 stream_index_of_new_fpo_data;
-	u16 stream_index_of_original_section_header_dump;
-};
-
-struct codeview_symbol_header{ // Also see SYMTYPE in cvinfo.h
-	u16 length;
-	//u16 kind;
-	SYM_ENUM_e kind;
-};
-
-enum DEBUG_S_SUBSECTION_TYPE : u32 {
-	DEBUG_S_IGNORE = 0x80000000,    // if this bit is set in a subsection type then ignore the subsection contents
-
-	DEBUG_S_SYMBOLS = 0xf1,
-	DEBUG_S_LINES,
-	DEBUG_S_STRINGTABLE,
-	DEBUG_S_FILECHKSMS,
-	DEBUG_S_FRAMEDATA,
-	DEBUG_S_INLINEELINES,
-	DEBUG_S_CROSSSCOPEIMPORTS,
-	DEBUG_S_CROSSSCOPEEXPORTS,
-
-	DEBUG_S_IL_LINES,
-	DEBUG_S_FUNC_MDTOKEN_MAP,
-	DEBUG_S_TYPE_MDTOKEN_MAP,
-	DEBUG_S_MERGED_ASSEMBLYINPUT,
-
-	DEBUG_S_COFF_SYMBOL_RVA,
-};
-struct codeview_subsection_header{
-	DEBUG_S_SUBSECTION_TYPE type;
-	u32 length;
-};
-struct codeview_file_checksum{
-	u32 offset_in_string_table;
-	u8  checksum_size;
-	u8  checksum_kind;
-	//u8  checksum[];
-};
-struct codeview_line_header{
-	u32 contribution_offset;
-	u16 contribution_section_id;
-	u16 flags;
-	u32 contribution_size;
-};
-struct codeview_line_block_header{
-	u32 offset_in_file_checksums;
-	u32 amount_of_lines; // codeview_line_block_header followed by codeview_line[amount_of_lines]
-	u32 block_size; // unsure what is is for, could be sizeof(codeview_line_block_header + codeview_line[])
-};
-struct codeview_line{
-	u32 offset;
-	u32 start_line_number     : 24;
-	u32 optional_delta_to_end : 7;
-	u32 is_a_statement        : 1;
-};
-
-struct SourceLoc {
-	const char* filepath;
-	u32         lineno;
-};
-
-// PDBs are assumed to be next to exe of the same name for the moment
-// PDBs of microsoft dlls are not gotten yet (which dbghelp.dll does somehow)
-
-class PDB_File {
-	std::vector<char> data;
-	
-	void* get_page (u32 idx) {
-		return (char*)data.data() + idx * header->page_size;
-	}
-	u32 ceil_div (u32 a, u32 b) {
-		return (a + (b-1)) / b;
-	}
-	char* align_up (char* ptr, u32 align) {
-		uintptr_t x = (uintptr_t)ptr;
-		return (char*)((x + align-1) / align * align);
-	}
-
-	void* read_sts (u32 ptr) {
-		u32 page_idx    = ptr / header->page_size;
-		u32 ptr_in_page = ptr % header->page_size;
-		
-		//u32 sts_num_pages = ceil_div(header->stream_table_stream_size, header->page_size);
-
-		u32 u32_per_page = header->page_size / sizeof(u32);
-		u32 page_idx_page     = page_idx / u32_per_page;
-		u32 page_idx_page_idx = page_idx % u32_per_page;
-
-		assert(page_idx_page == 0);
-		u32* sts_pages = (u32*)get_page(header->page_list_of_stream_table_stream_page_list[page_idx_page]);
-
-		return (char*)get_page(sts_pages[page_idx_page_idx]) + ptr_in_page;
-	}
-	
-	
-	msf_header* header;
-
-	struct Stream {
-		u32 size;
-		std::vector<u32> pages;
-	};
-	std::vector<Stream> streams;
-	
-	std::vector<char> pdb_info_data;
-	std::vector<char> names_data;
-	std::vector<char> DBI_data;
-	std::vector<char> section_header_dump_data;
-
-	pdb_information_stream_header* info;
-
-	std::unordered_map<std::string_view, u32> named_streams;
-
-	const char* names;
-
-	optional_debug_header_substream* opt_streams;
+class SymResolver {
+	// hazard pointer indices, a lookup can hold a module snapshot and a PDB at the same time
+	static constexpr int HAZARD_SNAPSHOT = 0;
+	static constexpr int HAZARD_PDB = 1;
 
-	//// Final needed data
-	struct Section {
-		std::string name;
+	struct LoadedModule {
+		u32 id = 0; // load order, see CompactResult::module
+		std::string path;
+		std::string pdb_path;
 
 		uintptr_t base_addr;
 		size_t size;
-	};
-	std::vector<Section> sections_sorted;
-
-	u32 num_section_contributions;
-	pdb_section_contribution* section_contributions;
-	
-	void* read_stream (u32 stream, u32 ptr) {
-		u32 page_idx    = ptr / header->page_size;
-		u32 ptr_in_page = ptr % header->page_size;
 
-		assert(stream < streams.size() && ptr < streams[stream].size);
-		return (char*)get_page(streams[stream].pages[page_idx]) + ptr_in_page;
-	}
-	std::vector<char> copy_into_consecutive (u32 streami) {
-		std::vector<char> data;
-
-		auto& stream = streams[streami];
-		data.resize(stream.size);
-
-		char* cur = data.data();
-		size_t remain = stream.size;
-		for (u32 pg : stream.pages) {
-			memcpy(cur, get_page(pg), (u32)std::min((size_t)header->page_size, remain));
-			remain -= header->page_size;
-			cur += header->page_size;
-		}
+		// Readers see modules as const and get at the PDB through a hazard pointer on pdb (null while evicted or loading)
+		// the rest only changes under ModuleCache::add_mutex, eviction drops the PDB but the module and its address range stay
+		mutable bool has_pdb = false; // false if no pdb could be loaded at all, as opposed to evicted, only read once loading is false
+		mutable std::atomic<bool> loading = false; // in the background, see ModuleCache::loader
+		mutable std::atomic<PDB_File*> pdb = nullptr;
+		mutable std::shared_ptr<PDB_File> pdb_owner; // shared with other resolvers through PdbRegistry
+		mutable size_t pdb_bytes = 0; // memory_size() when the budget was last checked
+		mutable std::atomic<u32> last_used = 0; // ModuleCache::clock, for LRU
 
-		return data;
-	}
-	
-	void read_header () {
-		header = (msf_header*)data.data();
-		assert(strncmp((const char*)header->signature, "Microsoft C/C++ MSF 7.00\r\n\032DS\0\0\0", 32) == 0);
-	}
-	void read_stream_table () {
-
-		u32* _sts_ppages = (u32*)get_page(header->page_list_of_stream_table_stream_page_list[0]);
-		u32* _sts_pages = (u32*)get_page(_sts_ppages[0]);
-		char* _sts_start = (char*)read_sts(0);
+		LoadedModule (std::string&& path, uintptr_t base_addr, size_t size) {
+			auto pdb_path = std::filesystem::path(path);
+			this->path = std::move(path);
+			this->base_addr = base_addr;
+			this->size = size;
 
-		u32 cur = 0;
-		u32 amount_of_streams = *(u32*)read_sts(cur);
-		cur += sizeof(u32);
-		
-		while (streams.size() < amount_of_streams) {
-			u32 stream_size = *(u32*)read_sts(cur);
-			cur += sizeof(u32);
-
-			// The assumtion that deleted streams don't count seems to be wrong due to crash and seems to be verified by looking at data
-			//if (stream_size == 0xffffffff) {
-			//	// I think, this deleted stream does not count for amount_of_streams, but the link above is not clear on this
-			//	continue;
-			//}
-			if (stream_size == 0xffffffff) {
-				stream_size = 0;
-			}
-		
-			Stream s;
-			s.size = stream_size;
-			streams.push_back(s);
-		}
-		
-		for (u32 si=0; si<streams.size(); si++) {
-			auto& stream = streams[si];
-			//printf("Stream %3d: { ", si);
-		
-			u32 num_pages = ceil_div(stream.size, header->page_size);
-			for (u32 i=0; i<num_pages; i++) {
-				u32 page_idx = *(u32*)read_sts(cur);
-				cur += sizeof(u32);
-		
-				stream.pages.push_back(page_idx);
-		
-				//printf("%d, ", page_idx);
-			}
-		
-			//printf("}\n");
+			// Techically there might be more correct ways to find the pdb, and also ways that allow getting pdbs from microsoft servers
+			// see above link
+			pdb_path.replace_extension({".pdb"});
+			this->pdb_path = pdb_path.string();
 		}
-	}
-
-	void read_pdb_info () {
-		
-		pdb_info_data = copy_into_consecutive(1);
-		char* ptr = pdb_info_data.data();
-
-		info = (pdb_information_stream_header*)ptr;
-		ptr += sizeof(pdb_information_stream_header);
-
-		// read named stream hashmap
-		u32 string_buffer_size = *(u32*)ptr;
-		ptr += sizeof(u32);
+	};
+	// Readers find modules without locking: the sorted module list is an immutable Snapshot published through an atomic pointer
+	// Adding a module (under add_mutex) publishes a copy with the module inserted and retires the old snapshot,
+	// which is freed once no reader's hazard pointer refers to it anymore
+	// LoadedModules are owned separately and never move, so pointers to them stay valid as long as the ModuleCache
+	//
+	// With a memory budget the PDBs of the least recently used modules are evicted whenever loading a module goes over it,
+	// and reloaded on the next address in them. Evicted PDBs are retired like snapshots, a reader protects the one it resolves with.
+	// LRU is by clock, which only advances on (re)loads, so a module only needs to write last_used once between loads
+	//
+	// With a loader PDBs are (re)loaded on its thread, the module is published right away and its PDB once loaded
+	// without one the thread that misses loads the PDB, outside of add_mutex, and publishes the module with it
+	//
+	// Modules come from the provider, which is only asked on a miss. Once it reports changes, the modules it no longer has are dropped
+	// from the snapshot (by_id keeps them, for CompactResults). Their PDBs stay loaded until evicted, readers without a budget don't protect them
+	struct ModuleCache {
+		TimerMeasurement ttry_get_and_cache_module = TimerMeasurement("try_get_and_cache_module");
 
-		char* string_buffer = ptr;
-		ptr += string_buffer_size;
+		PDB_File::Options pdb_opt;
+		std::shared_ptr<ModuleMapProvider> provider;
+		std::atomic<u32> seen_changes = 0;
 
-		u32 amount_of_entries = *(u32*)ptr;
-		ptr += sizeof(u32);
-		u32 capacity = *(u32*)ptr;
-		ptr += sizeof(u32);
-		
-		// bit_array present_bits
-		u32 present_word_count = *(u32*)ptr;
-		ptr += sizeof(u32);
-		u32* present_bits = (u32*)ptr;
-		ptr += present_word_count * sizeof(u32);
-
-		// bit_array deleted_bits
-		u32 deleted_word_count = *(u32*)ptr;
-		ptr += sizeof(u32);
-		u32* deleted_bits = (u32*)ptr;
-		ptr += deleted_word_count * sizeof(u32);
-
-		struct KeyValue {
-			u32 key;
-			u32 value;
+		struct Snapshot {
+			std::vector<const LoadedModule*> sorted;
+			std::vector<const LoadedModule*> by_id;
 		};
-		KeyValue* entries = (KeyValue*)ptr;
-		ptr += amount_of_entries * sizeof(KeyValue);
-
-		// unused
-		ptr += sizeof(u32);
-		
-		//printf("Named Streams:\n");
-		for(u32 index = 0, entry_index = 0; index < capacity && entry_index < amount_of_entries; index++){
-			u32 word_index = index / (sizeof(u32) * 8);
-			u32 bit_index  = index % (sizeof(u32) * 8);
-			
-			if(word_index < present_word_count && (present_bits[word_index] & (1u << bit_index))){
-				auto& kv = entries[entry_index++];
-
-				//std::string key = std::string(&string_buffer[kv.key]);
-				//printf("> %s: %d\n", key.c_str(), kv.value);
-				//named_streams[std::move(key)] = kv.value;
-				std::string key = std::string(&string_buffer[kv.key]);
-				//printf("> %s: %d\n", &string_buffer[kv.key], kv.value);
-				named_streams[std::string_view(&string_buffer[kv.key])] = kv.value;
-				continue;
-			}
+		std::atomic<Snapshot*> current = new Snapshot{};
+		// bumped whenever a module was added or removed or a PDB evicted, which makes results cached so far stale
+		std::atomic<u32> generation = 0;
+
+		std::atomic<size_t> memory_budget = 0; // bytes of PDB_File::memory_size() over all modules, 0 for no limit
+		std::atomic<u32> clock = 0;
+
+		std::atomic<size_t> evictions = 0;
+		std::atomic<size_t> reloads = 0;
+
+		std::mutex add_mutex; // for everything below
+		std::vector<std::unique_ptr<LoadedModule>> modules; // in load order
+		std::vector<Snapshot*> retired;
+		std::vector<std::shared_ptr<PDB_File>> retired_pdbs;
+
+		u32 load_wait_ms = 0;
+		std::function<void(const char* module_path, bool loaded)> on_loaded;
+		std::mutex wait_mutex; // for loaded_cv and loads_in_flight
+		std::condition_variable loaded_cv;
+		u32 loads_in_flight = 0;
+		// 2 threads since queue 0 belongs to whoever calls wait(), which nobody does, so the one worker steals from it as well
+		// declared last, so it finishes its jobs before anything they use is gone
+		std::unique_ptr<ThreadPool> loader;
+
+		ModuleCache () {}
+		ModuleCache (ModuleCache const&) = delete;
+		ModuleCache& operator= (ModuleCache const&) = delete;
+		~ModuleCache () {
+			loader = nullptr;
+			delete current.load();
+			for (auto* snap : retired)
+				delete snap;
 		}
-	}
-
-	void read_names () {
-		names_data = copy_into_consecutive(named_streams["/names"]);
-		char* ptr = names_data.data();
-		
-		u32 signature = *(u32*)ptr;
-		ptr += sizeof(u32);
-		assert(signature == 0xEFFEEFFE);
-		
-		u32 hash_version = *(u32*)ptr;
-		ptr += sizeof(u32);
-		
-		u32 string_buffer_size = *(u32*)ptr;
-		ptr += sizeof(u32);
-		
-		names = ptr;
-		ptr += string_buffer_size;
-		
-		u32 bucket_count = *(u32*)ptr;
-		ptr += sizeof(u32);
-
-		u32* buckets = (u32*)ptr;
-		ptr += bucket_count * sizeof(u32);
-
-		u32* amount_of_strings = (u32*)ptr;
-		ptr += sizeof(u32);
-	}
-	
-	void read_DBI () {
-		DBI_data = copy_into_consecutive(3);
-		char* ptr = DBI_data.data();
-
-		auto* header = (dbi_stream_header*)ptr;
-		ptr += sizeof(dbi_stream_header);
-		
-		//// module_information_substream
-		auto* ptr2 = ptr;
-
-		modules.reserve(64);
-		while (ptr < ptr2+header->byte_size_of_the_module_information_substream) {
-			auto* mi = (pdb_module_information*)ptr;
-			ptr += sizeof(pdb_module_information);
-
-			const char* mod_name = ptr;
-			size_t mod_name_len = strlen(mod_name);
-			ptr += mod_name_len+1;
-
-			const char* file_name = ptr;
-			size_t file_name_len = strlen(file_name);
-			ptr += file_name_len+1;
-
-			ptr = align_up(ptr, 4);
-
-			//printf("> %d %-50s %-50s\n", mi->stream_index_of_module_symbol_stream, mod_name, file_name);
-
-			Module m;
-			m.mi = mi;
-			m.name = std::string_view(mod_name, mod_name_len);
-			m.file_name = std::string_view(file_name, file_name_len);
-
-			auto module_index = modules.size();
-			modules.push_back(m);
-
-			assert(module_index < 0xffff);
-			read_module_symbol_stream((s16)module_index);
-		}
-		assert((ptr - ptr2) == header->byte_size_of_the_module_information_substream);
-		ptr = ptr2 + header->byte_size_of_the_module_information_substream;
-		
-		//// section_contribution_substream
-		ptr2 = ptr;
-
-		u32 DBISCImpv = *(u32*)ptr;
-		ptr += sizeof(u32);
-
-		assert(DBISCImpv == (0xeffe0000 + 19970605));
-
-		num_section_contributions = header->byte_size_of_the_section_contribution_substream / sizeof(pdb_section_contribution);
-		section_contributions = (pdb_section_contribution*)ptr;
 
-		//while (ptr < ptr2+header->byte_size_of_the_section_contribution_substream) {
-			//auto* sc = (pdb_section_contribution*)ptr;
-			//ptr += sizeof(pdb_section_contribution);
-		for (u32 i=0; i<num_section_contributions; i++) {
-			auto* sc = &section_contributions[i];
-			//printf("> %d %8x %8x %d\n", sc->section_id, sc->offset, sc->size, sc->module_index);
+		static const LoadedModule* find_in (Snapshot const& snap, uintptr_t addr) {
+			auto it = std::upper_bound(snap.sorted.begin(), snap.sorted.end(), addr, [] (uintptr_t addr, const LoadedModule* m) {
+				return addr < m->base_addr;
+			});
+			if (it == snap.sorted.begin())
+				return nullptr;
+			auto* m = *(it-1);
+			return addr < m->base_addr + m->size ? m : nullptr;
 		}
-		ptr += sizeof(pdb_section_contribution) * num_section_contributions;
-		assert((ptr - ptr2) == header->byte_size_of_the_section_contribution_substream); // Why is this not correct?
-		
-		//// section_map_substream
-		//ptr2 = ptr;
-		//
-		//auto* sec_header = (pdb_section_map_stream_header*)ptr;
-		//ptr += sizeof(pdb_section_map_stream_header);
-		//assert(sec_header->number_of_section_descriptors == sec_header->number_of_logical_section_descriptors);
-		//
-		////while (ptr < ptr2+header->byte_size_of_the_section_map_substream) {
-		//for (u32 i=0; i<sec_header->number_of_section_descriptors; i++) {
-		//	auto* sm = (pdb_section_map_entry*)ptr;
-		//	ptr += sizeof(pdb_section_map_entry);
-		//}
-		//
-		//assert((ptr - ptr2) == header->byte_size_of_the_section_map_substream);
-		ptr += header->byte_size_of_the_section_map_substream;
-
-		//// source_information_substream
-		//ptr2 = ptr;
-		//
-		//u16 amount_of_modules = *(u16*)ptr;
-		//ptr += sizeof(u16);
-		//u16 truncated_amount_of_source_files = *(u16*)ptr;
-		//ptr += sizeof(u16);
-		//
-		//assert(amount_of_modules == modules.size());
-		//
-		//u16* source_file_base_index_per_module = (u16*)ptr;
-		//ptr += amount_of_modules * sizeof(u16);
-		//u16* amount_of_source_files_per_module = (u16*)ptr;
-		//ptr += amount_of_modules * sizeof(u16);
-		//
-		//u32* source_file_name_offset_in_string_buffer = (u32*)ptr;
-		////ptr += amount_of_source_files * sizeof(u32);
-		//
-		//u32 byte_size_of_the_source_information_substream;   // substream 3
-		//u32 byte_size_of_the_type_server_map_substream;      // substream 4
-		//
-		//u32 index_of_the_MFC_type_server_in_type_server_map_substream;
-		//
-		//u32 byte_size_of_the_optional_debug_header_substream; // substream 6
-		//u32 byte_size_of_the_edit_and_continue_substream;     // substream 5
-		
-		ptr += header->byte_size_of_the_source_information_substream;
-
-		ptr += header->byte_size_of_the_type_server_map_substream;
 
-		ptr += header->byte_size_of_the_edit_and_continue_substream;
-
-		//// optional_debug_header_substream
-		opt_streams = (optional_debug_header_substream*)ptr;
-		
-		//byte_size_of_the_optional_debug_header_substream
-	}
-
-	void read_section_header_dump () {
-		section_header_dump_data = copy_into_consecutive(opt_streams->stream_index_of_section_header_dump);
-		assert(section_header_dump_data.size() == streams[opt_streams->stream_index_of_section_header_dump].size);
-
-		char* ptr = section_header_dump_data.data();
-		char* ptr2 = ptr;
+		// add_mutex must be held, pdb from acquire_pdb
+		const LoadedModule* cache (std::unique_ptr<LoadedModule> m, std::shared_ptr<PDB_File> pdb) {
+			auto* mod = m.get();
+			mod->id = (u32)modules.size();
+			modules.push_back(std::move(m));
+			// before publishing, so readers never see the module without either its PDB or loading set
+			if (loader) start_load(mod, false);
+			else        finish_load(mod, std::move(pdb), false);
+
+			auto* old = current.load(std::memory_order_relaxed);
+			auto* snap = new Snapshot{ old->sorted, old->by_id };
+			snap->by_id.push_back(mod);
+			auto it = std::upper_bound(snap->sorted.begin(), snap->sorted.end(), mod->base_addr, [] (uintptr_t addr, const LoadedModule* m) {
+				return addr < m->base_addr;
+			});
+			snap->sorted.insert(it, mod);
 
-		while (ptr < ptr2 + section_header_dump_data.size()) {
-			auto* sh = (IMAGE_SECTION_HEADER*)ptr;
-			ptr += sizeof(IMAGE_SECTION_HEADER);
+			current.store(snap, std::memory_order_seq_cst);
+			generation++;
 
-			sections_sorted.push_back({ std::string((const char*)sh->Name, strnlen_s((const char*)sh->Name, 8)), sh->VirtualAddress, sh->Misc.VirtualSize });
-			
-			//char name[9] = {};
-			//strncpy_s(name, (const char*)sh->Name, 8); // properly null-terminate
-			//printf("> %7s %8x %8x\n", name, sh->VirtualAddress, sh->Misc.VirtualSize);
+			retired.push_back(old);
+			HazardPointers::reclaim(&retired);
+			return mod;
 		}
 
-		_assert_sections_sorted();
-	}
-	
-	void read_symbol_record_stream () {
-		auto* dbi = (dbi_stream_header*)DBI_data.data();
-		auto srs_data = copy_into_consecutive(dbi->stream_index_of_the_symbol_record_stream);
-		char* ptr = srs_data.data();
-
-		char* ptr2 = ptr;
-		
-		// TODO: these should be 
-		while (ptr < ptr2 + srs_data.size()) {
-			auto sym = (codeview_symbol_header*)ptr;
-			
-			ptr += sizeof(u16) + sym->length; // length field of codeview_symbol_header not contained in length (but kind is)
-			ptr = align_up(ptr, 4);
-
-			switch (sym->kind) {
-				//case S_PROCREF: case S_DATAREF: case S_LPROCREF: {
-				//	auto* s = (REFSYM2*)sym;
-				//	printf("REFSYM2: %s\n", s->name);
-				//} break;
-				//case S_CONSTANT: case S_MANCONSTANT: { // mostly works, but weirdness with the name? maybe using 1 for zero length array is wrong
-				//	auto* s = (CONSTSYM*)sym;
-				//	printf("CONSTSYM: %s\n", s->name);
-				//} break;
-				//case S_UDT: case S_COBOLUDT: {
-				//	auto* s = (UDTSYM*)sym;
-				//	printf("UDTSYM: %s\n", s->name);
-				//} break;
-				case S_LDATA32: case S_GDATA32: case S_LMANDATA: case S_GMANDATA: {
-					auto* s = (DATASYM32*)sym;
-					//printf("DATASYM32: seg:%d offs:%4x %s\n", s->seg, s->off, s->name);
-				} break;
-				case S_PUB32: {
-					auto* s = (PUBSYM32*)sym;
-					//printf("PUBSYM32: seg:%d offs:%4x %s\n", s->seg, s->off, s->name);
-				} break;
-				default: {
-
-				}
-			}
+		// Without a loader PDBs are acquired before taking add_mutex, so misses on other modules don't wait for a load that can take seconds
+		// the registry hands out the same PDB again if another resolver (or thread) has it, otherwise the index cache makes this cheap
+		// null with a loader, which loads in the background instead
+		std::shared_ptr<PDB_File> acquire_pdb (const LoadedModule* mod) {
+			return loader ? nullptr : PdbRegistry::global().acquire(mod->pdb_path, pdb_opt);
 		}
-		assert((ptr - ptr2) == srs_data.size());
-	}
-	void read_module_symbol_stream (s16 module_index) {
-		auto& mod = modules[module_index];
-		auto* mi = mod.mi;
-
-		if (mi->stream_index_of_module_symbol_stream == 0xffff)
-			return; // no symbol data
-		mod.symbol_stream_data = copy_into_consecutive(mi->stream_index_of_module_symbol_stream);
-		char* ptr = mod.symbol_stream_data.data();
-		
-		//// Symbol info
-		char* ptr2 = ptr;
-		u32 signature = *(u32*)ptr;
-		ptr += sizeof(u32);
-		assert(signature == 4); // CV_SIGNATURE_C13
-		
-		while (ptr < ptr2 + mi->byte_size_of_symbol_information) {
-			auto sym = (codeview_symbol_header*)ptr;
-			
-			ptr += sizeof(u16) + sym->length; // length field of codeview_symbol_header not contained in length (but kind is)
-			ptr = align_up(ptr, 4);
-
-			//printf("> %4x %d\n", sym->kind, sym->length);
-
-			switch (sym->kind) {
-				case S_GPROC32: case S_LPROC32:
-				case S_GPROC32_ID: case S_LPROC32_ID: {
-					auto* proc = (PROCSYM32*)sym;
-					//printf(">> %s %4d %4d %8x %s\n",
-					//	sym->kind == S_LPROC32 ? "L":"G",
-					//	proc->seg, proc->len, proc->off, proc->name);
-
-					mod.procsyms.push_back({ proc });
-				} break;
-			}
+		// add_mutex must be held, pdb from acquire_pdb
+		void reload (const LoadedModule* mod, std::shared_ptr<PDB_File> pdb) {
+			if (mod->pdb.load(std::memory_order_relaxed) || is_loading(mod))
+				return; // another thread was faster
+			if (!loader && !pdb)
+				return; // evicted only after we checked, the next lookup loads it again
+			reloads++;
+			if (loader) start_load(mod, true);
+			else        finish_load(mod, std::move(pdb), true);
 		}
-		assert((ptr - ptr2) == mi->byte_size_of_symbol_information);
-		
-		//auto* c11_line_information = (u8*)ptr;
-		ptr += mi->byte_size_of_c11_line_information;
-		
-		//// C13 line info
-		//printf("> c13_line_information\n");
-
-		ptr2 = ptr;
-
-		// first pass to find FILECHKSMS ptr
-		char* filechksms_ptr = nullptr;
-		while (ptr < ptr2 + mi->byte_size_of_c13_line_information) {
-			auto* header = (codeview_subsection_header*)ptr;
-			ptr += sizeof(codeview_subsection_header);
-
-			if (header->type == DEBUG_S_FILECHKSMS) {
-				filechksms_ptr = ptr;
-				//read_file_checksum(header);
-				break;
+		// add_mutex must be held, only with a loader
+		void start_load (const LoadedModule* mod, bool reload) {
+			assert(loader);
+			mod->loading = true;
+			{
+				std::lock_guard<std::mutex> lock(wait_mutex);
+				loads_in_flight++;
 			}
-			else {
-				ptr += header->length;
-			}
-		}
-		ptr = ptr2; // reset ptr
-		
-		auto read_line_numbers = [&] (codeview_subsection_header* header) {
-			auto* ptr3 = ptr;
-
-			// With usual compiler, this is once per function
-			auto* lines = (codeview_line_header*)ptr;
-			ptr += sizeof(codeview_line_header);
-			assert(lines->flags == 0); // CV_LINES_HAVE_COLUMNS not implemented
-
-			//printf(">> Header %d, %8x %8x\n", lines->contribution_section_id, lines->contribution_offset, lines->contribution_size);
-			
-			while (ptr < ptr3 + header->length) {
-				auto* line_block = (codeview_line_block_header*)ptr;
-				ptr += sizeof(codeview_line_block_header);
-
-				auto* cksm = (codeview_file_checksum*)(filechksms_ptr + line_block->offset_in_file_checksums);
-				auto* name = &names[cksm->offset_in_string_table];
-
-				//printf(">> Block %d %d %s\n", line_block->block_size, line_block->offset_in_file_checksums, name);
-
-				for (u32 i=0; i<line_block->amount_of_lines; i++) {
-					auto* line = (codeview_line*)ptr;
-					ptr += sizeof(codeview_line);
-
-					//printf(">>  Line %d %d\n", line->start_line_number, line->offset);
+			loader->push([this, mod, reload] () {
+				auto pdb = PdbRegistry::global().acquire(mod->pdb_path, pdb_opt);
+				bool loaded = pdb != nullptr;
+				{
+					std::lock_guard<std::mutex> lock(add_mutex);
+					finish_load(mod, std::move(pdb), reload);
+					mod->loading.store(false, std::memory_order_release);
+					generation++; // PDB_PENDING results cached so far are stale
 				}
-			}
-			assert((ptr - ptr3) == header->length);
-		};
-		auto read_file_checksums = [&] (codeview_subsection_header* header) {
-			auto* ptr3 = ptr;
-			while (ptr < ptr3 + header->length) {
-				auto* file = (codeview_file_checksum*)ptr;
-				ptr += sizeof(codeview_file_checksum);
-				ptr += file->checksum_size;
-				ptr = align_up(ptr, 4);
-
-				auto* name = &names[file->offset_in_string_table];
-
-				//printf(">> File Checksum %s\n", name);
-			}
-			assert((ptr - ptr3) == header->length);
-		};
-
-		while (ptr < ptr2 + mi->byte_size_of_c13_line_information) {
-			auto* header = (codeview_subsection_header*)ptr;
-			ptr += sizeof(codeview_subsection_header);
-
-			switch (header->type) {
-				case DEBUG_S_LINES: {
-					read_line_numbers(header);
-				} break;
-				//case DEBUG_S_FILECHKSMS: {
-				//	read_file_checksum(header);
-				//} break;
-				default: {
-					ptr += header->length;
+				{
+					std::lock_guard<std::mutex> lock(wait_mutex);
+					loads_in_flight--;
 				}
-			}
+				loaded_cv.notify_all();
+				if (on_loaded)
+					on_loaded(mod->path.c_str(), loaded);
+			});
+		}
+		// add_mutex must be held
+		void finish_load (const LoadedModule* mod, std::shared_ptr<PDB_File> pdb, bool reload) {
+			mod->pdb_owner = std::move(pdb);
+			mod->pdb.store(mod->pdb_owner.get());
+			if (!reload)
+				mod->has_pdb = mod->pdb_owner != nullptr;
+			mod->last_used = ++clock;
+			enforce_budget(mod);
 		}
-		assert((ptr - ptr2) == mi->byte_size_of_c13_line_information);
-
-		auto global_references_bytes_size = *(u32*)ptr;
-		auto num_global_references = global_references_bytes_size / 4;
-		ptr += sizeof(u32);
-		
-		auto* global_references = (u32*)ptr;
-		ptr += global_references_bytes_size;
-		
-		assert((ptr - mod.symbol_stream_data.data()) == streams[mi->stream_index_of_module_symbol_stream].size);
-	}
-	
-public:
-	struct ProcSym {
-		PROCSYM32* proc;
-	};
-	struct Module {
-		pdb_module_information* mi;
-		std::string_view name;
-		std::string_view file_name;
 
-		std::vector<char> symbol_stream_data;
-		std::vector<ProcSym> procsyms;
-	};
-	std::vector<Module> modules;
-
-	const Section* find_section_for_addr (uintptr_t raddr, u32* out_sec_id) {
-		for (u32 id=0; id<sections_sorted.size(); id++) {
-			auto& sec = sections_sorted[id];
-			if (raddr < sec.base_addr)
-				break;
-			if (/*raddr >= sec.base_addr && */raddr < sec.base_addr + sec.size) {
-				*out_sec_id = id+1; // one based!
-				return &sec;
-			}
+		bool is_loading (const LoadedModule* mod) const {
+			return mod->loading.load(std::memory_order_acquire);
 		}
-		return nullptr;
-	}
-	void _assert_sections_sorted () {
-		for (size_t i=1; i<sections_sorted.size(); i++) {
-			assert(sections_sorted[i].base_addr > sections_sorted[i-1].base_addr + sections_sorted[i-1].size);
+		// false on timeout
+		bool wait_loaded (const LoadedModule* mod, u32 timeout_ms) {
+			std::unique_lock<std::mutex> lock(wait_mutex);
+			return loaded_cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&] () { return !is_loading(mod); });
 		}
-	}
-	
-	// section_contributions.offset & size are explicitly signed for some reason despite the fact that they logically cannot be negative
-	// (as negative sizes don't make sense and the relative address had to be positive to even cause us to look up this section)
-	const pdb_section_contribution* find_section_contribution (u32 sec_id, s32 raddr) {
-		// supposedly this is meant to be binary searched, but we could cache the subrange for each section to avoid like half the cost
-		for (u32 i=0; i<num_section_contributions; i++) {
-			auto& sc = section_contributions[i];
-			if (sec_id == sc.section_id && raddr >= sc.offset && raddr < sc.offset + sc.size) {
-				return &sc;
-			}
+		bool wait_all_loaded (u32 timeout_ms) {
+			std::unique_lock<std::mutex> lock(wait_mutex);
+			return loaded_cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&] () { return loads_in_flight == 0; });
 		}
 
-		return nullptr;
-	}
-
-	const ProcSym* find_procsym (Module& mod, u32 sec_id, u32 sec_raddr) {
-		for (auto& ps : mod.procsyms) {
-			// I am not sure proc->len actually refers to the length of the instructions belonging to the function or now
-			// other symbols stored inside the pdb do not have a length
-			// and dbghelp.dll actually SymFromAddr the function name for addresses clearly past the function (padding before the next function)
-			// not sure if that's what I should do as well, I plan to do comparisons with dbghelp with fuzzed inputs/scan the entire exe address space
-			if (sec_id == ps.proc->seg && sec_raddr >= ps.proc->off && sec_raddr < ps.proc->off + ps.proc->len) {
-				return &ps;
-			}
+		void touch (const LoadedModule* mod) {
+			u32 now = clock.load(std::memory_order_relaxed);
+			if (mod->last_used.load(std::memory_order_relaxed) != now)
+				mod->last_used.store(now, std::memory_order_relaxed);
 		}
 
-		return nullptr;
-	}
+		// The module's PDB protected by guard, reloaded if it was evicted,
+		// null if the module has none or it is being loaded in the background (is_loading)
+		PDB_File* get_pdb (const LoadedModule* mod, HazardGuard<PDB_File>& guard) {
+			touch(mod);
+			// nothing gets evicted without a budget, no need to protect
+			auto* pdb = memory_budget.load(std::memory_order_relaxed) == 0 ? mod->pdb.load(std::memory_order_acquire) : guard.protect(mod->pdb);
+			if (pdb || is_loading(mod) || !mod->has_pdb)
+				return pdb;
+
+			auto loaded = acquire_pdb(mod);
+			std::lock_guard<std::mutex> lock(add_mutex);
+			reload(mod, std::move(loaded));
+			// evicting needs add_mutex, so it can't happen between the reload and this
+			return guard.protect(mod->pdb);
+		}
 
-	bool find_source_loc (Module& mod, u32 sec_id, u32 sec_raddr, SourceLoc* out_src_loc) {
-		auto* mi = mod.mi;
+		// Like get_pdb, but pins the PDB for as long as the caller holds on to it (takes add_mutex)
+		std::shared_ptr<PDB_File> pin_pdb (const LoadedModule* mod) {
+			touch(mod);
+			std::shared_ptr<PDB_File> loaded;
+			if (!mod->pdb.load(std::memory_order_acquire) && !is_loading(mod) && mod->has_pdb)
+				loaded = acquire_pdb(mod);
+			std::lock_guard<std::mutex> lock(add_mutex);
+			if (!mod->pdb_owner && !is_loading(mod) && mod->has_pdb)
+				reload(mod, std::move(loaded));
+			return mod->pdb_owner;
+		}
 
-		assert(mod.symbol_stream_data.empty() == (mi->stream_index_of_module_symbol_stream == 0xffff));
-		if (mi->stream_index_of_module_symbol_stream == 0xffff) {
-			return false; // no symbol data
+		size_t resident_bytes () {
+			std::lock_guard<std::mutex> lock(add_mutex);
+			size_t total = 0;
+			for (auto& m : modules)
+				total += m->pdb_owner ? m->pdb_owner->memory_size() : 0;
+			return total;
 		}
-		char* ptr = mod.symbol_stream_data.data();
-		
-		ptr += mi->byte_size_of_symbol_information;
-		ptr += mi->byte_size_of_c11_line_information;
-		
-		//// C13 line info
-		char* c13_line_information = ptr;
-
-		// first pass to find FILECHKSMS ptr
-		char* filechksms_ptr = nullptr;
-		while (ptr < c13_line_information + mi->byte_size_of_c13_line_information) {
-			auto* header = (codeview_subsection_header*)ptr;
-			ptr += sizeof(codeview_subsection_header);
-
-			if (header->type == DEBUG_S_FILECHKSMS) {
-				filechksms_ptr = ptr;
-				break;
-			}
-			else {
-				ptr += header->length;
+
+		// add_mutex must be held, evicts least recently used PDBs until the rest fit the budget, except keep's
+		// PDBs keep growing as their modules get loaded lazily, but this only runs on (re)loads, so the budget can be overshot in between
+		void enforce_budget (const LoadedModule* keep) {
+			size_t total = 0;
+			for (auto& m : modules) {
+				m->pdb_bytes = m->pdb_owner ? m->pdb_owner->memory_size() : 0;
+				total += m->pdb_bytes;
 			}
-		}
-		ptr = c13_line_information; // reset ptr
-		
-		while (ptr < c13_line_information + mi->byte_size_of_c13_line_information) {
-			auto* header = (codeview_subsection_header*)ptr;
-			ptr += sizeof(codeview_subsection_header);
-
-			if (header->type == DEBUG_S_LINES) {
-				auto* lines = (codeview_line_header*)ptr;
-				ptr += sizeof(codeview_line_header);
-				assert(lines->flags == 0); // CV_LINES_HAVE_COLUMNS not implemented
-					
-				if (  lines->contribution_section_id == sec_id &&
-					  sec_raddr >= lines->contribution_offset && sec_raddr < lines->contribution_offset + lines->contribution_size) {
-					u32 proc_raddr = sec_raddr - lines->contribution_offset;
-
-					while (ptr < (char*)lines + header->length) {
-						auto* line_block = (codeview_line_block_header*)ptr;
-						ptr += sizeof(codeview_line_block_header);
-						if (line_block->amount_of_lines > 0) {
-							auto* lines = (codeview_line*)ptr;
-
-							// codeview_lines seems to be sorted by offset, ie code address relative to start of function
-							// there is only offset, no size, so I assume any addresses between this offset and the next belong to the line as well
-							// lines can be out of order (earlier instructions belonging to later lines due to compiler optimizations for example)
-							// lines will be missing (empty lines or lines with no generated code)
-							// different entries can have the same line (single line to multiple instruction spans)
-							// the same offset can appear twice with different lines (I guess multiple related lines that do one thing, maybe also when a statement is split over lines?)
-							//  -> this part makes it confusing to resolve line numbers, as we would usually only return one (but go to disassembly and possibly breakpoints need info for each line!)
-							//     tracy should never double count samples, and indeed dbghelp only reports one line, which appears like the lower one
-							//     but it's unclear if the first match in the list is chosen or if the lower line number is actively chosen TODO:
-
-							codeview_line* prev_line_with_lower_offset = &lines[0];
-							for (u32 i=1; i<line_block->amount_of_lines; i++) {
-								auto* line = &lines[i];
-
-								// scan all lines and pick lowest lineno TODO: this could probably be simplified/accelerated by first deduplicating lines and storing the list of end addresses instead
-								if (proc_raddr < line->offset) {
-									// proc_raddr is in range [prev_offset, offset), so it belongs to all instructions with prev_offset
-									// prev_line_with_lower_offset is the first one of these (lowest line number?)
-									break;
-								}
-								if (line->offset != prev_line_with_lower_offset->offset)
-									prev_line_with_lower_offset = line;
-							}
-							codeview_line* found_line = prev_line_with_lower_offset;
-
-							auto* cksm = (codeview_file_checksum*)(filechksms_ptr + line_block->offset_in_file_checksums);
-							auto* name = &names[cksm->offset_in_string_table];
-
-							*out_src_loc = { name, found_line->start_line_number };
-							return true;
-						}
-					}
-					assert(ptr == (char*)lines + header->length);
+
+			size_t budget = memory_budget;
+			while (budget && total > budget) {
+				LoadedModule* lru = nullptr;
+				for (auto& m : modules) {
+					if (m->pdb_owner && m.get() != keep && (!lru || m->last_used < lru->last_used))
+						lru = m.get();
 				}
+				if (!lru)
+					break; // keep alone is over budget, nothing we can do
+				total -= lru->pdb_bytes;
+
+				// unpublish first, readers that protect it after this see null and come here to reload
+				lru->pdb.store(nullptr, std::memory_order_seq_cst);
+				generation++;
+				retired_pdbs.push_back(std::move(lru->pdb_owner));
+				lru->pdb_owner = nullptr;
+				lru->pdb_bytes = 0;
+				evictions++;
 			}
-			
-			ptr = (char*)header + sizeof(codeview_subsection_header) + header->length;
-		}
-		return false;
-	}
 
-	static std::unique_ptr<PDB_File> try_load_pdb (std::string&& path) {
-		try {
-			return std::make_unique<PDB_File>(std::move(path));
-		} catch (std::exception&) {
-			//fprintf(stderr, "PDB loading exception: %s\n", ex.what());
-		}
-		return nullptr;
-	}
-	PDB_File (std::string&& path) {
-		if (!load_file(path, &data)) {
-			throw std::runtime_error("File not found: "+ path);
+			// drops our reference, the PDB is only freed if no other resolver shares it
+			size_t kept = 0;
+			for (auto& pdb : retired_pdbs) {
+				if (HazardPointers::is_protected(pdb.get())) retired_pdbs[kept++] = std::move(pdb);
+				else                                         pdb = nullptr;
+			}
+			retired_pdbs.resize(kept);
 		}
 
-		printf("%s data loaded\n", path.c_str());
-		
-		read_header();
-		read_stream_table();
-		read_pdb_info();
-		read_names();
-		read_DBI();
-		
-		assert(opt_streams->stream_index_of_section_header_dump != 0xFFFF);
-		read_section_header_dump();
-
-		read_symbol_record_stream();
-
-		printf("PDB read.\n");
-	}
-};
-
-class SymResolver {
-	HANDLE inspectee;
-
-	struct LoadedModule {
-		std::string path;
-
-		uintptr_t base_addr;
-		size_t size;
-
-		std::unique_ptr<PDB_File> pdb;
-
-		LoadedModule (std::string&& path, uintptr_t base_addr, size_t size) {
-			auto pdb_path = std::filesystem::path(path);
-			this->path = std::move(path);
-			this->base_addr = base_addr;
-			this->size = size;
-
-			// Techically there might be more correct ways to find the pdb, and also ways that allow getting pdbs from microsoft servers
-			// see above link
-			pdb_path.replace_extension({".pdb"});
-			pdb = PDB_File::try_load_pdb(pdb_path.string());
+		// Drops modules that were unloaded since the last call, cheap unless the provider changed
+		void sync_provider () {
+			if (provider->changes() == seen_changes.load(std::memory_order_relaxed))
+				return;
+			std::lock_guard<std::mutex> lock(add_mutex);
+			sync_provider_locked();
 		}
-	};
-	struct ModuleCache {
-		TimerMeasurement ttry_get_and_cache_module = TimerMeasurement("try_get_and_cache_module");
+		// add_mutex must be held
+		void sync_provider_locked () {
+			// before checking, so a change that comes in meanwhile makes the next call check again
+			seen_changes = provider->changes();
+			// addresses cached as "Module not found" might be in a newly loaded module
+			generation++;
+
+			auto* old = current.load(std::memory_order_relaxed);
+			auto* snap = new Snapshot{ {}, old->by_id };
+			for (auto* m : old->sorted) {
+				ModuleInfo info;
+				if (provider->find_module(m->base_addr, &info) && info.base == m->base_addr && info.size == m->size && info.path == m->path)
+					snap->sorted.push_back(m);
+			}
+			if (snap->sorted.size() == old->sorted.size()) {
+				delete snap;
+				return;
+			}
 
-		std::vector<LoadedModule> sorted;
-		
-		const LoadedModule* cache (LoadedModule&& m) {
-			auto base_addr = m.base_addr;
-			sorted.push_back(std::move(m));
-			// re-sort
-			std::sort(sorted.begin(), sorted.end(), [] (LoadedModule& l, LoadedModule& r) {
-				return std::less<uintptr_t>()(l.base_addr, r.base_addr);
-			});
+			current.store(snap, std::memory_order_seq_cst);
+			retired.push_back(old);
+			HazardPointers::reclaim(&retired);
+		}
 
-			for (auto& m : sorted) {
-				if (base_addr == m.base_addr) return &m;
+		const LoadedModule* find_module_for_addr (uintptr_t addr) {
+			sync_provider();
+			{
+				HazardGuard<Snapshot> snap(current, HAZARD_SNAPSHOT);
+				if (auto* m = find_in(*snap.get(), addr))
+					return m;
 			}
-			assert(false);
-			return nullptr;
-		}
 
-		const LoadedModule* find_module_for_addr (HANDLE inspectee, uintptr_t addr) {
-			for (auto& m : sorted) {
-				if (addr >= m.base_addr && addr < m.base_addr + m.size) {
-					return &m;
+			// pushed while holding add_mutex, which also guards ttry_get_and_cache_module
+			auto t = Timer::start();
+			std::unique_ptr<LoadedModule> mod;
+			{
+				std::lock_guard<std::mutex> lock(add_mutex);
+				// another thread might have added it while we waited
+				if (auto* m = find_in(*current.load(), addr))
+					return m;
+
+				ModuleInfo info;
+				if (!provider->find_module(addr, &info)) {
+					ttry_get_and_cache_module.push_ticks(get_timestamp() - t.begin);
+					return nullptr;
 				}
+				mod = std::make_unique<LoadedModule>(std::move(info.path), info.base, info.size);
 			}
-			
-			TimerMeasZone(ttry_get_and_cache_module);
-			return try_get_and_cache_module(inspectee, addr);
-		}
 
-		const LoadedModule* try_get_and_cache_module (HANDLE inspectee, uintptr_t addr) {
-			// Only works for addresses in this process
-			//// Do not use FreeLibrary because we set the flag GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT
-			//// see https://learn.microsoft.com/en-us/windows/win32/api/libloaderapi/nf-libloaderapi-getmodulehandleexa to get more information
-			//constexpr DWORD flag = GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT;
-			//HMODULE mod = NULL;
-			//
-			//if (!GetModuleHandleExA(flag, (char*)addr, &mod)) {
-			//	MODULEINFO info;
-			//	if( GetModuleInformation( proc, mod, &info, sizeof( info ) ) != 0 )
-			//	{
-			//		const auto base = uint64_t( info.lpBaseOfDll );
-			//		if( addr >= base && addr < ( base + info.SizeOfImage ) )
-			//		{
-			//			char name[1024];
-			//			const auto nameLength = GetModuleFileNameA( mod, name, sizeof( name ) );
-			//			if( nameLength > 0 )
-			//			{
-			//				// since this is the first time we encounter this module, load its symbols (needed for modules loaded after SymInitialize)
-			//				ImageEntry* cachedModule = LoadSymbolsForModuleAndCache( name, nameLength, (DWORD64)info.lpBaseOfDll, info.SizeOfImage );
-			//				return ModuleNameAndBaseAddress{ cachedModule->m_name, cachedModule->m_startAddress };
-			//			}
-			//		}
-			//	}
-			//}
+			// loaded before the module is published, without holding add_mutex
+			auto pdb = acquire_pdb(mod.get());
+
+			std::lock_guard<std::mutex> lock(add_mutex);
+			ttry_get_and_cache_module.push_ticks(get_timestamp() - t.begin);
+			// another thread might have added it while we loaded (it got the same PDB from the registry)
+			if (auto* m = find_in(*current.load(), addr))
+				return m;
+			// the provider might only have noticed unloads just now, drop them before the new module can overlap one
+			if (provider->changes() != seen_changes.load(std::memory_order_relaxed))
+				sync_provider_locked();
+			return cache(std::move(mod), std::move(pdb));
+		}
 
-			HMODULE modules[1024];
-			DWORD needed = 0;
-			if (!EnumProcessModules(inspectee, modules, sizeof(modules), &needed) || needed > sizeof(modules)) { // TODO: properly handle error
-				print_err_throw("EnumProcessModules");
-			}
+		const LoadedModule* get_module (u32 id) {
+			HazardGuard<Snapshot> snap(current, HAZARD_SNAPSHOT);
+			return id < snap->by_id.size() ? snap->by_id[id] : nullptr;
+		}
 
-			// only return, and cache, the module that addr was in (as opposed to simply aching anything GetModuleInformation returns)
-			// this causes more EnumProcessModules calls, but could help might make find_module_for_addr faster in the case where modules are never queried
-			for (int i=0; i<needed/sizeof(HMODULE); i++) {
-				auto& mod = modules[i];
-
-				MODULEINFO info = {};
-				if (GetModuleInformation(inspectee, mod, &info, sizeof(info))) {
-					auto base = (uintptr_t)info.lpBaseOfDll;
-					auto size = (size_t)info.SizeOfImage;
-					if (addr >= base && addr < base + size) {
-						char name[1024];
-						auto nameLength = GetModuleFileNameExA(inspectee, mod, name, sizeof(name));
-						if (nameLength > 0) {
-							return cache(LoadedModule(std::string(name, nameLength), base, size));
-						}
-					}
-				}
+		// calls func(LoadedModule const&) for the modules in address order until it returns true
+		template <typename FUNC>
+		bool any_of (FUNC func) {
+			HazardGuard<Snapshot> snap(current, HAZARD_SNAPSHOT);
+			for (auto* m : snap->sorted) {
+				if (func(*m))
+					return true;
 			}
-
-			return nullptr;
+			return false;
 		}
 	};
 
@@ -1386,8 +372,11 @@ class SymResolver {
 
 public:
 	typedef const char* err_t;
+	// returned while the module's PDB is loading in the background (see set_async_loading), compare by pointer
+	static inline const err_t PDB_PENDING = "PDB still loading";
 	struct Result {
 		// TODO: dbghelp.dll requires us to pass in a string buffer, and I want to avoid heap alloc for the moment
+		// (see CompactResult for keeping lots of results)
 		static inline constexpr unsigned STRBUF_SIZE = 4096;
 		char str_buf[STRBUF_SIZE];
 
@@ -1401,7 +390,27 @@ public:
 			return src_filepath != nullptr;
 		}
 
-		// TODO: inline frames
+		// Functions inlined at the address, innermost first, sym_name/src_* above are the function they were all inlined into
+		struct InlineFrame {
+			const char* sym_name;
+			const char* src_filepath; // null if no line info
+			uint32_t    src_lineno;
+		};
+		static inline constexpr unsigned MAX_INLINE_FRAMES = 16;
+		InlineFrame inline_frames[MAX_INLINE_FRAMES];
+		uint32_t    num_inline_frames = 0;
+
+		bool inline_frames_equal (Result const& r) const {
+			if (num_inline_frames != r.num_inline_frames) return false;
+			for (uint32_t i=0; i<num_inline_frames; i++) {
+				auto& a = inline_frames[i];
+				auto& b = r.inline_frames[i];
+				if (strcmp(a.sym_name, b.sym_name) != 0) return false;
+				if ((a.src_filepath != nullptr) != (b.src_filepath != nullptr)) return false;
+				if (a.src_filepath && (strcmp(a.src_filepath, b.src_filepath) != 0 || a.src_lineno != b.src_lineno)) return false;
+			}
+			return true;
+		}
 
 		bool operator== (Result const& r) const {
 			// dbghelp.dll not returning module name, assume it's correct
@@ -1443,7 +452,67 @@ public:
 		}
 	};
 
-	SymResolver (HANDLE inspectee): inspectee{inspectee} {}
+	// Resolves addresses in the modules that modules knows about, see ModuleMap for feeding it load and unload events
+	SymResolver (std::shared_ptr<ModuleMapProvider> modules, PDB_File::Options const& pdb_opt = PDB_File::Options()) {
+		assert(modules);
+		mod_cache.provider = std::move(modules);
+		mod_cache.pdb_opt = pdb_opt;
+	}
+#if defined(_WIN32)
+	// Resolves addresses in a live process, enumerating its modules as needed
+	SymResolver (HANDLE inspectee, PDB_File::Options const& pdb_opt = PDB_File::Options()):
+		SymResolver(std::make_shared<ProcessModuleMap>(inspectee), pdb_opt) {}
+#endif
+
+	void set_hot_cache (bool enable) {
+		use_hot_cache = enable;
+	}
+
+	// Limits the PDB data kept in memory (PDB_File::memory_size() of every loaded module), 0 for no limit (the default)
+	// checked whenever a module gets (re)loaded
+	// Set it before resolving. With a budget a PDB can be evicted right after a lookup,
+	// so results then get their strings copied into Result::str_buf instead of pointing into the PDB
+	void set_memory_budget (size_t bytes) {
+		mod_cache.memory_budget = bytes;
+	}
+	// Loads PDBs on a background thread instead of in the addr2sym that first hits their module, which can take seconds
+	// Until a PDB is loaded its addresses fail with PDB_PENDING right away, or after waiting up to wait_ms for it,
+	// addr2sym still sets module_path and puts "module+offset" in sym_name, addr2sym_compact sets module and sym_rva to the offset
+	// on_loaded is called on the loader thread once a PDB is loaded (or failed to), to resolve the pending addresses again
+	// Set it before resolving
+	void set_async_loading (bool enable, u32 wait_ms = 0, std::function<void(const char* module_path, bool loaded)> on_loaded = nullptr) {
+		mod_cache.loader = enable ? std::make_unique<ThreadPool>(2) : nullptr;
+		mod_cache.load_wait_ms = wait_ms;
+		mod_cache.on_loaded = std::move(on_loaded);
+	}
+	// Waits for all background loads started so far, false on timeout
+	bool wait_for_loads (u32 timeout_ms) {
+		return mod_cache.wait_all_loaded(timeout_ms);
+	}
+
+	struct MemoryStats {
+		size_t evictions;
+		size_t reloads;
+		size_t resident_bytes;
+	};
+	MemoryStats get_memory_stats () {
+		return { mod_cache.evictions, mod_cache.reloads, mod_cache.resident_bytes() };
+	}
+	struct HotCacheStats {
+		size_t hits;
+		size_t misses;
+		float hit_rate () const { return hits + misses ? (float)hits / (float)(hits + misses) : 0.0f; }
+	};
+	// The hot cache is per thread, not per resolver, so these count the lookups of every resolver on the calling thread
+	static HotCacheStats get_thread_hot_cache_stats () {
+		auto& hc = get_thread_hot_cache();
+		return { hc.hits, hc.misses };
+	}
+	static void reset_thread_hot_cache_stats () {
+		auto& hc = get_thread_hot_cache();
+		hc.hits = 0;
+		hc.misses = 0;
+	}
 	
 	bool show_addr2sym (char* ptr) {
 		Result res = {};
@@ -1454,6 +523,10 @@ public:
 		}
 
 		printf("#[%16llx]: %-15s!%s %s:%d\n", (uintptr_t)ptr, res.module_path, res.sym_name, res.src_filepath, res.src_lineno);
+		for (uint32_t i=0; i<res.num_inline_frames; i++) {
+			auto& f = res.inline_frames[i];
+			printf("> %-15s @ %s:%d\n", f.sym_name, f.src_filepath ? f.src_filepath : "?", f.src_lineno);
+		}
 		return true;
 	}
 	void warmup_addr2sym (char* ptr) {
@@ -1471,51 +544,622 @@ public:
 		}
 	}
 
-	err_t addr2sym (void* ptr, Result* res) {
-		uintptr_t addr = (uintptr_t)ptr;
+private:
+	// Set-associative cache of finished addr2sym results, sampling profilers keep hitting the same few hundred return addresses
+	// One per thread so lookups need no locking, it belongs to one SymResolver at a time and is cleared when a different one uses it,
+	// so alternating resolvers on one thread just makes it miss
+	// It is also cleared whenever a module was added, as that can resolve addresses that were cached as "Module not found",
+	// and whenever a PDB was evicted, since the entries point into it
+	// Kept at about 35 KB so it stays in L1/L2 next to the PDB data the misses need, most results have no inline frames,
+	// so those go into a small ring shared by all entries instead of a fixed slot per entry
+	struct HotCache {
+		static constexpr u32 SET_BITS = 7;
+		static constexpr u32 SETS = 1u << SET_BITS;
+		static constexpr u32 WAYS = 4;
+		static constexpr u32 MAX_INLINE_FRAMES = 4; // results with more are not cached
+		static constexpr u32 FRAME_POOL = 256; // power of 2
+
+		struct Entry {
+			const char* err;
+			const LoadedModule* mod; // module_path is its path
+			const char* sym_name;
+			const char* src_filepath;
+			uint32_t    src_lineno;
+			uint32_t    num_inline_frames;
+			uint32_t    first_frame; // position in frame_pool, counting every frame ever written
+		};
 
-		auto* mod = mod_cache.find_module_for_addr(inspectee, addr);
-		if (!mod) {
-			return "Module not found";
+		u64 owner = 0; // SymResolver::id
+		u32 generation = 0;
+		// tags are probed on every lookup and kept apart from the entries, 0 marks a free way
+		uintptr_t tags[SETS][WAYS];
+		Entry entries[SETS][WAYS];
+		u8 next_victim[SETS]; // round-robin replacement within the set
+		// inline frames of the entries, an entry whose frames got overwritten by newer ones is dropped on lookup
+		Result::InlineFrame frame_pool[FRAME_POOL];
+		u32 frame_pos = 0;
+
+		size_t hits = 0;
+		size_t misses = 0;
+
+		void reset (u64 new_owner, u32 new_generation) {
+			owner = new_owner;
+			generation = new_generation;
+			memset(tags, 0, sizeof(tags));
+			memset(next_victim, 0, sizeof(next_victim));
 		}
-		if (!mod->pdb) {
-			return "Module pdb not found";
+
+		static u32 set_of (uintptr_t addr) {
+			return (u32)(((u64)addr * 0x9E3779B97F4A7C15ull) >> (64 - SET_BITS));
 		}
 
-		uintptr_t mod_raddr = addr - mod->base_addr;
+		bool lookup (uintptr_t addr, Result* res, err_t* out_err, const LoadedModule** out_mod) {
+			u32 set = set_of(addr);
+			for (u32 way=0; way<WAYS; way++) {
+				if (tags[set][way] != addr)
+					continue;
+				auto& e = entries[set][way];
+				if (!e.err && e.num_inline_frames > 0 && frame_pos - e.first_frame > FRAME_POOL) {
+					tags[set][way] = 0; // frames overwritten
+					break;
+				}
+				*out_err = e.err;
+				*out_mod = e.mod;
+				if (!e.err) {
+					res->module_path = e.mod->path.c_str();
+					res->sym_name = e.sym_name;
+					res->src_filepath = e.src_filepath;
+					res->src_lineno = e.src_lineno;
+					res->num_inline_frames = e.num_inline_frames;
+					for (u32 i=0; i<e.num_inline_frames; i++)
+						res->inline_frames[i] = frame_pool[(e.first_frame + i) % FRAME_POOL];
+				}
+				hits++;
+				return true;
+			}
+			misses++;
+			return false;
+		}
+		void insert (uintptr_t addr, Result const& res, err_t err, const LoadedModule* mod) {
+			if (!err && res.num_inline_frames > MAX_INLINE_FRAMES)
+				return;
+			u32 set = set_of(addr);
+			u32 way = next_victim[set]++ % WAYS;
+			tags[set][way] = addr;
+			auto& e = entries[set][way];
+			e.err = err;
+			if (!err) {
+				e = { nullptr, mod, res.sym_name, res.src_filepath, res.src_lineno, res.num_inline_frames, frame_pos };
+				for (u32 i=0; i<res.num_inline_frames; i++)
+					frame_pool[frame_pos++ % FRAME_POOL] = res.inline_frames[i];
+			}
+		}
+	};
+	static HotCache& get_thread_hot_cache () {
+		thread_local std::unique_ptr<HotCache> cache = std::make_unique<HotCache>();
+		return *cache;
+	}
+
+	static inline std::atomic<u64> next_id = 1;
+	u64 id = next_id++;
+	bool use_hot_cache = true;
+
+	// The proc an address resolved to, addresses in [mod_raddr_begin, mod_raddr_end) resolve to the same proc
+	// so the batch path can skip the symbol search for them
+	struct ProcHit {
+		const LoadedModule* mod = nullptr;
+		PDB_File* pdb = nullptr; // mod's, kept alive by the caller
+		uintptr_t mod_raddr_begin = 0;
+		uintptr_t mod_raddr_end = 0; // empty range if the hit can't be reused
 
+		PDB_File::Module* pdb_mod = nullptr; // null for public symbols, which have no line info
+		const char* sym_name = nullptr;
+		u32 sym_rva = 0; // start of the proc or public
 		u32 sec_id = 0;
-		auto* sec = mod->pdb->find_section_for_addr(mod_raddr, &sec_id);
-		if (!sec) {
-			return "Section not found";
+		uintptr_t sec_base = 0;
+	};
+
+	// index_cursor is only used with the proc index, for ascending addresses within one module
+	err_t find_proc (const LoadedModule* mod, PDB_File* pdb, uintptr_t mod_raddr, ProcHit* hit, size_t* index_cursor) {
+		hit->mod = mod;
+		hit->pdb = pdb;
+
+		if (pdb->has_proc_index()) {
+			assert(mod_raddr <= 0xffffffff);
+			PDB_File::IndexedSymbol sym;
+			if (!pdb->find_symbol_indexed((u32)mod_raddr, &sym, index_cursor)) {
+				return find_public(pdb, mod_raddr, hit, pdb->next_indexed_proc_rva((u32)mod_raddr));
+			}
+			hit->pdb_mod = &pdb->get_module(sym.module);
+			hit->sym_name = sym.name;
+			hit->sym_rva = sym.sym_rva;
+			hit->sec_id = sym.sec_id;
+			hit->sec_base = mod_raddr - sym.sec_raddr;
+			hit->mod_raddr_begin = sym.rva_begin;
+			hit->mod_raddr_end = sym.rva_end;
 		}
+		else {
+			u32 sec_id = 0;
+			auto* sec = pdb->find_section_for_addr(mod_raddr, &sec_id);
+			if (!sec) {
+				return "Section not found";
+			}
 
-		uintptr_t sec_raddr = mod_raddr - sec->base_addr;
-		assert(sec_raddr < 0x7fffffff);
+			assert(mod_raddr - sec->base_addr < 0x7fffffff);
+			u32 sec_raddr = (u32)(mod_raddr - sec->base_addr);
 		
-		auto* sc = mod->pdb->find_section_contribution(sec_id, (s32)sec_raddr);
-		if (!sc) {
-			return "Section contribution not found";
+			auto* sc = pdb->find_section_contribution(sec_id, (s32)sec_raddr);
+			if (!sc) {
+				return find_public(pdb, mod_raddr, hit, 0) ? "Section contribution not found" : nullptr;
+			}
+
+			auto* pdb_mod = &pdb->get_module(sc->module_index);
+			auto* ps = pdb->find_procsym(*pdb_mod, sec_id, sec_raddr);
+			if (!ps) {
+				return find_public(pdb, mod_raddr, hit, 0);
+			}
+			// find_procsym returns the first of possibly overlapping procs, so the range is not reusable here
+			hit->pdb_mod = pdb_mod;
+			hit->sym_name = (const char*)ps->proc->name;
+			hit->sym_rva = (u32)(sec->base_addr + ps->proc->off);
+			hit->sec_id = sec_id;
+			hit->sec_base = sec->base_addr;
+			hit->mod_raddr_begin = mod_raddr;
+			hit->mod_raddr_end = mod_raddr;
+		}
+		return nullptr;
+	}
+	// Fallback for addresses not covered by any proc (stripped PDBs, modules with only public symbols)
+	// the hit holds from mod_raddr up to the next public or next_proc_raddr, whichever comes first
+	err_t find_public (PDB_File* pdb, uintptr_t mod_raddr, ProcHit* hit, uintptr_t next_proc_raddr) {
+		u32 sec_id = 0;
+		auto* sec = pdb->find_section_for_addr(mod_raddr, &sec_id);
+		if (!sec) {
+			return "Section not found";
 		}
+		u32 sec_raddr = (u32)(mod_raddr - sec->base_addr);
 
-		auto& pdb_mod = mod->pdb->modules[sc->module_index];
-		auto* ps = mod->pdb->find_procsym(pdb_mod, sec_id, (u32)sec_raddr);
-		if (!ps) {
+		PDB_File::PublicSymbol pub;
+		if (!pdb->find_public_symbol(sec_id, sec_raddr, &pub)) {
 			return "Symbol not found";
 		}
-		
+		hit->pdb_mod = nullptr;
+		hit->sym_name = pub.name;
+		hit->sym_rva = (u32)(sec->base_addr + pub.sec_offset);
+		hit->sec_id = sec_id;
+		hit->sec_base = sec->base_addr;
+		hit->mod_raddr_begin = mod_raddr;
+		hit->mod_raddr_end = std::min(sec->base_addr + pub.sec_offset + pub.size, next_proc_raddr);
+		return nullptr;
+	}
+	err_t resolve_source (ProcHit const& hit, uintptr_t mod_raddr, Result* res) {
+		if (!hit.pdb_mod) {
+			// like dbghelp, a symbol without a source location is still a result
+			res->module_path = hit.mod->path.c_str();
+			res->sym_name = hit.sym_name;
+			res->src_filepath = nullptr;
+			res->src_lineno = 0;
+			res->num_inline_frames = 0;
+			return nullptr;
+		}
+
 		SourceLoc src_loc = {};
-		if (!mod->pdb->find_source_loc(pdb_mod, sec_id, (u32)sec_raddr, &src_loc)) {
+		if (!hit.pdb->find_source_loc(*hit.pdb_mod, hit.sec_id, (u32)(mod_raddr - hit.sec_base), &src_loc)) {
 			return "Source location not found";
 		}
 
-		res->module_path = mod->path.c_str();
-		res->sym_name = (const char*)ps->proc->name;
+		res->module_path = hit.mod->path.c_str();
+		res->sym_name = hit.sym_name;
 		res->src_filepath = src_loc.filepath;
 		res->src_lineno = src_loc.lineno;
+
+		PDB_File::InlineFrame frames[Result::MAX_INLINE_FRAMES];
+		res->num_inline_frames = hit.pdb->find_inline_frames(*hit.pdb_mod, hit.sec_id, (u32)(mod_raddr - hit.sec_base), frames, Result::MAX_INLINE_FRAMES);
+		for (uint32_t i=0; i<res->num_inline_frames; i++) {
+			res->inline_frames[i] = { frames[i].name, frames[i].src.filepath, frames[i].src.lineno };
+		}
 		return nullptr;
 	}
 
+	// Copies the strings that point into a PDB into str_buf, cut off once it is full
+	static void own_strings (Result* res) {
+		size_t used = 0;
+		auto copy = [&] (const char* str) -> const char* {
+			if (!str) return nullptr;
+			size_t len = std::min(strlen(str), Result::STRBUF_SIZE-1 - used);
+			char* dst = res->str_buf + used;
+			memcpy(dst, str, len);
+			dst[len] = '\0';
+			used = std::min(used + len + 1, (size_t)Result::STRBUF_SIZE-1);
+			return dst;
+		};
+		res->sym_name = copy(res->sym_name);
+		res->src_filepath = copy(res->src_filepath);
+		for (uint32_t i=0; i<res->num_inline_frames; i++) {
+			res->inline_frames[i].sym_name = copy(res->inline_frames[i].sym_name);
+			res->inline_frames[i].src_filepath = copy(res->inline_frames[i].src_filepath);
+		}
+	}
+
+public:
+	err_t addr2sym (void* ptr, Result* res) {
+		uintptr_t addr = (uintptr_t)ptr;
+		bool evicting = mod_cache.memory_budget.load(std::memory_order_relaxed) != 0;
+
+		HazardGuard<PDB_File> pdb(HAZARD_PDB); // keeps the PDB the result points into alive until its strings are copied
+		const LoadedModule* mod = nullptr;
+		err_t err = use_hot_cache && addr != 0 ? addr2sym_hot(addr, res, pdb, evicting, &mod) : addr2sym_uncached(addr, res, pdb, &mod);
+		if (!err && evicting)
+			own_strings(res);
+		if (err == PDB_PENDING)
+			describe_pending(mod, addr - mod->base_addr, res);
+		return err;
+	}
+private:
+	// the "module+offset" result of an address in a module whose PDB is still loading
+	void describe_pending (const LoadedModule* mod, uintptr_t mod_raddr, Result* res) {
+		const char* name = mod->path.c_str();
+		for (const char* c = name; *c; c++) {
+			if (*c == '\\' || *c == '/') name = c+1;
+		}
+		snprintf(res->str_buf, Result::STRBUF_SIZE, "%s+0x%llx", name, (unsigned long long)mod_raddr);
+		res->module_path = mod->path.c_str();
+		res->sym_name = res->str_buf;
+		res->src_filepath = nullptr;
+		res->src_lineno = 0;
+		res->num_inline_frames = 0;
+	}
+
+	// The module's PDB, waiting for a background load up to load_wait_ms, null with *err set if there is none (yet)
+	PDB_File* get_pdb (const LoadedModule* mod, HazardGuard<PDB_File>& guard, err_t* err) {
+		auto* pdb = mod_cache.get_pdb(mod, guard);
+		if (!pdb && mod_cache.is_loading(mod) && mod_cache.load_wait_ms && mod_cache.wait_loaded(mod, mod_cache.load_wait_ms))
+			pdb = mod_cache.get_pdb(mod, guard);
+		if (!pdb)
+			*err = mod_cache.is_loading(mod) ? PDB_PENDING : "Module pdb not found";
+		return pdb;
+	}
+
+	// out_mod is only set if the lookup missed the hot cache, which PDB_PENDING always does
+	err_t addr2sym_hot (uintptr_t addr, Result* res, HazardGuard<PDB_File>& pdb, bool evicting, const LoadedModule** out_mod) {
+		auto& hc = get_thread_hot_cache();
+		mod_cache.sync_provider(); // hits skip find_module_for_addr, which would do it
+		u32 generation = mod_cache.generation;
+		if (hc.owner != id || hc.generation != generation)
+			hc.reset(id, generation);
+
+		err_t err;
+		const LoadedModule* mod;
+		if (hc.lookup(addr, res, &err, &mod)) {
+			// the entry points into mod's PDB, that is still the same one if nothing was evicted since the cache was reset
+			if (err || !evicting || (pdb.protect(mod->pdb) && mod_cache.generation == hc.generation))
+				return err;
+		}
+
+		err = addr2sym_uncached(addr, res, pdb, &mod);
+		*out_mod = mod;
+		// resolving can load a module (here or on another thread), which makes the failures cached so far stale
+		if (mod_cache.generation != generation)
+			hc.reset(id, mod_cache.generation);
+		if (err != PDB_PENDING) // might be worth waiting for next time
+			hc.insert(addr, *res, err, mod);
+		return err;
+	}
+	err_t addr2sym_uncached (uintptr_t addr, Result* res, HazardGuard<PDB_File>& pdb_guard, const LoadedModule** out_mod) {
+		auto* mod = mod_cache.find_module_for_addr(addr);
+		if (out_mod) *out_mod = mod;
+		if (!mod) {
+			return "Module not found";
+		}
+		err_t err;
+		auto* pdb = get_pdb(mod, pdb_guard, &err);
+		if (!pdb) {
+			return err;
+		}
+
+		uintptr_t mod_raddr = addr - mod->base_addr;
+
+		ProcHit hit;
+		if (auto err = find_proc(mod, pdb, mod_raddr, &hit, nullptr)) {
+			return err;
+		}
+		return resolve_source(hit, mod_raddr, res);
+	}
+public:
+
+	// Address of a symbol by name (undecorated proc/data name or decorated public name)
+	// only searches the modules that were loaded so far, modules are loaded on the first address in them (evicted PDBs get reloaded)
+	err_t name2addr (std::string_view name, void** out_addr) {
+		bool found = mod_cache.any_of([&] (LoadedModule const& mod) {
+			HazardGuard<PDB_File> guard(HAZARD_PDB);
+			auto* pdb = mod_cache.get_pdb(&mod, guard);
+			PDB_File::NamedSymbol sym;
+			if (!pdb || !pdb->find_symbol_by_name(name, &sym))
+				return false;
+			*out_addr = (void*)(mod.base_addr + sym.rva);
+			return true;
+		});
+		return found ? nullptr : "Symbol not found";
+	}
+
+	// Resolves count addresses at once, out_results[i] and out_errs[i] (nullptr on success) belong to addrs[i]
+	// Addresses are resolved in sorted order, so every module is found once per run of addresses,
+	// the proc index is walked forward instead of searched from scratch, addresses inside the previous proc skip the symbol search
+	// and duplicates are only resolved once
+	void addr2sym_batch (void* const* addrs, size_t count, Result* out_results, err_t* out_errs) {
+		// Result is huge because of str_buf, so resolve the unique addresses into these
+		// and only write out_results once at the end, in input order
+		struct Resolved {
+			const char* module_path = nullptr;
+			const char* sym_name = nullptr;
+			const char* src_filepath = nullptr;
+			uint32_t    src_lineno = 0;
+			uint32_t    first_inline_frame = 0; // in inline_frames
+			uint32_t    num_inline_frames = 0;
+			const LoadedModule* pending_mod = nullptr; // for PDB_PENDING, described as module+offset at the end
+			uintptr_t   pending_raddr = 0;
+		};
+		std::vector<Resolved> unique;
+		std::vector<err_t> errs;
+		std::vector<u32> slot;
+		std::vector<Result::InlineFrame> inline_frames;
+		std::vector<std::shared_ptr<PDB_File>> pinned;
+
+		bool evicting = batch_unique(addrs, count, &unique, &errs, &slot, &pinned,
+			[&] (const LoadedModule* mod, uintptr_t mod_raddr, Resolved* u) {
+				u->pending_mod = mod;
+				u->pending_raddr = mod_raddr;
+			},
+			[&] (ProcHit const& hit, uintptr_t mod_raddr, Resolved* u) -> err_t {
+				Result res;
+				if (auto err = resolve_source(hit, mod_raddr, &res))
+					return err;
+				u->module_path  = res.module_path;
+				u->sym_name     = res.sym_name;
+				u->src_filepath = res.src_filepath;
+				u->src_lineno   = res.src_lineno;
+				u->first_inline_frame = (uint32_t)inline_frames.size();
+				u->num_inline_frames  = res.num_inline_frames;
+				inline_frames.insert(inline_frames.end(), res.inline_frames, res.inline_frames + res.num_inline_frames);
+				return nullptr;
+			});
+
+		for (size_t i=0; i<count; i++) {
+			out_errs[i] = errs[slot[i]];
+			auto& u = unique[slot[i]];
+			auto& res = out_results[i];
+			if (out_errs[i] == PDB_PENDING)
+				describe_pending(u.pending_mod, u.pending_raddr, &res);
+			if (out_errs[i])
+				continue;
+			res.module_path  = u.module_path;
+			res.sym_name     = u.sym_name;
+			res.src_filepath = u.src_filepath;
+			res.src_lineno   = u.src_lineno;
+			res.num_inline_frames = u.num_inline_frames;
+			std::copy_n(inline_frames.data() + u.first_inline_frame, u.num_inline_frames, res.inline_frames);
+			if (evicting)
+				own_strings(&res); // still pinned
+		}
+	}
+
+	// 16 byte result of which module, symbol and source line an address is in, names are only looked up when asked for,
+	// so resolving and keeping lots of samples (a profiler's) does not drag the 4 KB Result around
+	// The IDs stay valid for the lifetime of the resolver, also across PDB evictions
+	// Inline frames are not included, use addr2sym for those
+	struct CompactResult {
+		static constexpr u32 NO_FILE = 0xffffffff;
+
+		u32 module;  // in load order
+		u32 sym_rva; // start of the symbol, relative to the module
+		u32 file;    // /names offset, NO_FILE for public symbols (procs without a source location are errors like in Result)
+		u32 line;
+
+		bool has_source () const {
+			return file != NO_FILE;
+		}
+		bool operator== (CompactResult const& r) const {
+			return module == r.module && sym_rva == r.sym_rva && file == r.file && line == r.line;
+		}
+	};
+	static_assert(sizeof(CompactResult) == 16, "");
+
+	err_t addr2sym_compact (void* ptr, CompactResult* res) {
+		uintptr_t addr = (uintptr_t)ptr;
+		auto* mod = mod_cache.find_module_for_addr(addr);
+		if (!mod) {
+			return "Module not found";
+		}
+		uintptr_t mod_raddr = addr - mod->base_addr;
+
+		HazardGuard<PDB_File> pdb_guard(HAZARD_PDB);
+		err_t err;
+		auto* pdb = get_pdb(mod, pdb_guard, &err);
+		if (!pdb) {
+			if (err == PDB_PENDING)
+				*res = { mod->id, (u32)mod_raddr, CompactResult::NO_FILE, 0 };
+			return err;
+		}
+
+		ProcHit hit;
+		if (auto err = find_proc(mod, pdb, mod_raddr, &hit, nullptr)) {
+			return err;
+		}
+		return resolve_compact(hit, mod_raddr, res);
+	}
+	// addr2sym_batch for CompactResults
+	void addr2sym_batch_compact (void* const* addrs, size_t count, CompactResult* out_results, err_t* out_errs) {
+		std::vector<CompactResult> unique;
+		std::vector<err_t> errs;
+		std::vector<u32> slot;
+		std::vector<std::shared_ptr<PDB_File>> pinned;
+
+		batch_unique(addrs, count, &unique, &errs, &slot, &pinned,
+			[&] (const LoadedModule* mod, uintptr_t mod_raddr, CompactResult* u) {
+				*u = { mod->id, (u32)mod_raddr, CompactResult::NO_FILE, 0 }; // like addr2sym_compact
+			},
+			[&] (ProcHit const& hit, uintptr_t mod_raddr, CompactResult* u) -> err_t {
+				return resolve_compact(hit, mod_raddr, u);
+			});
+
+		for (size_t i=0; i<count; i++) {
+			out_errs[i] = errs[slot[i]];
+			if (!out_errs[i] || out_errs[i] == PDB_PENDING)
+				out_results[i] = unique[slot[i]];
+		}
+	}
+
+	// Names of a CompactResult, null if not found
+	// like Result these point into the PDB, so with a memory budget they are only safe to use through expand()
+	const char* module_path (CompactResult const& res) {
+		auto* mod = mod_cache.get_module(res.module);
+		return mod ? mod->path.c_str() : nullptr;
+	}
+	const char* sym_name (CompactResult const& res) {
+		auto* mod = mod_cache.get_module(res.module);
+		if (!mod) return nullptr;
+		HazardGuard<PDB_File> pdb_guard(HAZARD_PDB);
+		err_t err;
+		auto* pdb = get_pdb(mod, pdb_guard, &err);
+		ProcHit hit;
+		return pdb && !find_symbol_at(mod, pdb, res, &hit) ? hit.sym_name : nullptr;
+	}
+	const char* src_filepath (CompactResult const& res) {
+		auto* mod = mod_cache.get_module(res.module);
+		if (!mod || !res.has_source()) return nullptr;
+		HazardGuard<PDB_File> pdb_guard(HAZARD_PDB);
+		err_t err;
+		auto* pdb = get_pdb(mod, pdb_guard, &err);
+		return pdb ? pdb->get_file_name(res.file) : nullptr;
+	}
+
+	// The Result a CompactResult stands for, without inline frames
+	err_t expand (CompactResult const& res, Result* out) {
+		auto* mod = mod_cache.get_module(res.module);
+		if (!mod) {
+			return "Module not found";
+		}
+		HazardGuard<PDB_File> pdb_guard(HAZARD_PDB);
+		err_t err;
+		auto* pdb = get_pdb(mod, pdb_guard, &err);
+		if (!pdb) {
+			return err;
+		}
+		ProcHit hit;
+		if ((err = find_symbol_at(mod, pdb, res, &hit)) != nullptr) {
+			return err;
+		}
+		out->module_path = mod->path.c_str();
+		out->sym_name = hit.sym_name;
+		out->src_filepath = res.has_source() ? pdb->get_file_name(res.file) : nullptr;
+		out->src_lineno = res.line;
+		out->num_inline_frames = 0;
+		if (mod_cache.memory_budget.load(std::memory_order_relaxed))
+			own_strings(out);
+		return nullptr;
+	}
+
+private:
+	// a public can start where a proc does (and cover addresses after its end), so look for the kind the result was
+	err_t find_symbol_at (const LoadedModule* mod, PDB_File* pdb, CompactResult const& res, ProcHit* hit) {
+		if (!res.has_source())
+			return find_public(pdb, res.sym_rva, hit, ~(uintptr_t)0);
+		return find_proc(mod, pdb, res.sym_rva, hit, nullptr);
+	}
+	err_t resolve_compact (ProcHit const& hit, uintptr_t mod_raddr, CompactResult* res) {
+		res->module = hit.mod->id;
+		res->sym_rva = hit.sym_rva;
+		res->file = CompactResult::NO_FILE;
+		res->line = 0;
+		if (!hit.pdb_mod)
+			return nullptr; // public symbol
+
+		SourceLoc src_loc = {};
+		if (!hit.pdb->find_source_loc(*hit.pdb_mod, hit.sec_id, (u32)(mod_raddr - hit.sec_base), &src_loc)) {
+			return "Source location not found";
+		}
+		res->file = src_loc.file;
+		res->line = src_loc.lineno;
+		return nullptr;
+	}
+
+	// Common part of the batch functions: resolves every unique address once, in sorted order,
+	// through resolve(hit, mod_raddr, R*), slot[i] is the index into unique and errs for addrs[i]
+	// addresses failing with PDB_PENDING go through pending(mod, mod_raddr, R*) instead, to fill in the module+offset result
+	// With a memory budget, the PDBs used are pinned until the caller drops pinned, so evictions while loading later modules
+	// don't free them under us, returns whether that was the case
+	template <typename R, typename PENDING, typename RESOLVE>
+	bool batch_unique (void* const* addrs, size_t count, std::vector<R>* unique, std::vector<err_t>* errs, std::vector<u32>* slot,
+			std::vector<std::shared_ptr<PDB_File>>* pinned, PENDING pending, RESOLVE resolve) {
+		struct Key {
+			uintptr_t addr;
+			u32 i;
+		};
+		std::vector<Key> keys(count);
+		for (size_t i=0; i<count; i++) keys[i] = { (uintptr_t)addrs[i], (u32)i };
+		std::sort(keys.begin(), keys.end(), [] (Key const& l, Key const& r) {
+			return l.addr < r.addr;
+		});
+
+		slot->resize(count);
+
+		bool evicting = mod_cache.memory_budget.load(std::memory_order_relaxed) != 0;
+		HazardGuard<PDB_File> pdb_guard(HAZARD_PDB);
+
+		const LoadedModule* mod = nullptr;
+		PDB_File* pdb = nullptr;
+		err_t pdb_err = nullptr; // why pdb is null
+		size_t index_cursor = 0;
+		ProcHit hit;
+
+		for (size_t k=0; k<count; k++) {
+			uintptr_t addr = keys[k].addr;
+			if (k > 0 && keys[k-1].addr == addr) {
+				(*slot)[keys[k].i] = (u32)unique->size()-1;
+				continue;
+			}
+			(*slot)[keys[k].i] = (u32)unique->size();
+			unique->emplace_back();
+			auto& err = errs->emplace_back();
+
+			if (!mod || addr < mod->base_addr || addr >= mod->base_addr + mod->size) {
+				mod = mod_cache.find_module_for_addr(addr);
+				index_cursor = 0;
+				hit = {};
+				pdb = nullptr;
+				if (mod && evicting) {
+					pdb = pinned->emplace_back(mod_cache.pin_pdb(mod)).get();
+					pdb_err = pdb ? nullptr : mod_cache.is_loading(mod) ? PDB_PENDING : "Module pdb not found";
+				}
+				else if (mod) {
+					pdb = get_pdb(mod, pdb_guard, &pdb_err);
+				}
+			}
+			if (!mod) {
+				err = "Module not found";
+				continue;
+			}
+			if (!pdb) {
+				err = pdb_err;
+				if (err == PDB_PENDING)
+					pending(mod, addr - mod->base_addr, &unique->back());
+				continue;
+			}
+
+			uintptr_t mod_raddr = addr - mod->base_addr;
+
+			if (hit.mod != mod || mod_raddr < hit.mod_raddr_begin || mod_raddr >= hit.mod_raddr_end) {
+				if ((err = find_proc(mod, pdb, mod_raddr, &hit, &index_cursor)) != nullptr) {
+					hit = {};
+					continue;
+				}
+			}
+			err = resolve(hit, mod_raddr, &unique->back());
+		}
+		return evicting;
+	}
+public:
+
 	void print_timings () {
 		mod_cache.ttry_get_and_cache_module.print();
 		twarmup.print();
@@ -0,0 +1,150 @@
+#pragma once
+#include <stdint.h>
+#include <assert.h>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// Small work-stealing thread pool
+// Every worker takes jobs from the front of its own queue and only steals from the back of the others once it ran dry,
+// so jobs of very uneven size (PDB modules differ by orders of magnitude) still end up spread over all threads
+// The thread calling wait() works on jobs as well, so a pool of 1 thread runs everything serially on the caller
+class ThreadPool {
+	typedef std::function<void()> Job;
+
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+	// queues[0] belongs to the thread calling wait(), queues[i] to threads[i-1]
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> threads;
+
+	std::mutex wake_mutex;
+	std::condition_variable wake_cv;
+	std::condition_variable done_cv;
+
+	std::atomic<size_t> queued = 0;  // jobs in queues, not yet started
+	std::atomic<size_t> pending = 0; // jobs pushed but not finished
+	bool shutdown = false;
+
+	std::atomic<uint32_t> next_queue = 0;
+
+	bool try_pop (uint32_t queuei, bool steal, Job* out_job) {
+		auto& q = *queues[queuei];
+		std::lock_guard<std::mutex> lock(q.mutex);
+		if (q.jobs.empty())
+			return false;
+		if (steal) {
+			*out_job = std::move(q.jobs.back());
+			q.jobs.pop_back();
+		}
+		else {
+			*out_job = std::move(q.jobs.front());
+			q.jobs.pop_front();
+		}
+		queued--;
+		return true;
+	}
+	bool try_run_one (uint32_t self) {
+		Job job;
+		bool found = try_pop(self, false, &job);
+		for (uint32_t i=1; !found && i<(uint32_t)queues.size(); i++) {
+			found = try_pop((self + i) % (uint32_t)queues.size(), true, &job);
+		}
+		if (!found)
+			return false;
+
+		job();
+
+		if (--pending == 0) {
+			std::lock_guard<std::mutex> lock(wake_mutex);
+			done_cv.notify_all();
+		}
+		return true;
+	}
+
+	void worker (uint32_t self) {
+		for (;;) {
+			if (try_run_one(self))
+				continue;
+
+			std::unique_lock<std::mutex> lock(wake_mutex);
+			wake_cv.wait(lock, [&] () { return shutdown || queued > 0; });
+			if (shutdown && queued == 0)
+				return;
+		}
+	}
+
+public:
+	// num_threads = 0 uses all hardware threads
+	ThreadPool (uint32_t num_threads = 0) {
+		if (num_threads == 0)
+			num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+		for (uint32_t i=0; i<num_threads; i++) {
+			queues.push_back(std::make_unique<Queue>());
+		}
+		for (uint32_t i=1; i<num_threads; i++) {
+			threads.emplace_back(&ThreadPool::worker, this, i);
+		}
+	}
+	~ThreadPool () {
+		wait();
+		{
+			std::lock_guard<std::mutex> lock(wake_mutex);
+			shutdown = true;
+		}
+		wake_cv.notify_all();
+		for (auto& t : threads)
+			t.join();
+	}
+
+	ThreadPool (ThreadPool const&) = delete;
+	ThreadPool& operator= (ThreadPool const&) = delete;
+
+	uint32_t num_threads () const {
+		return (uint32_t)queues.size();
+	}
+
+	// Jobs are distributed round-robin over the queues, pushing the biggest jobs first gives the best balance
+	void push (Job job) {
+		uint32_t queuei = next_queue++ % (uint32_t)queues.size();
+		pending++;
+		{ // count before the job becomes visible so queued never underflows
+			std::lock_guard<std::mutex> lock(wake_mutex);
+			queued++;
+		}
+		{
+			auto& q = *queues[queuei];
+			std::lock_guard<std::mutex> lock(q.mutex);
+			q.jobs.push_back(std::move(job));
+		}
+		wake_cv.notify_one();
+	}
+
+	// Runs jobs on the calling thread as well until all pushed jobs are finished
+	void wait () {
+		while (pending > 0) {
+			if (try_run_one(0))
+				continue;
+
+			std::unique_lock<std::mutex> lock(wake_mutex);
+			done_cv.wait(lock, [&] () { return pending == 0 || queued > 0; });
+		}
+	}
+
+	template <typename FUNC>
+	void parallel_for (uint32_t count, FUNC func) {
+		for (uint32_t i=0; i<count; i++) {
+			push([=] () { func(i); });
+		}
+		wait();
+	}
+};
@@ -22,4 +22,47 @@
 			Sleep((DWORD)msecs);
 		}
 	}
+#else
+	#include <time.h>
+	#if defined(KISS_TIMER_TSC) && defined(__x86_64__)
+		#include <x86intrin.h>
+	#endif
+
+	namespace kiss {
+		static uint64_t get_monotonic_ns () {
+			struct timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+		}
+
+	#if defined(KISS_TIMER_TSC) && defined(__x86_64__)
+		uint64_t get_timestamp () {
+			return __rdtsc();
+		}
+
+		// measure the TSC against the monotonic clock once at startup, 10 ms gets it within ~0.1%
+		static uint64_t calibrate_tsc () {
+			uint64_t ns0 = get_monotonic_ns(), tsc0 = __rdtsc();
+			struct timespec ts = { 0, 10000000 };
+			nanosleep(&ts, nullptr);
+			uint64_t ns1 = get_monotonic_ns(), tsc1 = __rdtsc();
+			return (uint64_t)((double)(tsc1 - tsc0) * 1e9 / (double)(ns1 - ns0));
+		}
+		uint64_t timestamp_freq = calibrate_tsc();
+	#else
+		// timestamps in ns, CLOCK_MONOTONIC goes through the vdso, so no syscall
+		uint64_t get_timestamp () {
+			return get_monotonic_ns();
+		}
+
+		uint64_t timestamp_freq = 1000000000ull;
+	#endif
+
+		void sleep_msec (uint32_t msecs) {
+			struct timespec ts;
+			ts.tv_sec  = msecs / 1000;
+			ts.tv_nsec = (long)(msecs % 1000) * 1000000;
+			nanosleep(&ts, nullptr);
+		}
+	}
 #endif
@@ -3,8 +3,13 @@
 #include <stdio.h>
 #include <limits>
 #include <algorithm>
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
 
 namespace kiss {
+	// QueryPerformanceCounter on windows, clock_gettime(CLOCK_MONOTONIC) elsewhere,
+	// or rdtsc on x86-64 with KISS_TIMER_TSC defined, which skips the vdso call but assumes an invariant TSC
 	uint64_t get_timestamp ();
 	extern uint64_t timestamp_freq;
 
@@ -39,6 +44,76 @@ namespace kiss {
 		}
 	};
 	
+	inline int log2_u64 (uint64_t v) {
+	#if defined(_MSC_VER)
+		unsigned long idx; // _BitScanReverse64 is x64 only
+		if (_BitScanReverse(&idx, (unsigned long)(v >> 32)))
+			return (int)idx + 32;
+		_BitScanReverse(&idx, (unsigned long)v);
+		return (int)idx;
+	#else
+		return 63 - __builtin_clzll(v);
+	#endif
+	}
+
+	// Log-bucketed histogram of durations in timestamp ticks, like HdrHistogram: every power of two is split into SUB linear buckets,
+	// so percentiles are within 1/SUB of the real value, while the whole thing is a fixed array that never allocates
+	// Not thread-safe, give every thread its own and merge() them
+	struct TimerHistogram {
+		static constexpr int SUB_BITS = 4;
+		static constexpr int SUB = 1 << SUB_BITS;
+		// values below SUB get a bucket each, then SUB buckets for every power of two up to 2^63
+		static constexpr int BUCKETS = (64 - SUB_BITS + 1) * SUB;
+
+		uint32_t counts[BUCKETS] = {};
+		uint64_t total = 0;
+
+		static int bucket_of (uint64_t ticks) {
+			if (ticks < SUB)
+				return (int)ticks;
+			int exp = log2_u64(ticks);
+			return (exp - SUB_BITS + 1) * SUB + (int)((ticks >> (exp - SUB_BITS)) & (SUB-1));
+		}
+		// middle of the bucket
+		static uint64_t bucket_value (int bucket) {
+			if (bucket < SUB)
+				return (uint64_t)bucket;
+			int exp = bucket / SUB + SUB_BITS - 1;
+			uint64_t width = 1ull << (exp - SUB_BITS);
+			return (1ull << exp) + (uint64_t)(bucket % SUB) * width + width/2;
+		}
+
+		void push (uint64_t ticks) {
+			counts[bucket_of(ticks)]++;
+			total++;
+		}
+		void merge (TimerHistogram const& r) {
+			for (int i=0; i<BUCKETS; i++)
+				counts[i] += r.counts[i];
+			total += r.total;
+		}
+		void clear () {
+			*this = {};
+		}
+
+		// ticks that a fraction p (0-1) of the durations are at or below, 0 if empty
+		uint64_t percentile (double p) const {
+			if (total == 0)
+				return 0;
+			uint64_t rank = std::max((uint64_t)(p * (double)total + 0.5), (uint64_t)1);
+			uint64_t seen = 0;
+			for (int i=0; i<BUCKETS; i++) {
+				seen += counts[i];
+				if (seen >= rank)
+					return bucket_value(i);
+			}
+			return bucket_value(BUCKETS-1);
+		}
+		float percentile_sec (double p) const {
+			return (float)percentile(p) / (float)timestamp_freq;
+		}
+	};
+	
 	struct TimerMeasurement {
 		const char* name;
 
@@ -48,18 +123,38 @@ namespace kiss {
 		float min_sec = std::numeric_limits<float>::infinity();
 		float max_sec = -std::numeric_limits<float>::infinity();
 
-		void push (float sec) {
+		TimerHistogram hist;
+
+		void push_ticks (uint64_t ticks) {
+			float sec = (float)ticks / (float)timestamp_freq;
 			total_sec += sec;
 			min_sec = std::min(min_sec, sec);
 			max_sec = std::max(max_sec, sec);
 			count++;
+			hist.push(ticks);
+		}
+		void push (float sec) {
+			push_ticks((uint64_t)(sec * (float)timestamp_freq));
+		}
+		// for per-thread measurements of the same thing
+		void merge (TimerMeasurement const& r) {
+			total_sec += r.total_sec;
+			count += r.count;
+			min_sec = std::min(min_sec, r.min_sec);
+			max_sec = std::max(max_sec, r.max_sec);
+			hist.merge(r.hist);
+		}
+
+		float percentile_sec (double p) const {
+			return hist.percentile_sec(p);
 		}
 
 		TimerMeasurement (const char* name): name{name} {}
 
 		void print () {
 			auto ms = count > 0 ? (total_sec / (float)count) * 1000000.0f : 0.0f;
-			printf("|Timer %-30s: avg %7.3f us (%dx) min=%7.3f max=%7.3f\n", name, ms, count, min_sec*1000000.0f, max_sec*1000000.0f);
+			printf("|Timer %-30s: avg %7.3f us (%dx) min=%7.3f max=%7.3f p50=%7.3f p90=%7.3f p99=%7.3f p99.9=%7.3f\n", name, ms, count, min_sec*1000000.0f, max_sec*1000000.0f,
+				percentile_sec(0.5)*1000000.0f, percentile_sec(0.9)*1000000.0f, percentile_sec(0.99)*1000000.0f, percentile_sec(0.999)*1000000.0f);
 		}
 	};
 	struct TimerMeasureZone {
@@ -67,7 +162,7 @@ namespace kiss {
 		Timer t;
 		TimerMeasureZone (TimerMeasurement* meas): meas{meas}, t{Timer::start()} {}
 		~TimerMeasureZone () {
-			meas->push(t.elapsed_sec());
+			meas->push_ticks(get_timestamp() - t.begin);
 		}
 	};
 }
@@ -4,6 +4,7 @@
 #endif
 
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
 #include <string>
 #include <string_view>
@@ -17,26 +18,36 @@
 #include "timer.hpp"
 using namespace kiss;
 
-#ifndef WIN32_LEAN_AND_MEAN
-	#define WIN32_LEAN_AND_MEAN
-#endif
-#ifndef WIN32_NOMINMAX
-	#define WIN32_NOMINMAX
-#endif
-#ifndef NOMINMAX
-	#define NOMINMAX
-#endif
+#if defined(_WIN32)
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#ifndef WIN32_NOMINMAX
+		#define WIN32_NOMINMAX
+	#endif
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
 
-#include <windows.h>
+	#include <windows.h>
+	#include <psapi.h>
 
-#undef near
-#undef far
-#undef min
-#undef max
-#undef BF_BOTTOM
-#undef BF_TOP
-#undef ERROR
+	#undef near
+	#undef far
+	#undef min
+	#undef max
+	#undef BF_BOTTOM
+	#undef BF_TOP
+	#undef ERROR
+#else
+	#include <errno.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
 
+#if defined(_WIN32)
 inline void print_err(const char* operation) {
 	auto err = GetLastError();
 
@@ -59,6 +70,16 @@ inline std::string print_err_throw(const char* operation) {
 	print_err(operation);
 	throw std::runtime_error("Win32 Error");
 }
+#else
+inline void print_err(const char* operation) {
+	int err = errno;
+	fprintf(stderr, "%s failed: [%d] {\n%s}\n", operation, err, strerror(err));
+}
+inline std::string print_err_throw(const char* operation) {
+	print_err(operation);
+	throw std::runtime_error("POSIX Error");
+}
+#endif
 
 static bool ends_with(std::string_view str, std::string_view suffix) {
 	return str.size() >= suffix.size() && str.compare(str.size()-suffix.size(), suffix.size(), suffix) == 0;
@@ -88,3 +109,152 @@ inline bool load_file (std::string const& filepath, std::vector<char>* out_data)
 	*out_data = std::move(buffer);
 	return true;
 }
+
+// Read-only view of a whole file, the OS pages it in on demand instead of us copying it into a vector
+// The PDB parser only ever reads from the file, so the mapping can be shared with the page cache
+class MappedFile {
+	const char* ptr = nullptr;
+	size_t      len = 0;
+
+#if defined(_WIN32)
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = NULL;
+#else
+	int fd = -1;
+#endif
+
+public:
+	void close () {
+	#if defined(_WIN32)
+		if (ptr) UnmapViewOfFile(ptr);
+		if (mapping) CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+		file = INVALID_HANDLE_VALUE;
+		mapping = NULL;
+	#else
+		if (ptr) munmap((void*)ptr, len);
+		if (fd >= 0) ::close(fd);
+		fd = -1;
+	#endif
+		ptr = nullptr;
+		len = 0;
+	}
+
+	MappedFile () {}
+	~MappedFile () { close(); }
+
+	MappedFile (MappedFile const&) = delete;
+	MappedFile& operator= (MappedFile const&) = delete;
+
+	const char* data () const { return ptr; }
+	size_t size () const { return len; }
+	bool is_open () const { return ptr != nullptr; }
+
+	// returns false if the file does not exist or is empty, like load_file
+	bool open (std::string const& filepath) {
+		close();
+	#if defined(_WIN32)
+		file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+			close();
+			return false;
+		}
+
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping) {
+			close();
+			print_err_throw("CreateFileMappingA");
+		}
+
+		ptr = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!ptr) {
+			close();
+			print_err_throw("MapViewOfFile");
+		}
+		len = (size_t)size.QuadPart;
+	#else
+		fd = ::open(filepath.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0) {
+			close();
+			return false;
+		}
+
+		void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p == MAP_FAILED) {
+			close();
+			print_err_throw("mmap");
+		}
+		ptr = (const char*)p;
+		len = (size_t)st.st_size;
+	#endif
+		return true;
+	}
+};
+
+// Resident memory of this process, to compare loading strategies
+inline size_t get_resident_bytes (size_t* out_peak=nullptr) {
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS pmc = {};
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+		return 0;
+	if (out_peak) *out_peak = pmc.PeakWorkingSetSize;
+	return pmc.WorkingSetSize;
+#else
+	size_t rss = 0, peak = 0;
+	if (FILE* f = fopen("/proc/self/status", "r")) {
+		char line[256];
+		while (fgets(line, sizeof(line), f)) {
+			unsigned long kb;
+			if (sscanf(line, "VmRSS: %lu kB", &kb) == 1) rss = (size_t)kb * 1024;
+			if (sscanf(line, "VmHWM: %lu kB", &kb) == 1) peak = (size_t)kb * 1024;
+		}
+		fclose(f);
+	}
+	if (out_peak) *out_peak = peak;
+	return rss;
+#endif
+}
+
+// Array that either owns its elements or is a view into memory owned by someone else (like a mapped index cache file)
+// so the lookup code does not care where the data came from
+template <typename T>
+class FlatArray {
+	std::vector<T> owned;
+	const T* ptr = nullptr;
+	size_t count = 0;
+public:
+	FlatArray () {}
+	FlatArray (FlatArray&&) = default;
+	FlatArray& operator= (FlatArray&&) = default;
+	FlatArray (FlatArray const&) = delete;
+	FlatArray& operator= (FlatArray const&) = delete;
+
+	void assign (std::vector<T>&& vec) {
+		owned = std::move(vec);
+		ptr = owned.data();
+		count = owned.size();
+	}
+	void view (const T* data, size_t size) {
+		owned = {};
+		ptr = data;
+		count = size;
+	}
+
+	size_t size () const { return count; }
+	bool empty () const { return count == 0; }
+	bool is_view () const { return ptr && owned.empty(); }
+
+	const T* data () const { return ptr; }
+	const T* begin () const { return ptr; }
+	const T* end () const { return ptr + count; }
+	const T& back () const { assert(count > 0); return ptr[count-1]; }
+	const T& operator[] (size_t i) const { assert(i < count); return ptr[i]; }
+};
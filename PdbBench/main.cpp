@@ -0,0 +1,400 @@
+// Benchmarks SymResolver on one PDB without a live process, so it runs anywhere the PDB is, including Linux
+// The module is mapped at a fixed base through a ModuleMap and the addresses are generated (or replayed) inside of it
+// Prints a summary to stderr and JSON to stdout (or -o), to compare versions against each other
+//
+// linux: g++ -std=c++17 -O2 -I../BetterDbgHelp main.cpp ../BetterDbgHelp/timer.cpp -pthread -o pdb_bench
+
+#include "sym_resolver.hpp"
+#include <random>
+#include <cmath>
+#include <thread>
+
+constexpr uintptr_t MODULE_BASE = 0x140000000ull;
+
+struct BenchOptions {
+	std::string pdb_path;
+	std::string set = "uniform"; // uniform, zipf, sweep or replay
+	std::string addrs_path;      // for replay, hex RVAs (or absolute addresses at MODULE_BASE), one per line
+	std::string out_path;        // empty for stdout
+
+	u32 count = 1000000;
+	u32 hot = 10000;    // distinct addresses for zipf
+	double zipf_s = 1.0;
+	u32 stride = 16;    // for sweep
+	u64 seed = 1;
+
+	u32 threads = 1;    // > 1 adds a throughput run on that many threads
+	bool proc_index = true;
+	u32 page_bits = 12; // proc index page table, 0 for none
+	std::string simd;   // count_le kernel for everything, empty for the detected one
+	bool hot_cache = true;
+	std::string index_cache_dir;
+};
+
+// Addresses in the code sections (.text*, or every section if there are none by that name)
+static bool generate_addrs (BenchOptions const& opt, PDB_File& pdb, std::vector<void*>* out) {
+	std::vector<std::pair<u32, u32>> code; // rva, size
+	for (auto& sec : pdb.get_sections()) {
+		if (sec.name.compare(0, 5, ".text") == 0 && sec.size > 0)
+			code.push_back({ (u32)sec.base_addr, (u32)sec.size });
+	}
+	if (code.empty()) {
+		for (auto& sec : pdb.get_sections())
+			if (sec.size > 0) code.push_back({ (u32)sec.base_addr, (u32)sec.size });
+	}
+	if (code.empty()) {
+		fprintf(stderr, "%s has no sections\n", opt.pdb_path.c_str());
+		return false;
+	}
+	u64 code_size = 0;
+	for (auto& c : code) code_size += c.second;
+
+	// n-th byte of code, counting over all code sections
+	auto code_addr = [&] (u64 n) {
+		n %= code_size;
+		for (auto& c : code) {
+			if (n < c.second) return (void*)(MODULE_BASE + c.first + n);
+			n -= c.second;
+		}
+		assert(false);
+		return (void*)nullptr;
+	};
+
+	std::mt19937_64 rng(opt.seed);
+	out->resize(opt.count);
+
+	if (opt.set == "uniform") {
+		for (auto& a : *out)
+			a = code_addr(rng());
+	}
+	else if (opt.set == "zipf") {
+		// hot distinct addresses, the k-th most frequent with weight 1/k^s, like sampled return addresses
+		std::vector<void*> distinct(std::max(opt.hot, 1u));
+		for (auto& a : distinct)
+			a = code_addr(rng());
+		std::vector<double> cdf(distinct.size());
+		double total = 0;
+		for (size_t k=0; k<cdf.size(); k++)
+			cdf[k] = total += 1.0 / pow((double)(k+1), opt.zipf_s);
+		std::uniform_real_distribution<double> uniform(0.0, total);
+		for (auto& a : *out) {
+			size_t k = std::upper_bound(cdf.begin(), cdf.end(), uniform(rng)) - cdf.begin();
+			a = distinct[std::min(k, distinct.size()-1)];
+		}
+	}
+	else if (opt.set == "sweep") {
+		for (u32 i=0; i<opt.count; i++)
+			(*out)[i] = code_addr((u64)i * opt.stride);
+	}
+	else if (opt.set == "replay") {
+		std::ifstream ifs(opt.addrs_path);
+		if (!ifs) {
+			fprintf(stderr, "Could not open %s\n", opt.addrs_path.c_str());
+			return false;
+		}
+		out->clear();
+		std::string line;
+		while (std::getline(ifs, line)) {
+			if (line.empty() || line[0] == '#')
+				continue;
+			u64 addr = strtoull(line.c_str(), nullptr, 16);
+			out->push_back((void*)(addr >= MODULE_BASE ? addr : MODULE_BASE + addr));
+		}
+		if (out->empty()) {
+			fprintf(stderr, "No addresses in %s\n", opt.addrs_path.c_str());
+			return false;
+		}
+	}
+	else {
+		fprintf(stderr, "Unknown address set %s\n", opt.set.c_str());
+		return false;
+	}
+	return true;
+}
+
+struct ApiResult {
+	const char* name;
+	bool has_latency = false;
+	float p50_ns, p90_ns, p99_ns, p999_ns, max_ns;
+	double addrs_per_sec = 0;
+	double addrs_per_sec_threads = 0; // with BenchOptions::threads
+};
+
+// Per-call latencies in one pass, then throughput in a pass without the timer calls
+template <typename FUNC>
+static ApiResult measure_api (const char* name, std::vector<void*> const& addrs, u32 threads, FUNC resolve) {
+	ApiResult r;
+	r.name = name;
+	r.has_latency = true;
+
+	std::vector<u64> ticks(addrs.size());
+	for (size_t i=0; i<addrs.size(); i++) {
+		u64 t0 = get_timestamp();
+		resolve(addrs[i]);
+		ticks[i] = get_timestamp() - t0;
+	}
+	std::sort(ticks.begin(), ticks.end());
+	auto percentile = [&] (double p) {
+		size_t i = std::min((size_t)(p * (double)ticks.size()), ticks.size()-1);
+		return (float)((double)ticks[i] * 1e9 / (double)timestamp_freq);
+	};
+	r.p50_ns  = percentile(0.5);
+	r.p90_ns  = percentile(0.9);
+	r.p99_ns  = percentile(0.99);
+	r.p999_ns = percentile(0.999);
+	r.max_ns  = percentile(1.0);
+
+	auto t = Timer::start();
+	for (auto* addr : addrs)
+		resolve(addr);
+	r.addrs_per_sec = (double)addrs.size() / t.elapsed_sec();
+
+	if (threads > 1) {
+		std::vector<std::thread> pool;
+		t = Timer::start();
+		for (u32 ti=0; ti<threads; ti++) {
+			pool.emplace_back([&, ti] () {
+				for (size_t i=ti; i<addrs.size(); i+=threads)
+					resolve(addrs[i]);
+			});
+		}
+		for (auto& th : pool) th.join();
+		r.addrs_per_sec_threads = (double)addrs.size() / t.elapsed_sec();
+	}
+	return r;
+}
+
+static void print_usage () {
+	fprintf(stderr,
+		"Usage: pdb_bench -pdb <file> [options]\n"
+		"  -set <name>       uniform (default), zipf, sweep or replay\n"
+		"  -addrs <file>     addresses for -set replay, hex RVAs or absolute addresses at 0x%llx, one per line\n"
+		"  -n <count>        number of addresses to generate (default 1000000)\n"
+		"  -hot <count>      distinct addresses for zipf (default 10000)\n"
+		"  -s <exponent>     zipf exponent (default 1.0)\n"
+		"  -stride <bytes>   step of the sweep (default 16)\n"
+		"  -seed <n>\n"
+		"  -threads <n>      also measure throughput on n threads\n"
+		"  -no_index         resolve without the proc index\n"
+		"  -page_bits <n>    proc index page table with 1 << n byte pages (default 12), 0 for none\n"
+		"  -simd <level>     scalar, sse2 or avx2 leaf scans instead of the best one the cpu has\n"
+		"  -no_hot_cache\n"
+		"  -cache <dir>      index cache directory\n"
+		"  -o <file>         write the JSON there instead of stdout\n", (unsigned long long)MODULE_BASE);
+}
+
+int main (int argc, const char** argv) {
+	BenchOptions opt;
+
+	for (int i=1; i<argc; i++) {
+		std::string_view arg = argv[i];
+		bool has_value = i+1 < argc;
+
+		if      (arg == "-pdb"     && has_value) opt.pdb_path = argv[++i];
+		else if (arg == "-set"     && has_value) opt.set = argv[++i];
+		else if (arg == "-addrs"   && has_value) opt.addrs_path = argv[++i];
+		else if (arg == "-o"       && has_value) opt.out_path = argv[++i];
+		else if (arg == "-n"       && has_value) opt.count = (u32)strtoul(argv[++i], nullptr, 0);
+		else if (arg == "-hot"     && has_value) opt.hot = (u32)strtoul(argv[++i], nullptr, 0);
+		else if (arg == "-s"       && has_value) opt.zipf_s = strtod(argv[++i], nullptr);
+		else if (arg == "-stride"  && has_value) opt.stride = (u32)strtoul(argv[++i], nullptr, 0);
+		else if (arg == "-seed"    && has_value) opt.seed = strtoull(argv[++i], nullptr, 0);
+		else if (arg == "-threads" && has_value) opt.threads = std::max((u32)strtoul(argv[++i], nullptr, 0), 1u);
+		else if (arg == "-cache"   && has_value) opt.index_cache_dir = argv[++i];
+		else if (arg == "-page_bits" && has_value) opt.page_bits = std::min((u32)strtoul(argv[++i], nullptr, 0), 24u);
+		else if (arg == "-simd"    && has_value) opt.simd = argv[++i];
+		else if (arg == "-no_index")     opt.proc_index = false;
+		else if (arg == "-no_hot_cache") opt.hot_cache = false;
+		else {
+			print_usage();
+			return 1;
+		}
+	}
+	if (opt.pdb_path.empty() || (opt.set == "replay" && opt.addrs_path.empty())) {
+		print_usage();
+		return 1;
+	}
+
+	auto detected = search_layout::simd_level;
+	if (!opt.simd.empty()) {
+		auto level = opt.simd == "avx2" ? search_layout::SIMD_AVX2 : opt.simd == "sse2" ? search_layout::SIMD_SSE2 : search_layout::SIMD_SCALAR;
+		if (level > detected || (opt.simd != "scalar" && opt.simd != "sse2" && opt.simd != "avx2")) {
+			fprintf(stderr, "Can't use -simd %s on this cpu (%s)\n", opt.simd.c_str(), search_layout::simd_level_name(detected));
+			return 1;
+		}
+		search_layout::simd_level = level;
+	}
+
+	PDB_File::Options pdb_opt;
+	pdb_opt.proc_index = opt.proc_index;
+	pdb_opt.proc_page_bits = opt.page_bits;
+	pdb_opt.index_cache_dir = opt.index_cache_dir;
+	pdb_opt.quiet = true;
+
+	// acquired through the registry, so the resolver gets this same PDB instead of loading it again
+	auto t = Timer::start();
+	auto pdb = PdbRegistry::global().acquire(opt.pdb_path, pdb_opt);
+	float open_sec = t.elapsed_sec();
+	if (!pdb) {
+		fprintf(stderr, "Could not load %s\n", opt.pdb_path.c_str());
+		return 1;
+	}
+
+	std::vector<void*> addrs;
+	if (!generate_addrs(opt, *pdb, &addrs))
+		return 1;
+
+	auto modules = std::make_shared<ModuleMap>();
+	size_t image_size = 0;
+	for (auto& sec : pdb->get_sections())
+		image_size = std::max(image_size, (size_t)(sec.base_addr + sec.size));
+	modules->load(opt.pdb_path, MODULE_BASE, image_size); // the pdb is found by replacing the extension, so the pdb path itself works
+
+	SymResolver resolver(modules, pdb_opt);
+	resolver.set_hot_cache(opt.hot_cache);
+
+	// cold pass, loads the modules the addresses are in
+	size_t failed = 0;
+	t = Timer::start();
+	for (auto* addr : addrs) {
+		SymResolver::Result res;
+		if (resolver.addr2sym(addr, &res))
+			failed++;
+	}
+	float warmup_sec = t.elapsed_sec();
+
+	std::vector<ApiResult> apis;
+	apis.push_back(measure_api("addr2sym", addrs, opt.threads, [&] (void* addr) {
+		SymResolver::Result res;
+		resolver.addr2sym(addr, &res);
+	}));
+	apis.push_back(measure_api("addr2sym_compact", addrs, opt.threads, [&] (void* addr) {
+		SymResolver::CompactResult res;
+		resolver.addr2sym_compact(addr, &res);
+	}));
+	if (opt.proc_index) { // the index lookup alone, with and without the page table
+		auto& index = pdb->get_proc_index();
+		apis.push_back(measure_api("proc_index_binary_search", addrs, opt.threads, [&] (void* addr) {
+			volatile s64 i = index.find_binary_search((u32)((uintptr_t)addr - MODULE_BASE));
+			(void)i;
+		}));
+		if (!index.page_first.empty()) {
+			apis.push_back(measure_api("proc_index_page_table", addrs, opt.threads, [&] (void* addr) {
+				volatile s64 i = index.find((u32)((uintptr_t)addr - MODULE_BASE));
+				(void)i;
+			}));
+		}
+
+		// the search layouts side by side over the same rvas, PDB_File only uses the one it was compiled with (PDB_SEARCH_LAYOUT)
+		auto measure_layout = [&] (const char* name, auto layout) {
+			layout.build(index.rva_begin.data(), index.size());
+			apis.push_back(measure_api(name, addrs, opt.threads, [&] (void* addr) {
+				volatile size_t i = layout.upper_bound((u32)((uintptr_t)addr - MODULE_BASE));
+				(void)i;
+			}));
+		};
+		measure_layout("search_sorted",    SortedSearch<u32>());
+		measure_layout("search_eytzinger", EytzingerSearch<u32>());
+		measure_layout("search_btree",     BTreeSearch<u32>());
+
+		// and the B+-tree and page table leaf scans with every kernel the cpu has
+		static const char* names[][2] = {
+			{ "search_btree_scalar", "proc_index_page_table_scalar" },
+			{ "search_btree_sse2",   "proc_index_page_table_sse2" },
+			{ "search_btree_avx2",   "proc_index_page_table_avx2" },
+		};
+		auto level = search_layout::simd_level;
+		for (int l=search_layout::SIMD_SCALAR; l<=detected; l++) {
+			search_layout::simd_level = (search_layout::SimdLevel)l;
+			measure_layout(names[l][0], BTreeSearch<u32>());
+			if (!index.page_first.empty()) {
+				apis.push_back(measure_api(names[l][1], addrs, opt.threads, [&] (void* addr) {
+					volatile s64 i = index.find((u32)((uintptr_t)addr - MODULE_BASE));
+					(void)i;
+				}));
+			}
+		}
+		search_layout::simd_level = level;
+	}
+	{ // the batch API only has a throughput
+		ApiResult r;
+		r.name = "addr2sym_batch_compact";
+		std::vector<SymResolver::CompactResult> res(addrs.size());
+		std::vector<SymResolver::err_t> errs(addrs.size());
+		auto t = Timer::start();
+		resolver.addr2sym_batch_compact(addrs.data(), addrs.size(), res.data(), errs.data());
+		r.addrs_per_sec = (double)addrs.size() / t.elapsed_sec();
+		apis.push_back(r);
+	}
+	size_t peak_rss = 0;
+	get_resident_bytes(&peak_rss);
+	auto& lt = pdb->get_load_times();
+	size_t pdb_bytes = pdb->memory_size();
+	auto pages = opt.proc_index ? pdb->get_proc_index().page_table_stats() : PDB_File::ProcIndex::PageTableStats{};
+
+	fprintf(stderr, "%s: %zu addresses (%s), %zu unresolved, open %.3f ms, warmup %.3f ms, peak rss %.1f MB\n",
+		opt.pdb_path.c_str(), addrs.size(), opt.set.c_str(), failed, open_sec*1000, warmup_sec*1000, (double)peak_rss / (1024*1024));
+	fprintf(stderr, "  load phases: file %.3f ms, stream table %.3f ms, dbi %.3f ms, modules %.3f ms, index %.3f ms, index cache %.3f ms\n",
+		lt.file_sec*1000, lt.stream_table_sec*1000, lt.dbi_sec*1000, lt.modules_sec*1000, lt.index_sec*1000, lt.index_cache_sec*1000);
+	if (pages.pages > 0)
+		fprintf(stderr, "  proc page table: %zu pages of %u bytes, %zu dense, at most %zu procs in a page, %.1f KB\n",
+			pages.pages, 1u << opt.page_bits, pages.dense_pages, pages.max_procs, (double)pages.bytes / 1024);
+	for (auto& r : apis) {
+		if (r.has_latency)
+			fprintf(stderr, "  %-28s p50 %8.0f ns  p90 %8.0f ns  p99 %8.0f ns  p99.9 %8.0f ns  max %9.0f ns  %10.0f addr/s",
+				r.name, r.p50_ns, r.p90_ns, r.p99_ns, r.p999_ns, r.max_ns, r.addrs_per_sec);
+		else
+			fprintf(stderr, "  %-28s %96.0f addr/s", r.name, r.addrs_per_sec);
+		if (r.addrs_per_sec_threads > 0)
+			fprintf(stderr, "  %10.0f addr/s on %u threads", r.addrs_per_sec_threads, opt.threads);
+		fprintf(stderr, "\n");
+	}
+
+	FILE* out = stdout;
+	if (!opt.out_path.empty()) {
+		out = fopen(opt.out_path.c_str(), "w");
+		if (!out) {
+			fprintf(stderr, "Could not open %s\n", opt.out_path.c_str());
+			return 1;
+		}
+	}
+	// paths can have backslashes
+	std::string pdb_json;
+	for (char c : opt.pdb_path) {
+		if (c == '\\' || c == '"') pdb_json += '\\';
+		pdb_json += c;
+	}
+	fprintf(out, "{\n");
+	fprintf(out, "  \"pdb\": \"%s\",\n", pdb_json.c_str());
+	fprintf(out, "  \"set\": \"%s\",\n", opt.set.c_str());
+	fprintf(out, "  \"count\": %zu,\n", addrs.size());
+	fprintf(out, "  \"unresolved\": %zu,\n", failed);
+	fprintf(out, "  \"threads\": %u,\n", opt.threads);
+	fprintf(out, "  \"simd\": \"%s\",\n", search_layout::simd_level_name(search_layout::simd_level));
+	fprintf(out, "  \"proc_index\": %s,\n", opt.proc_index ? "true" : "false");
+	fprintf(out, "  \"hot_cache\": %s,\n", opt.hot_cache ? "true" : "false");
+	fprintf(out, "  \"index_cache\": %s,\n", opt.index_cache_dir.empty() ? "false" : "true");
+	fprintf(out, "  \"page_table\": { \"page_bits\": %u, \"pages\": %zu, \"dense_pages\": %zu, \"max_procs\": %zu, \"bytes\": %zu },\n",
+		pages.pages > 0 ? opt.page_bits : 0, pages.pages, pages.dense_pages, pages.max_procs, pages.bytes);
+	// open is the whole PDB_File constructor, the phases after it are its parts
+	fprintf(out, "  \"phases_ms\": { \"open\": %.3f, \"file\": %.3f, \"stream_table\": %.3f, \"dbi\": %.3f, \"modules\": %.3f, \"index\": %.3f, \"index_cache\": %.3f, \"warmup\": %.3f },\n",
+		open_sec*1000, lt.file_sec*1000, lt.stream_table_sec*1000, lt.dbi_sec*1000, lt.modules_sec*1000, lt.index_sec*1000, lt.index_cache_sec*1000, warmup_sec*1000);
+	fprintf(out, "  \"apis\": [\n");
+	for (size_t i=0; i<apis.size(); i++) {
+		auto& r = apis[i];
+		fprintf(out, "    { \"name\": \"%s\", ", r.name);
+		if (r.has_latency)
+			fprintf(out, "\"latency_ns\": { \"p50\": %.0f, \"p90\": %.0f, \"p99\": %.0f, \"p999\": %.0f, \"max\": %.0f }, ",
+				r.p50_ns, r.p90_ns, r.p99_ns, r.p999_ns, r.max_ns);
+		fprintf(out, "\"addrs_per_sec\": %.0f", r.addrs_per_sec);
+		if (r.addrs_per_sec_threads > 0)
+			fprintf(out, ", \"addrs_per_sec_threads\": %.0f", r.addrs_per_sec_threads);
+		fprintf(out, " }%s\n", i+1 < apis.size() ? "," : "");
+	}
+	fprintf(out, "  ],\n");
+	fprintf(out, "  \"pdb_bytes\": %zu,\n", pdb_bytes);
+	fprintf(out, "  \"peak_rss_bytes\": %zu\n", peak_rss);
+	fprintf(out, "}\n");
+	if (out != stdout) fclose(out);
+	return 0;
+}
@@ -0,0 +1,918 @@
+// Writes synthetic but valid MSF 7.00 PDB files of configurable size, to benchmark PDB_File and SymResolver at scales
+// we don't have real PDBs for (tens of thousands of modules, 10M procs)
+//
+// Module symbol streams are referenced by u16 stream indices with 0xffff meaning none, and the 10 fixed streams come first,
+// so a valid PDB can have at most MAX_MODULES = 65525 modules with symbols. 100k modules can't be written (or read) as a PDB at all.
+//
+// linux: g++ -std=c++17 -O2 -I../BetterDbgHelp main.cpp ../BetterDbgHelp/timer.cpp -o pdb_generator
+//
+// Sweeping size against load time and lookup latency, with PdbBench:
+//   for m in 100 1000 10000 65000; do ./pdb_generator -o gen_$m.pdb -modules $m && ./pdb_bench -pdb gen_$m.pdb -o gen_$m.json; done
+
+#include "pdb_file.hpp"
+#include <random>
+
+// u16 stream indices, minus the 10 fixed streams and 0xffff
+static constexpr u32 MAX_MODULES = 0xffff - 10;
+
+struct GenOptions {
+	std::string out_path = "synthetic.pdb";
+
+	u32 modules          = 100;
+	u32 procs_per_module = 100;
+	u32 lines_per_proc   = 8;
+	u32 files_per_module = 4;
+	bool publics         = true;
+	// modules without a symbol stream, like in a stripped PDB, so only their publics can be found
+	u32 stripped_modules = 0;
+
+	u32 min_proc_size    = 16;
+	u32 max_proc_size    = 512;
+	u32 proc_align       = 16;
+
+	u32 page_size        = 4096;
+	// shuffle stream pages to exercise the code paths for fragmented streams
+	bool fragment        = false;
+
+	// procs of at least 64 bytes get an inline site with a nested one, using inline_funcs distinct inlinees
+	u32 inline_funcs     = 32;
+
+	// every n-th module gets procs nested in or aliasing its procs, and section contributions of the next module overlapping its own
+	// like ICF and /OPT:REF leave them in real PDBs, so first in file/module order wins in the lookups (0 for none)
+	u32 overlaps         = 0;
+
+	u32 seed             = 1;
+};
+
+// Simple little-endian byte buffer
+struct Buffer {
+	std::vector<char> data;
+
+	size_t size () const { return data.size(); }
+
+	template <typename T>
+	size_t push (T const& val) {
+		size_t offs = data.size();
+		data.insert(data.end(), (const char*)&val, (const char*)&val + sizeof(T));
+		return offs;
+	}
+	size_t push_bytes (const void* ptr, size_t size) {
+		size_t offs = data.size();
+		data.insert(data.end(), (const char*)ptr, (const char*)ptr + size);
+		return offs;
+	}
+	size_t push_str (std::string_view str) {
+		size_t offs = push_bytes(str.data(), str.size());
+		data.push_back('\0');
+		return offs;
+	}
+	// CVCompressData
+	void push_compressed (u32 val) {
+		if (val < 0x80) {
+			push<u8>((u8)val);
+		}
+		else if (val < 0x4000) {
+			push<u8>((u8)(val >> 8 | 0x80));
+			push<u8>((u8)val);
+		}
+		else {
+			assert(val < 0x20000000);
+			push<u8>((u8)(val >> 24 | 0xC0));
+			push<u8>((u8)(val >> 16));
+			push<u8>((u8)(val >> 8));
+			push<u8>((u8)val);
+		}
+	}
+	static u32 encode_signed (s32 val) {
+		return val >= 0 ? (u32)val << 1 : (u32)-val << 1 | 1;
+	}
+	void align (u32 alignment, char pad=0) {
+		while (data.size() % alignment)
+			data.push_back(pad);
+	}
+	template <typename T>
+	T* at (size_t offs) {
+		return (T*)(data.data() + offs);
+	}
+};
+
+class PdbGenerator {
+	GenOptions opt;
+	std::mt19937 rng;
+
+	std::vector<Buffer> streams;
+
+	u32 add_stream () {
+		streams.emplace_back();
+		return (u32)streams.size()-1;
+	}
+
+	// /names string table
+	Buffer names_strings;
+	std::unordered_map<std::string, u32> names_lookup;
+
+	u32 intern_name (std::string const& str) {
+		auto it = names_lookup.find(str);
+		if (it != names_lookup.end())
+			return it->second;
+		u32 offs = (u32)names_strings.push_str(str);
+		names_lookup[str] = offs;
+		return offs;
+	}
+
+	struct GenProc {
+		std::string name;
+		u32 rva;
+		u32 size;
+		u32 sym_offset; // of its S_GPROC32 in the module symbol stream
+		bool overlap = false; // nested in or aliasing the proc before or after it, no lines, inline sites or public of its own
+	};
+	struct GenModule {
+		std::string name;
+		u32 stream;
+		u32 rva; // start of its contribution in .text
+		u32 size;
+		std::vector<GenProc> procs;
+		u32 sym_bytes, c13_bytes;
+	};
+	std::vector<GenModule> modules;
+
+	struct GenSection {
+		const char* name;
+		u32 rva;
+		u32 size;
+		u32 characteristics;
+	};
+	std::vector<GenSection> sections;
+
+	struct GenContrib {
+		u32 module;
+		u32 rva;
+		u32 size;
+	};
+	// written before and after the contribution of each module
+	std::vector<GenContrib> contribs_before, contribs_after;
+
+	// the proc just added to mod gets one nested in it before it in module order (which wins, splitting it), one after (which never wins)
+	// or an alias with the same range after it
+	void add_overlapping_procs (GenModule& mod, u32 module_index, u32 proc_index) {
+		GenProc outer = mod.procs.back();
+		if (outer.size < 64)
+			return;
+		GenProc proc;
+		proc.overlap = true;
+		switch (proc_index % 4) {
+			case 0:
+			case 1: {
+				proc.name = "mod" + std::to_string(module_index) + "::nested" + std::to_string(proc_index);
+				proc.rva = outer.rva + align_to(outer.size / 4, 4);
+				proc.size = outer.size / 2;
+				if (proc_index % 4 == 0) mod.procs.insert(mod.procs.end()-1, proc);
+				else                     mod.procs.push_back(proc);
+			} break;
+			case 2: {
+				proc.name = "mod" + std::to_string(module_index) + "::alias" + std::to_string(proc_index);
+				proc.rva = outer.rva;
+				proc.size = outer.size;
+				mod.procs.push_back(proc);
+			} break;
+		}
+	}
+
+	u32 rand_range (u32 lo, u32 hi) {
+		return std::uniform_int_distribution<u32>(lo, hi)(rng);
+	}
+	static u32 align_to (u32 x, u32 a) {
+		return (x + a-1) / a * a;
+	}
+
+	void layout () {
+		u32 text_rva = 0x1000;
+		u32 cur = text_rva;
+
+		modules.resize(opt.modules);
+		for (u32 m=0; m<opt.modules; m++) {
+			auto& mod = modules[m];
+			mod.name = "mod" + std::to_string(m) + ".obj";
+			mod.rva = cur;
+
+			for (u32 p=0; p<opt.procs_per_module; p++) {
+				GenProc proc;
+				proc.name = "mod" + std::to_string(m) + "::func" + std::to_string(p);
+				proc.rva = cur;
+				proc.size = rand_range(opt.min_proc_size, opt.max_proc_size);
+				mod.procs.push_back(proc);
+
+				// leave some padding between functions like the linker does
+				cur = align_to(cur + proc.size, opt.proc_align);
+
+				if (opt.overlaps > 0 && m % opt.overlaps == opt.overlaps-1)
+					add_overlapping_procs(mod, m, p);
+			}
+			mod.size = cur - mod.rva;
+
+			if (opt.overlaps > 0 && m % opt.overlaps == opt.overlaps-1 && m+1 < opt.modules) {
+				// the next module owns the last quarter, cutting the procs there, but neither the same range nor a nested one written later
+				u32 quarter = align_to(mod.size / 4, 4);
+				contribs_before.push_back({ m+1, mod.rva + mod.size - quarter, quarter });
+				contribs_after.push_back({ m+1, mod.rva, mod.size });
+				contribs_after.push_back({ m+1, mod.rva + quarter, quarter });
+			}
+		}
+		u32 text_size = cur - text_rva;
+		sections.push_back({ ".text", text_rva, text_size, 0x60000020 });
+
+		// virtual sizes are unaligned, so there is always a gap to the next section
+		u32 rdata_rva = align_to(cur + 1, 0x1000);
+		sections.push_back({ ".rdata", rdata_rva, 0x800, 0x40000040 });
+		sections.push_back({ ".data", rdata_rva + 0x1000, 0x800, 0xC0000040 });
+	}
+
+public:
+	// Which inlinees a proc gets and the code ranges, also used by tests to know what to expect
+	// site 0 is inlined into the proc, site 1 into site 0
+	struct GenInlineRange {
+		u32 offset; // relative to the proc
+		u32 size;
+		u32 line_delta; // relative to the inlinee's line in DEBUG_S_INLINEELINES
+		u32 file; // index of the module's file
+	};
+	static bool proc_has_inlines (u32 proc_size) {
+		return proc_size >= 64;
+	}
+	static u32 inline_base_line (u32 inlinee_index) {
+		return 100 + inlinee_index * 10;
+	}
+	u32 inlinee_for (u32 module_index, u32 proc_index, u32 depth) const {
+		return (module_index * 7 + proc_index + depth) % opt.inline_funcs;
+	}
+	static std::vector<GenInlineRange> inline_ranges (u32 proc_size, u32 depth) {
+		u32 q = proc_size / 4;
+		if (depth == 0) {
+			return {
+				{ q,         q/2, 1, 0 },
+				{ q + q/2,   q/2, 3, 0 },
+				{ q + 3*(q/2), q/4, 2, 0 },
+			};
+		}
+		return {
+			{ q + 4, 4, 0, 0 },
+			{ q + 8, 4, 1, 1 },
+		};
+	}
+private:
+	// binary annotations producing inline_ranges(), using most of the opcodes
+	void write_inline_annotations (Buffer& s, u32 proc_size, u32 depth, std::vector<u32> const& file_chksm_offs) {
+		u32 q = proc_size / 4;
+		if (depth == 0) {
+			s.push_compressed(BA_OP_ChangeLineOffset);
+			s.push_compressed(Buffer::encode_signed(1));
+			s.push_compressed(BA_OP_ChangeCodeOffset);
+			s.push_compressed(q); // range 0 starts, length until the next one
+			s.push_compressed(BA_OP_ChangeLineOffset);
+			s.push_compressed(Buffer::encode_signed(2));
+			s.push_compressed(BA_OP_ChangeCodeOffset);
+			s.push_compressed(q/2); // range 1
+			s.push_compressed(BA_OP_ChangeCodeLength);
+			s.push_compressed(q/2);
+			s.push_compressed(BA_OP_ChangeLineOffset);
+			s.push_compressed(Buffer::encode_signed(-1));
+			s.push_compressed(BA_OP_ChangeCodeLengthAndCodeOffset);
+			s.push_compressed(q/4); // range 2 length
+			s.push_compressed(q/2); // gap
+		}
+		else {
+			s.push_compressed(BA_OP_ChangeCodeOffset);
+			s.push_compressed(q + 4);
+			s.push_compressed(BA_OP_ChangeFile);
+			s.push_compressed(file_chksm_offs[1 % file_chksm_offs.size()]);
+			s.push_compressed(BA_OP_ChangeCodeOffsetAndLineOffset);
+			s.push_compressed(Buffer::encode_signed(1) << 4 | 4);
+			s.push_compressed(BA_OP_ChangeCodeLength);
+			s.push_compressed(4);
+		}
+	}
+	// file checksums are written after the symbols, but their offsets are known up front since checksum_size is 0
+	static u32 file_chksm_offset (u32 file) {
+		return file * 8;
+	}
+
+	// S_GPROC32 records (with S_INLINESITEs) followed by S_END, then C13 FILECHKSMS, one DEBUG_S_LINES per proc and DEBUG_S_INLINEELINES
+	void write_module_stream (GenModule& mod, u32 module_index) {
+		auto& s = streams[mod.stream];
+		s.push<u32>(4); // CV_SIGNATURE_C13
+
+		std::vector<u32> file_chksm_offs;
+		for (u32 f=0; f<opt.files_per_module; f++)
+			file_chksm_offs.push_back(file_chksm_offset(f));
+
+		for (u32 p=0; p<(u32)mod.procs.size(); p++) {
+			auto& proc = mod.procs[p];
+			size_t start = s.size();
+			proc.sym_offset = (u32)start;
+			s.push<u16>(0); // length, patched below
+			s.push<u16>(S_GPROC32);
+			s.push<u32>(0); // pParent
+			size_t pEnd = s.push<u32>(0);
+			s.push<u32>(0); // pNext
+			s.push<u32>(proc.size); // len
+			s.push<u32>(0); // DbgStart
+			s.push<u32>(proc.size); // DbgEnd
+			s.push<u32>(0); // typind
+			s.push<u32>(proc.rva - sections[0].rva); // off
+			s.push<u16>(1); // seg
+			s.push<u8>(0); // flags
+			s.push_str(proc.name);
+			s.align(4);
+			*s.at<u16>(start) = (u16)(s.size() - start - sizeof(u16));
+
+			if (opt.inline_funcs > 0 && proc_has_inlines(proc.size) && !proc.overlap) {
+				size_t parent = start;
+				std::vector<size_t> site_ends;
+				for (u32 depth=0; depth<2; depth++) {
+					size_t site = s.size();
+					s.push<u16>(0);
+					s.push<u16>(S_INLINESITE);
+					s.push<u32>((u32)parent); // pParent
+					site_ends.push_back(s.push<u32>(0)); // pEnd
+					s.push<u32>(0x1000 + inlinee_for(module_index, p, depth)); // inlinee
+					write_inline_annotations(s, proc.size, depth, file_chksm_offs);
+					s.align(4); // padding is BA_OP_Invalid
+					*s.at<u16>(site) = (u16)(s.size() - site - sizeof(u16));
+					parent = site;
+				}
+				for (u32 depth=2; depth-- > 0;) {
+					*s.at<u32>(site_ends[depth]) = (u32)s.size();
+					s.push<u16>(2);
+					s.push<u16>(S_INLINESITE_END);
+				}
+			}
+
+			*s.at<u32>(pEnd) = (u32)s.size();
+			s.push<u16>(2);
+			s.push<u16>(S_END);
+		}
+		mod.sym_bytes = (u32)s.size();
+
+		size_t c13_start = s.size();
+
+		// file checksums, checksum_size 0 so each entry is 8 bytes
+		{
+			s.push<u32>(DEBUG_S_FILECHKSMS);
+			size_t len = s.push<u32>(0);
+			size_t start = s.size();
+			for (u32 f=0; f<opt.files_per_module; f++) {
+				assert(file_chksm_offs[f] == (u32)(s.size() - start));
+				std::string path = "C:\\synthetic\\src\\mod" + std::to_string(module_index) + "_file" + std::to_string(f) + ".cpp";
+				s.push<u32>(intern_name(path));
+				s.push<u8>(0); // checksum_size
+				s.push<u8>(0); // checksum_kind
+				s.align(4);
+			}
+			*s.at<u32>(len) = (u32)(s.size() - start);
+		}
+
+		for (u32 p=0; p<(u32)mod.procs.size(); p++) {
+			auto& proc = mod.procs[p];
+			if (proc.overlap)
+				continue; // its lines are in the block of the proc it overlaps
+
+			s.push<u32>(DEBUG_S_LINES);
+			size_t len = s.push<u32>(0);
+			size_t start = s.size();
+
+			codeview_line_header lh = {};
+			lh.contribution_offset = proc.rva - sections[0].rva;
+			lh.contribution_section_id = 1;
+			lh.flags = 0;
+			lh.contribution_size = proc.size;
+			s.push(lh);
+
+			u32 num_lines = std::min(opt.lines_per_proc, proc.size);
+			codeview_line_block_header bh = {};
+			bh.offset_in_file_checksums = file_chksm_offs[p % file_chksm_offs.size()];
+			bh.amount_of_lines = num_lines;
+			bh.block_size = (u32)(sizeof(codeview_line_block_header) + num_lines * sizeof(codeview_line));
+			s.push(bh);
+
+			u32 first_line = 10 + p * 20;
+			for (u32 l=0; l<num_lines; l++) {
+				codeview_line line = {};
+				line.offset = proc.size * l / num_lines;
+				// lines not strictly increasing, like optimized code
+				line.start_line_number = first_line + (l ^ 1);
+				line.is_a_statement = 1;
+				s.push(line);
+			}
+			*s.at<u32>(len) = (u32)(s.size() - start);
+		}
+		if (opt.inline_funcs > 0) {
+			s.push<u32>(DEBUG_S_INLINEELINES);
+			size_t len = s.push<u32>(0);
+			size_t start = s.size();
+			s.push<u32>(CV_INLINEE_SOURCE_LINE_SIGNATURE);
+			for (u32 k=0; k<opt.inline_funcs; k++) {
+				codeview_inlinee_source_line il = {};
+				il.inlinee = 0x1000 + k;
+				il.offset_in_file_checksums = file_chksm_offs[0];
+				il.source_line_number = inline_base_line(k);
+				s.push(il);
+			}
+			*s.at<u32>(len) = (u32)(s.size() - start);
+		}
+		mod.c13_bytes = (u32)(s.size() - c13_start);
+
+		s.push<u32>(0); // global references
+	}
+
+	// publics get msvc-like decorated names, so they differ from the proc names
+	static std::string public_name (u32 module_index, u32 proc_index) {
+		return "?func" + std::to_string(proc_index) + "@mod" + std::to_string(module_index) + "@@YAXXZ";
+	}
+	static std::string global_data_name (u32 module_index) {
+		return "mod" + std::to_string(module_index) + "::global_data";
+	}
+	static u32 global_data_offset (u32 module_index) {
+		return module_index * 8 % 0x800;
+	}
+
+	struct GlobalSymbol {
+		std::string name;
+		u32 offset; // in the symbol record stream
+	};
+	std::vector<GlobalSymbol> publics; // in address order
+	std::vector<GlobalSymbol> globals;
+
+	// S_PUB32 records, then an S_PROCREF per proc and an S_GDATA32 per module for the GSI
+	void write_symbol_records (u32 stream) {
+		auto& s = streams[stream];
+		auto begin_record = [&] (SYM_ENUM_e kind) {
+			size_t start = s.size();
+			s.push<u16>(0);
+			s.push<u16>(kind);
+			return start;
+		};
+		auto end_record = [&] (size_t start) {
+			s.align(4);
+			*s.at<u16>(start) = (u16)(s.size() - start - sizeof(u16));
+		};
+
+		if (opt.publics) {
+			for (u32 m=0; m<(u32)modules.size(); m++) {
+				for (u32 p=0; p<(u32)modules[m].procs.size(); p++) {
+					auto& proc = modules[m].procs[p];
+					if (proc.overlap)
+						continue;
+					auto name = public_name(m, p);
+					size_t start = begin_record(S_PUB32);
+					publics.push_back({ name, (u32)start });
+					s.push<u32>(2); // fFunction
+					s.push<u32>(proc.rva - sections[0].rva);
+					s.push<u16>(1);
+					s.push_str(name);
+					end_record(start);
+				}
+			}
+		}
+
+		for (u32 m=0; m<(u32)modules.size(); m++) {
+			if (m < opt.stripped_modules)
+				continue; // no module stream to refer to
+			for (auto& proc : modules[m].procs) {
+				size_t start = begin_record(S_PROCREF);
+				globals.push_back({ proc.name, (u32)start });
+				s.push<u32>(0); // sumName
+				s.push<u32>(proc.sym_offset);
+				s.push<u16>((u16)(m + 1)); // one based
+				s.push_str(proc.name);
+				end_record(start);
+			}
+
+			auto name = global_data_name(m);
+			size_t start = begin_record(S_GDATA32);
+			globals.push_back({ name, (u32)start });
+			s.push<u32>(0); // typind
+			s.push<u32>(global_data_offset(m));
+			s.push<u16>(3); // .data
+			s.push_str(name);
+			end_record(start);
+		}
+	}
+
+	// hashStringV1 buckets like mspdb writes them, records of a bucket are consecutive
+	void write_symbol_hash (Buffer& s, std::vector<GlobalSymbol> const& syms) {
+		std::vector<std::vector<u32>> buckets(IPHR_HASH);
+		for (auto& sym : syms) {
+			buckets[pdb_hash_string_v1(sym.name) % IPHR_HASH].push_back(sym.offset);
+		}
+
+		gsi_hash_header h = {};
+		h.version_signature = GSI_HASH_SIGNATURE;
+		h.version = GSI_HASH_VERSION;
+		h.hash_records_size = (u32)(syms.size() * sizeof(gsi_hash_record));
+
+		constexpr u32 bitmap_words = (IPHR_HASH + 1 + 31) / 32;
+		std::vector<u32> bitmap(bitmap_words);
+		std::vector<u32> bucket_offsets;
+		u32 n = 0;
+		for (u32 b=0; b<IPHR_HASH; b++) {
+			if (buckets[b].empty())
+				continue;
+			bitmap[b / 32] |= 1u << (b % 32);
+			bucket_offsets.push_back(n * GSI_HASH_BUCKET_OFFSET_UNIT);
+			n += (u32)buckets[b].size();
+		}
+		h.buckets_size = (u32)((bitmap.size() + bucket_offsets.size()) * sizeof(u32));
+
+		s.push(h);
+		for (auto& bucket : buckets) {
+			for (u32 offs : bucket) {
+				s.push(gsi_hash_record{ offs + 1, 1 });
+			}
+		}
+		s.push_bytes(bitmap.data(), bitmap.size() * sizeof(u32));
+		s.push_bytes(bucket_offsets.data(), bucket_offsets.size() * sizeof(u32));
+	}
+
+	void write_gsi (u32 stream) {
+		write_symbol_hash(streams[stream], globals);
+	}
+
+	// procs are laid out in ascending order, so the publics already are in address map order
+	void write_psi (u32 stream) {
+		Buffer hash;
+		write_symbol_hash(hash, publics);
+
+		auto& s = streams[stream];
+		psi_stream_header h = {};
+		h.sym_hash_size = (u32)hash.size();
+		h.addr_map_size = (u32)(publics.size() * sizeof(u32));
+		h.number_of_sections = (u32)sections.size();
+		s.push(h);
+		s.push_bytes(hash.data.data(), hash.size());
+		for (auto& pub : publics)
+			s.push<u32>(pub.offset);
+	}
+
+	static std::string inline_func_name (u32 k) {
+		return "inline_func" + std::to_string(k);
+	}
+
+	// IPI gets an LF_FUNC_ID per inlinee, TPI stays empty
+	void write_tpi (u32 stream, bool ipi) {
+		Buffer records;
+		u32 num_records = 0;
+		if (ipi) {
+			for (u32 k=0; k<opt.inline_funcs; k++) {
+				size_t start = records.size();
+				records.push<u16>(0);
+				records.push<u16>(LF_FUNC_ID);
+				records.push<u32>(0); // scope
+				records.push<u32>(0); // type
+				records.push_str(inline_func_name(k));
+				records.align(4);
+				*records.at<u16>(start) = (u16)(records.size() - start - sizeof(u16));
+				num_records++;
+			}
+		}
+
+		auto& s = streams[stream];
+		s.push<u32>(20040203); // version
+		s.push<u32>(56);       // header size
+		s.push<u32>(0x1000);   // type index begin
+		s.push<u32>(0x1000 + num_records); // type index end
+		s.push<u32>((u32)records.size()); // type record bytes
+		s.push<u16>(0xffff);   // hash stream index
+		s.push<u16>(0xffff);   // hash aux stream index
+		s.push<u32>(4);        // hash key size
+		s.push<u32>(0x3ffff);  // number of hash buckets
+		for (int i=0; i<6; i++)
+			s.push<u32>(0);    // hash value / index offset / hash adj buffers
+		s.push_bytes(records.data.data(), records.size());
+	}
+
+	void write_names (u32 stream) {
+		auto& s = streams[stream];
+		s.push<u32>(0xEFFEEFFE);
+		s.push<u32>(1); // hash version
+		s.push<u32>((u32)names_strings.size());
+		s.push_bytes(names_strings.data.data(), names_strings.size());
+		s.push<u32>(0); // bucket_count
+		s.push<u32>((u32)names_lookup.size());
+	}
+
+	void write_pdb_info (u32 stream, u32 names_stream) {
+		auto& s = streams[stream];
+		pdb_information_stream_header h = {};
+		h.version = 20000404;
+		h.timestamp = 0x5eed0000 + opt.seed;
+		h.age = 1;
+		h.guid.Data1 = 0x12345678 ^ opt.seed;
+		h.guid.Data2 = (u16)opt.modules;
+		h.guid.Data3 = (u16)opt.procs_per_module;
+		for (int i=0; i<8; i++) h.guid.Data4[i] = (u8)(opt.seed >> i);
+		s.push(h);
+
+		// named stream map with a single "/names" entry
+		const char key[] = "/names";
+		s.push<u32>(sizeof(key));
+		s.push_bytes(key, sizeof(key));
+		s.push<u32>(1); // amount_of_entries
+		s.push<u32>(1); // capacity
+		s.push<u32>(1); // present_word_count
+		s.push<u32>(1); // present_bits
+		s.push<u32>(0); // deleted_word_count
+		s.push<u32>(0); // key
+		s.push<u32>(names_stream); // value
+		s.push<u32>(0); // unused
+		s.push<u32>(20140508); // feature code: VC140
+	}
+
+	void write_section_headers (u32 stream) {
+		auto& s = streams[stream];
+		for (auto& sec : sections) {
+			pe_section_header sh = {};
+			memcpy(sh.name, sec.name, strnlen(sec.name, 8));
+			sh.virtual_size = sec.size;
+			sh.virtual_address = sec.rva;
+			sh.characteristics = sec.characteristics;
+			s.push(sh);
+		}
+	}
+
+	void write_dbi (u32 stream, u32 symrec_stream, u32 gsi_stream, u32 psi_stream, u32 section_header_stream) {
+		auto& s = streams[stream];
+
+		Buffer modi;
+		for (u32 m=0; m<(u32)modules.size(); m++) {
+			auto& mod = modules[m];
+			pdb_module_information mi = {};
+			mi.first_code_contribution.section_id = 1;
+			mi.first_code_contribution.offset = (s32)(mod.rva - sections[0].rva);
+			mi.first_code_contribution.size = (s32)mod.size;
+			mi.first_code_contribution.characteristics = sections[0].characteristics;
+			mi.first_code_contribution.module_index = (s16)m;
+			bool stripped = m < opt.stripped_modules;
+			mi.stream_index_of_module_symbol_stream = stripped ? 0xffff : (u16)mod.stream;
+			mi.byte_size_of_symbol_information = stripped ? 0 : mod.sym_bytes;
+			mi.byte_size_of_c11_line_information = 0;
+			mi.byte_size_of_c13_line_information = stripped ? 0 : mod.c13_bytes;
+			mi.amount_of_source_files = (u16)opt.files_per_module;
+			modi.push(mi);
+			modi.push_str(mod.name);
+			modi.push_str(mod.name);
+			modi.align(4);
+		}
+
+		Buffer sc;
+		sc.push<u32>(0xeffe0000 + 19970605);
+		auto push_contrib = [&] (GenContrib const& gc) {
+			pdb_section_contribution c = {};
+			c.section_id = 1;
+			c.offset = (s32)(gc.rva - sections[0].rva);
+			c.size = (s32)gc.size;
+			c.characteristics = sections[0].characteristics;
+			c.module_index = (s16)gc.module;
+			sc.push(c);
+		};
+		for (auto& c : contribs_before)
+			push_contrib(c);
+		for (u32 m=0; m<(u32)modules.size(); m++)
+			push_contrib({ m, modules[m].rva, modules[m].size });
+		for (auto& c : contribs_after)
+			push_contrib(c);
+
+		Buffer secmap;
+		secmap.push<u16>((u16)sections.size());
+		secmap.push<u16>((u16)sections.size());
+		for (u32 i=0; i<(u32)sections.size(); i++) {
+			pdb_section_map_entry e = {};
+			e.flags = 0x10d;
+			e.frame = (u16)(i+1);
+			e.section_name = 0xffff;
+			e.class_name = 0xffff;
+			e.section_size = sections[i].size;
+			secmap.push(e);
+		}
+
+		Buffer srcinfo;
+		srcinfo.push<u16>(0);
+		srcinfo.push<u16>(0);
+
+		optional_debug_header_substream dbg;
+		memset(&dbg, 0xff, sizeof(dbg));
+		dbg.stream_index_of_section_header_dump = (u16)section_header_stream;
+
+		dbi_stream_header h = {};
+		h.version_signature = 0xffffffff;
+		h.version = 19990903;
+		h.age = 1;
+		h.stream_index_of_the_global_symbol_index_stream = (u16)gsi_stream;
+		h.stream_index_of_the_public_symbol_index_stream = opt.publics ? (u16)psi_stream : 0xffff;
+		h.stream_index_of_the_symbol_record_stream = (u16)symrec_stream;
+		h.toolchain_version.major_version = 14;
+		h.toolchain_version.is_new_version_format = 1;
+		h.byte_size_of_the_module_information_substream = (u32)modi.size();
+		h.byte_size_of_the_section_contribution_substream = (u32)sc.size();
+		h.byte_size_of_the_section_map_substream = (u32)secmap.size();
+		h.byte_size_of_the_source_information_substream = (u32)srcinfo.size();
+		h.byte_size_of_the_type_server_map_substream = 0;
+		h.byte_size_of_the_optional_debug_header_substream = sizeof(dbg);
+		h.byte_size_of_the_edit_and_continue_substream = 0;
+		h.machine_type = 0x8664;
+
+		s.push(h);
+		s.push_bytes(modi.data.data(), modi.size());
+		s.push_bytes(sc.data.data(), sc.size());
+		s.push_bytes(secmap.data.data(), secmap.size());
+		s.push_bytes(srcinfo.data.data(), srcinfo.size());
+		s.push(dbg);
+	}
+
+	// MSF container: superblock, two free page maps, stream pages, stream directory, directory page list
+	bool write_msf () {
+		u32 ps = opt.page_size;
+		auto pages_for = [&] (size_t bytes) { return (u32)((bytes + ps-1) / ps); };
+
+		u32 num_pages = 3;
+		std::vector<std::vector<u32>> stream_pages(streams.size());
+
+		std::vector<u32> order;
+		for (u32 i=0; i<(u32)streams.size(); i++) {
+			for (u32 p=0; p<pages_for(streams[i].size()); p++)
+				order.push_back(i);
+		}
+		if (opt.fragment) {
+			std::shuffle(order.begin(), order.end(), rng);
+		}
+		for (u32 streami : order) {
+			// skip over the free page map pages which repeat every page_size pages
+			while (num_pages % ps == 1 || num_pages % ps == 2) num_pages++;
+			stream_pages[streami].push_back(num_pages++);
+		}
+
+		Buffer dir;
+		dir.push<u32>((u32)streams.size());
+		for (auto& s : streams)
+			dir.push<u32>((u32)s.size());
+		for (auto& pages : stream_pages) {
+			for (u32 pg : pages)
+				dir.push<u32>(pg);
+		}
+
+		std::vector<u32> dir_pages;
+		for (u32 i=0; i<pages_for(dir.size()); i++) {
+			while (num_pages % ps == 1 || num_pages % ps == 2) num_pages++;
+			dir_pages.push_back(num_pages++);
+		}
+		if (dir_pages.size() > ps / sizeof(u32)) {
+			fprintf(stderr, "Stream directory too large\n");
+			return false;
+		}
+		while (num_pages % ps == 1 || num_pages % ps == 2) num_pages++;
+		u32 dir_page_list_page = num_pages++;
+
+		std::vector<char> file((size_t)num_pages * ps, 0);
+		auto page = [&] (u32 idx) { return file.data() + (size_t)idx * ps; };
+
+		auto* h = (msf_header*)page(0);
+		memcpy(h->signature, "Microsoft C/C++ MSF 7.00\r\n\032DS\0\0\0", 32);
+		h->page_size = ps;
+		h->active_free_page_map = 1;
+		h->amount_of_pages = num_pages;
+		h->stream_table_stream_size = (u32)dir.size();
+		h->page_list_of_stream_table_stream_page_list[0] = dir_page_list_page;
+
+		// all pages are in use, so free page maps are all zero bits, except for the unused tail
+		for (u32 fpm=1; fpm<num_pages; fpm += ps) {
+			memset(page(fpm), 0, ps);
+		}
+
+		for (u32 i=0; i<(u32)streams.size(); i++) {
+			auto& data = streams[i].data;
+			for (u32 p=0; p<(u32)stream_pages[i].size(); p++) {
+				size_t offs = (size_t)p * ps;
+				memcpy(page(stream_pages[i][p]), data.data() + offs, std::min((size_t)ps, data.size() - offs));
+			}
+		}
+		for (u32 p=0; p<(u32)dir_pages.size(); p++) {
+			size_t offs = (size_t)p * ps;
+			memcpy(page(dir_pages[p]), dir.data.data() + offs, std::min((size_t)ps, dir.size() - offs));
+		}
+		memcpy(page(dir_page_list_page), dir_pages.data(), dir_pages.size() * sizeof(u32));
+
+		FILE* f = fopen(opt.out_path.c_str(), "wb");
+		if (!f) {
+			fprintf(stderr, "Could not open %s\n", opt.out_path.c_str());
+			return false;
+		}
+		bool ok = fwrite(file.data(), 1, file.size(), f) == file.size();
+		fclose(f);
+		return ok;
+	}
+
+public:
+	PdbGenerator (GenOptions const& opt): opt{opt}, rng{opt.seed} {}
+
+	bool generate () {
+		layout();
+
+		add_stream(); // 0: old stream directory
+		u32 info_stream = add_stream(); // 1
+		u32 tpi_stream = add_stream(); // 2
+		u32 dbi_stream = add_stream(); // 3
+		u32 ipi_stream = add_stream(); // 4
+		u32 names_stream = add_stream();
+		u32 section_header_stream = add_stream();
+		u32 symrec_stream = add_stream();
+		u32 gsi_stream = add_stream();
+		u32 psi_stream = add_stream();
+
+		names_strings.push_str(""); // offset 0 is the empty string
+		for (u32 m=0; m<(u32)modules.size(); m++) {
+			modules[m].stream = add_stream();
+			write_module_stream(modules[m], m);
+		}
+		if (streams.size() > 0xffff) {
+			fprintf(stderr, "Too many streams for u16 stream indices\n");
+			return false;
+		}
+
+		write_tpi(tpi_stream, false);
+		write_tpi(ipi_stream, true);
+		write_symbol_records(symrec_stream);
+		write_gsi(gsi_stream);
+		write_psi(psi_stream);
+		write_section_headers(section_header_stream);
+		write_dbi(dbi_stream, symrec_stream, gsi_stream, psi_stream, section_header_stream);
+		write_names(names_stream);
+		write_pdb_info(info_stream, names_stream);
+
+		return write_msf();
+	}
+
+	size_t total_procs () const {
+		size_t n = 0;
+		for (auto& mod : modules)
+			n += mod.procs.size();
+		return n;
+	}
+};
+
+static void print_usage () {
+	printf("usage: pdb_generator [options]\n"
+		"  -o <path>         output file (default synthetic.pdb)\n"
+		"  -modules <n>      number of modules, at most 65525 (default 100)\n"
+		"  -procs <n>        S_GPROC32 records per module (default 100)\n"
+		"  -lines <n>        line records per proc (default 8)\n"
+		"  -files <n>        file checksums per module (default 4)\n"
+		"  -no_publics       don't write S_PUB32 records\n"
+		"  -stripped <n>     leave out the symbol streams of the first n modules\n"
+		"  -inlines <n>      distinct inlined functions, 0 disables S_INLINESITEs (default 32)\n"
+		"  -fragment         shuffle stream pages\n"
+		"  -overlaps <n>     every n-th module gets nested and aliased procs and overlapping section contributions (default 0)\n"
+		"  -seed <n>\n");
+}
+
+int main (int argc, const char** argv) {
+	GenOptions opt;
+
+	for (int i=1; i<argc; i++) {
+		std::string_view arg = argv[i];
+		auto next_u32 = [&] () -> u32 {
+			if (i+1 >= argc) throw std::runtime_error(std::string(arg) + " needs a value");
+			return (u32)strtoul(argv[++i], nullptr, 0);
+		};
+
+		if      (arg == "-o" && i+1 < argc) opt.out_path = argv[++i];
+		else if (arg == "-modules")   opt.modules = next_u32();
+		else if (arg == "-procs")     opt.procs_per_module = next_u32();
+		else if (arg == "-lines")     opt.lines_per_proc = next_u32();
+		else if (arg == "-files")     opt.files_per_module = next_u32();
+		else if (arg == "-no_publics") opt.publics = false;
+		else if (arg == "-stripped")  opt.stripped_modules = next_u32();
+		else if (arg == "-inlines")   opt.inline_funcs = next_u32();
+		else if (arg == "-fragment")  opt.fragment = true;
+		else if (arg == "-overlaps")  opt.overlaps = next_u32();
+		else if (arg == "-seed")      opt.seed = next_u32();
+		else {
+			print_usage();
+			return 1;
+		}
+	}
+	opt.files_per_module = std::max(opt.files_per_module, 1u);
+	opt.lines_per_proc = std::max(opt.lines_per_proc, 1u);
+	if (opt.modules > MAX_MODULES) {
+		fprintf(stderr, "At most %u modules fit the u16 stream indices of a PDB\n", MAX_MODULES);
+		return 1;
+	}
+
+	auto t = Timer::start();
+
+	PdbGenerator gen(opt);
+	if (!gen.generate())
+		return 1;
+
+	printf("Wrote %s: %u modules, %zu procs in %.3f s\n", opt.out_path.c_str(), opt.modules, gen.total_procs(), t.elapsed_sec());
+	return 0;
+}
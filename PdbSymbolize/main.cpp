@@ -0,0 +1,329 @@
+// Symbolizes captured addresses offline, from a module table and a file of addresses,
+// without a live process or any Win32 API, so it also runs on the build servers that have the PDBs
+//
+// Module table, one module per line: <exe, dll or pdb path> <base> <size>   (hex, # starts a comment), see ModuleMap
+// Addresses: one hex address per line, or raw little-endian u64s with -bin
+// Output, one line per address: <address> <module> <frame>... (tab separated), frames innermost first as "<name> <file>:<line>",
+// so inlined functions come before the proc they were inlined into, failed lookups get a "? <error>" frame and "?" for an unknown module
+//
+// linux: g++ -std=c++17 -O2 -I../BetterDbgHelp main.cpp ../BetterDbgHelp/timer.cpp -pthread -o pdb_symbolize
+
+#include "pdb_file.hpp"
+#include "module_map.hpp"
+
+struct SymbolizeOptions {
+	std::string modules_path;
+	std::string addrs_path;
+	std::string out_path; // empty for stdout
+	bool binary = false;
+
+	// where to look for PDBs that are not next to the module path
+	std::string pdb_dir;
+	std::string index_cache_dir;
+
+	u32 threads = 0; // 0 uses all hardware threads
+	// instead of writing the output, resolve everything with 1, 2, 4 .. threads and report the throughput
+	bool bench = false;
+};
+
+struct TraceModule {
+	std::string path;
+	std::string name; // file name of path, for the output
+	std::string pdb_path;
+	u64 base;
+	u64 size;
+
+	std::once_flag loaded;
+	std::unique_ptr<PDB_File> pdb; // null if it could not be loaded
+};
+
+class Symbolizer {
+	std::vector<std::unique_ptr<TraceModule>> modules; // sorted by base
+	PDB_File::Options pdb_opt;
+
+public:
+	static constexpr u32 MAX_INLINE_FRAMES = 16;
+
+	Symbolizer (SymbolizeOptions const& opt) {
+		pdb_opt.proc_index = true; // random addresses over the whole module, the index pays for itself quickly
+		pdb_opt.load_threads = 1;  // we resolve on all threads already
+		pdb_opt.index_cache_dir = opt.index_cache_dir;
+		pdb_opt.quiet = true;
+	}
+
+	bool load_module_table (std::string const& path, std::string const& pdb_dir) {
+		ModuleMap table;
+		if (!table.load_file(path))
+			return false;
+
+		for (auto& info : table.get_modules()) { // sorted by base
+			auto m = std::make_unique<TraceModule>();
+			m->path = info.path;
+			m->base = info.base;
+			m->size = info.size;
+
+			// paths are usually from the machine the trace was captured on, so take them apart by hand, both separators count
+			auto name_begin = m->path.find_last_of("\\/");
+			m->name = name_begin == std::string::npos ? m->path : m->path.substr(name_begin+1);
+
+			auto pdb_path = std::filesystem::path(m->path);
+			pdb_path.replace_extension(".pdb");
+			m->pdb_path = pdb_path.string();
+			if (!pdb_dir.empty() && !std::filesystem::exists(m->pdb_path)) {
+				auto pdb_name = std::filesystem::path(m->name).replace_extension(".pdb");
+				m->pdb_path = (std::filesystem::path(pdb_dir) / pdb_name).string();
+			}
+			modules.push_back(std::move(m));
+		}
+		return true;
+	}
+	size_t num_modules () const { return modules.size(); }
+
+	TraceModule* find_module (u64 addr) {
+		auto it = std::upper_bound(modules.begin(), modules.end(), addr, [] (u64 addr, auto& m) {
+			return addr < m->base;
+		});
+		if (it == modules.begin())
+			return nullptr;
+		auto* m = (it-1)->get();
+		return addr - m->base < m->size ? m : nullptr;
+	}
+	// Loads on first use, safe to call from multiple threads
+	PDB_File* get_pdb (TraceModule& m) {
+		std::call_once(m.loaded, [&] () {
+			m.pdb = PDB_File::try_load_pdb(std::string(m.pdb_path), pdb_opt);
+			if (!m.pdb) fprintf(stderr, "Could not load %s\n", m.pdb_path.c_str());
+		});
+		return m.pdb.get();
+	}
+
+	// Appends the output line for addr
+	void symbolize (u64 addr, std::string* out) {
+		char buf[64];
+		snprintf(buf, sizeof(buf), "0x%llx\t", (unsigned long long)addr);
+		*out += buf;
+
+		auto frame = [&] (const char* name, const char* file, u32 line) {
+			*out += '\t';
+			*out += name;
+			if (file) {
+				snprintf(buf, sizeof(buf), ":%u", line);
+				*out += ' ';
+				*out += file;
+				*out += buf;
+			}
+		};
+		auto error = [&] (const char* err) {
+			*out += "\t? ";
+			*out += err;
+			*out += '\n';
+		};
+
+		auto* m = find_module(addr);
+		if (!m) {
+			*out += '?';
+			return error("Module not found");
+		}
+		*out += m->name;
+		auto* pdb = get_pdb(*m);
+		if (!pdb)
+			return error("Module pdb not found");
+
+		assert(addr - m->base <= 0xffffffff);
+		u32 rva = (u32)(addr - m->base);
+
+		PDB_File::IndexedSymbol sym;
+		if (pdb->find_symbol_indexed(rva, &sym)) {
+			auto& mod = pdb->get_module(sym.module);
+
+			PDB_File::InlineFrame frames[MAX_INLINE_FRAMES];
+			u32 num_frames = pdb->find_inline_frames(mod, sym.sec_id, sym.sec_raddr, frames, MAX_INLINE_FRAMES);
+			for (u32 i=0; i<num_frames; i++) {
+				frame(frames[i].name, frames[i].src.filepath, frames[i].src.lineno);
+			}
+
+			SourceLoc src = {};
+			bool has_src = pdb->find_source_loc(mod, sym.sec_id, sym.sec_raddr, &src);
+			frame(sym.name, has_src ? src.filepath : nullptr, src.lineno);
+			*out += '\n';
+			return;
+		}
+
+		// not in any proc, nearest public symbol like SymResolver
+		u32 sec_id = 0;
+		auto* sec = pdb->find_section_for_addr(rva, &sec_id);
+		PDB_File::PublicSymbol pub;
+		if (!sec)
+			return error("Section not found");
+		if (!pdb->find_public_symbol(sec_id, (u32)(rva - sec->base_addr), &pub))
+			return error("Symbol not found");
+		frame(pub.name, nullptr, 0);
+		*out += '\n';
+	}
+};
+
+// Reads the address file in chunks, so traces larger than memory still stream through
+class AddressReader {
+	MappedFile file;
+	bool binary;
+	size_t pos = 0;
+public:
+	bool open (std::string const& path, bool binary) {
+		this->binary = binary;
+		if (!file.open(path)) {
+			fprintf(stderr, "Could not open address file %s\n", path.c_str());
+			return false;
+		}
+		return true;
+	}
+	void rewind () {
+		pos = 0;
+	}
+
+	// false once everything was read
+	bool next_chunk (std::vector<u64>* out, size_t max_count) {
+		out->clear();
+		const char* data = file.data();
+		size_t size = file.size();
+
+		if (binary) {
+			size_t count = std::min((size - pos) / sizeof(u64), max_count);
+			out->resize(count);
+			memcpy(out->data(), data + pos, count * sizeof(u64));
+			pos += count * sizeof(u64);
+			return count > 0;
+		}
+
+		while (pos < size && out->size() < max_count) {
+			size_t end = pos;
+			while (end < size && data[end] != '\n') end++;
+
+			const char* p = data + pos;
+			while (p < data + end && isspace((unsigned char)*p)) p++;
+			if (p < data + end && *p != '#') {
+				out->push_back(strtoull(p, nullptr, 16)); // stops at the line end, strtoull does not read past non-hex chars
+			}
+			pos = end + 1;
+		}
+		return !out->empty();
+	}
+};
+
+// Resolves addrs on the pool, in blocks that each format into their own string, out gets them in order
+static void symbolize_chunk (Symbolizer& sym, ThreadPool& pool, std::vector<u64> const& addrs, std::vector<std::string>* blocks) {
+	constexpr size_t BLOCK = 4096;
+	u32 num_blocks = (u32)((addrs.size() + BLOCK-1) / BLOCK);
+	blocks->resize(num_blocks);
+	pool.parallel_for(num_blocks, [&] (u32 b) {
+		auto& out = (*blocks)[b];
+		out.clear();
+		size_t end = std::min(addrs.size(), (size_t)(b+1) * BLOCK);
+		for (size_t i = (size_t)b * BLOCK; i < end; i++) {
+			sym.symbolize(addrs[i], &out);
+		}
+	});
+}
+
+static void print_usage () {
+	fprintf(stderr,
+		"Usage: pdb_symbolize -modules <table> -addrs <file> [options]\n"
+		"  -modules <file>   module table, lines of <path> <base> <size> (hex)\n"
+		"  -addrs <file>     addresses to symbolize, one hex address per line\n"
+		"  -bin              address file is raw little-endian u64s\n"
+		"  -o <file>         output file (default stdout)\n"
+		"  -pdbdir <dir>     where to look for PDBs not found next to the module path\n"
+		"  -cache <dir>      index cache directory, makes the next run skip parsing the PDBs\n"
+		"  -threads <n>      0 uses all hardware threads (default)\n"
+		"  -bench            resolve with 1, 2, 4 .. threads and report addresses per second instead of writing output\n");
+}
+
+int main (int argc, const char** argv) {
+	SymbolizeOptions opt;
+
+	for (int i=1; i<argc; i++) {
+		std::string_view arg = argv[i];
+		bool has_value = i+1 < argc;
+
+		if      (arg == "-modules" && has_value) opt.modules_path = argv[++i];
+		else if (arg == "-addrs"   && has_value) opt.addrs_path = argv[++i];
+		else if (arg == "-o"       && has_value) opt.out_path = argv[++i];
+		else if (arg == "-pdbdir"  && has_value) opt.pdb_dir = argv[++i];
+		else if (arg == "-cache"   && has_value) opt.index_cache_dir = argv[++i];
+		else if (arg == "-threads" && has_value) opt.threads = (u32)strtoul(argv[++i], nullptr, 0);
+		else if (arg == "-bin")   opt.binary = true;
+		else if (arg == "-bench") opt.bench = true;
+		else {
+			print_usage();
+			return 1;
+		}
+	}
+	if (opt.modules_path.empty() || opt.addrs_path.empty()) {
+		print_usage();
+		return 1;
+	}
+	if (opt.threads == 0)
+		opt.threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+	Symbolizer sym(opt);
+	if (!sym.load_module_table(opt.modules_path, opt.pdb_dir))
+		return 1;
+
+	AddressReader reader;
+	if (!reader.open(opt.addrs_path, opt.binary))
+		return 1;
+
+	constexpr size_t CHUNK = 1 << 20;
+	std::vector<u64> addrs;
+	std::vector<std::string> blocks;
+
+	if (opt.bench) {
+		{ // load every PDB the trace touches, so the runs only measure the lookups
+			ThreadPool pool(opt.threads);
+			auto t = Timer::start();
+			while (reader.next_chunk(&addrs, CHUNK))
+				symbolize_chunk(sym, pool, addrs, &blocks);
+			fprintf(stderr, "first pass (loading PDBs) %.3f s\n", t.elapsed_sec());
+		}
+		double base_rate = 0;
+		for (u32 threads=1;; threads = std::min(threads*2, opt.threads)) {
+			ThreadPool pool(threads);
+			reader.rewind();
+			size_t count = 0;
+			auto t = Timer::start();
+			while (reader.next_chunk(&addrs, CHUNK)) {
+				symbolize_chunk(sym, pool, addrs, &blocks);
+				count += addrs.size();
+			}
+			double rate = count / t.elapsed_sec();
+			if (threads == 1) base_rate = rate;
+			fprintf(stderr, "%3u threads: %zu addresses in %.3f s, %10.0f addr/s (x%.2f)\n", threads, count, t.elapsed_sec(), rate, rate / base_rate);
+			if (threads == opt.threads) break;
+		}
+		return 0;
+	}
+
+	FILE* out = stdout;
+	if (!opt.out_path.empty()) {
+		out = fopen(opt.out_path.c_str(), "wb");
+		if (!out) {
+			fprintf(stderr, "Could not open %s\n", opt.out_path.c_str());
+			return 1;
+		}
+	}
+
+	ThreadPool pool(opt.threads);
+	size_t count = 0;
+	auto t = Timer::start();
+	while (reader.next_chunk(&addrs, CHUNK)) {
+		symbolize_chunk(sym, pool, addrs, &blocks);
+		for (auto& b : blocks)
+			fwrite(b.data(), 1, b.size(), out);
+		count += addrs.size();
+	}
+	float sec = t.elapsed_sec();
+	if (out != stdout) fclose(out);
+	else               fflush(out);
+
+	fprintf(stderr, "%zu addresses in %.3f s (%.0f addr/s) on %u threads, %zu modules\n", count, sec, count / sec, opt.threads, sym.num_modules());
+	return 0;
+}
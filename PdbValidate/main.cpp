@@ -0,0 +1,454 @@
+// Resolves every address of a PDB's module (or every -step bytes) through the proc index and checks it against a reference
+// that follows the original linear lookups (section -> first matching section contribution -> first matching proc of its module),
+// the source line of every address in a proc against the scan of the raw C13 line info,
+// and with -cache also checks the index cache against the freshly parsed PDB, so index work can't silently change results
+//
+// Scanning the section contributions for every address would take hours on a large PDB, so the reference is built once by a sweep
+// over the contributions and procs, which keeps their "first in file order wins" rule, and -spot checks it against the actual scans
+// -spot also checks the inline frames and the public symbol fallback against linear scans, which are too slow for every address
+// The address range is split into chunks resolved on all threads
+//
+// linux: g++ -std=c++17 -O2 -I../BetterDbgHelp main.cpp ../BetterDbgHelp/timer.cpp -pthread -o pdb_validate
+
+#include "pdb_file.hpp"
+#include <random>
+#include <set>
+#include <map>
+
+struct ValidateOptions {
+	std::string pdb_path;
+	std::string index_cache_dir; // also compare against the PDB mapped from the index cache
+	u32 step = 1;
+	u32 page_bits = 12; // proc index page table, lookups without a cursor go through it
+	u32 threads = 0; // 0 uses all hardware threads
+	u32 spot = 10000; // random addresses to check the reference against the linear scans
+	u32 max_report = 20;
+	u64 seed = 1;
+};
+
+constexpr u32 NONE = 0xffffffff;
+
+// [begin, end) where the reference resolves to proc of module, or to no proc (NONE) at all
+struct RefPiece {
+	u32 rva_begin, rva_end;
+	u32 module;
+	u32 proc; // index into Module::procsyms
+};
+
+// Parts of the line covered by at least one range, each with the lowest prio of the ranges covering it,
+// which is what a linear scan in prio order returns first
+struct Range {
+	u64 begin, end;
+	u32 prio;
+};
+static std::vector<Range> first_match (std::vector<Range> const& ranges) {
+	struct Event {
+		u64 pos;
+		u32 prio;
+		bool add;
+	};
+	std::vector<Event> events;
+	events.reserve(ranges.size() * 2);
+	for (auto& r : ranges) {
+		if (r.begin >= r.end) continue;
+		events.push_back({ r.begin, r.prio, true });
+		events.push_back({ r.end, r.prio, false });
+	}
+	std::sort(events.begin(), events.end(), [] (Event const& l, Event const& r) { return l.pos < r.pos; });
+
+	std::vector<Range> out;
+	std::multiset<u32> active;
+	for (size_t i=0; i<events.size();) {
+		u64 pos = events[i].pos;
+		for (; i<events.size() && events[i].pos == pos; i++) {
+			if (events[i].add) active.insert(events[i].prio);
+			else               active.erase(active.find(events[i].prio));
+		}
+		if (!active.empty() && i < events.size())
+			out.push_back({ pos, events[i].pos, *active.begin() });
+	}
+	return out;
+}
+
+// The reference lookup for the whole module, as sorted pieces covering [0, image end)
+static std::vector<RefPiece> build_reference (PDB_File& pdb) {
+	auto& sections = pdb.get_sections();
+	u32 num_contribs;
+	auto* contribs = pdb.get_section_contributions(&num_contribs);
+
+	// procs of a module in a section, as first_match pieces in section relative addresses
+	std::map<std::pair<u32, u32>, std::vector<Range>> proc_pieces;
+	auto get_proc_pieces = [&] (u32 module, u32 sec_id) -> std::vector<Range> const& {
+		auto it = proc_pieces.find({ module, sec_id });
+		if (it != proc_pieces.end())
+			return it->second;
+		std::vector<Range> procs;
+		if (module < pdb.num_modules()) {
+			auto& mod = pdb.get_module(module);
+			for (u32 p=0; p<(u32)mod.procsyms.size(); p++) {
+				auto* proc = mod.procsyms[p].proc;
+				if (proc->seg == sec_id)
+					procs.push_back({ proc->off, (u64)proc->off + proc->len, p });
+			}
+		}
+		return proc_pieces[{ module, sec_id }] = first_match(procs);
+	};
+
+	std::vector<RefPiece> pieces;
+	u32 pos = 0;
+	auto emit = [&] (u32 begin, u32 end, u32 module, u32 proc) {
+		if (begin >= end) return;
+		if (pos < begin)
+			pieces.push_back({ pos, begin, NONE, NONE });
+		pieces.push_back({ begin, end, module, proc });
+		pos = end;
+	};
+
+	for (u32 s=0; s<(u32)sections.size(); s++) {
+		u32 sec_id = s+1;
+		u64 sec_size = sections[s].size;
+		u32 base = (u32)sections[s].base_addr;
+
+		std::vector<Range> scs;
+		for (u32 i=0; i<num_contribs; i++) {
+			auto& sc = contribs[i];
+			if (sc.section_id == (s32)sec_id && sc.size > 0 && sc.offset >= 0)
+				scs.push_back({ (u64)sc.offset, std::min((u64)sc.offset + (u64)sc.size, sec_size), i });
+		}
+
+		for (auto& sc : first_match(scs)) {
+			u32 module = (u32)(u16)contribs[sc.prio].module_index;
+			u64 at = sc.begin;
+			auto& procs = get_proc_pieces(module, sec_id);
+			auto it = std::upper_bound(procs.begin(), procs.end(), sc.begin, [] (u64 addr, Range const& r) { return addr < r.end; });
+			for (; it != procs.end() && it->begin < sc.end; ++it) {
+				u64 b = std::max(it->begin, sc.begin), e = std::min(it->end, sc.end);
+				emit(base + (u32)at, base + (u32)b, NONE, NONE);
+				emit(base + (u32)b, base + (u32)e, module, it->prio);
+				at = e;
+			}
+			emit(base + (u32)at, base + (u32)sc.end, NONE, NONE);
+		}
+		emit(pos, base + (u32)sec_size, NONE, NONE);
+	}
+	return pieces;
+}
+
+// The original linear lookups, for spot checks of the reference
+static RefPiece linear_lookup (PDB_File& pdb, u32 rva) {
+	u32 sec_id = 0;
+	auto* sec = pdb.find_section_for_addr(rva, &sec_id);
+	if (!sec)
+		return { rva, rva+1, NONE, NONE };
+	u32 sec_raddr = rva - (u32)sec->base_addr;
+	auto* sc = pdb.find_section_contribution_linear(sec_id, (s32)sec_raddr);
+	if (!sc)
+		return { rva, rva+1, NONE, NONE };
+	u32 module = (u32)(u16)sc->module_index;
+	if (module >= pdb.num_modules())
+		return { rva, rva+1, NONE, NONE };
+	auto& mod = pdb.get_module(module);
+	auto* ps = pdb.find_procsym(mod, sec_id, sec_raddr);
+	if (!ps)
+		return { rva, rva+1, NONE, NONE };
+	return { rva, rva+1, module, (u32)(ps - mod.procsyms.data()) };
+}
+
+// Inline frames by scanning all of the module's inline ranges, for spot checks of the flattened segments
+// the innermost frame is the deepest range covering the address (of equal ones the last to start, like the segment sweep)
+static u32 linear_inline_frames (PDB_File& pdb, PDB_File::Module& mod, u32 sec_id, u32 sec_raddr, PDB_File::InlineFrame* out_frames, u32 max_frames) {
+	auto& it = mod.inline_table;
+	u64 key = (u64)sec_id << 32 | sec_raddr;
+	auto covers = [&] (PDB_File::InlineRange const& r) { return key >= r.key() && key < r.key() + r.size; };
+
+	const PDB_File::InlineRange* inner = nullptr;
+	for (auto& r : it.ranges) {
+		if (covers(r) && (!inner || r.depth > inner->depth || (r.depth == inner->depth && r.key() >= inner->key())))
+			inner = &r;
+	}
+	if (!inner || max_frames == 0)
+		return 0;
+
+	u32 n = 0;
+	out_frames[n++] = { pdb.get_inlinee_name(mod, inner->site), { pdb.get_file_name(inner->file), inner->line, inner->file } };
+	for (u32 s = it.sites[inner->site].parent; s != PDB_File::InlineSite::NO_PARENT && n < max_frames; s = it.sites[s].parent) {
+		auto& site = it.sites[s];
+		SourceLoc loc = {};
+		for (u32 i=0; i<site.num_ranges; i++) {
+			auto& r = it.ranges[site.first_range + i];
+			if (covers(r)) {
+				loc = { pdb.get_file_name(r.file), r.line, r.file };
+				break;
+			}
+		}
+		out_frames[n++] = { pdb.get_inlinee_name(mod, s), loc };
+	}
+	return n;
+}
+
+static bool same_source (bool has_a, SourceLoc const& a, bool has_b, SourceLoc const& b) {
+	return has_a == has_b && (!has_a || (a.lineno == b.lineno && strcmp(a.filepath, b.filepath) == 0));
+}
+static bool same_frames (PDB_File::InlineFrame const* a, u32 na, PDB_File::InlineFrame const* b, u32 nb) {
+	if (na != nb)
+		return false;
+	for (u32 i=0; i<na; i++) {
+		if (strcmp(a[i].name, b[i].name) != 0 || !same_source(a[i].src.filepath != nullptr, a[i].src, b[i].src.filepath != nullptr, b[i].src))
+			return false;
+	}
+	return true;
+}
+static std::string describe_source (bool found, SourceLoc const& loc) {
+	return found ? std::string(loc.filepath) + ":" + std::to_string(loc.lineno) : "none";
+}
+
+class Validator {
+	ValidateOptions const& opt;
+	PDB_File& pdb;
+	PDB_File* cached;
+	std::vector<RefPiece> const& reference;
+
+	std::mutex report_mutex;
+	std::map<std::string, size_t> mismatches; // by kind
+	u32 reported = 0;
+
+	void report (const char* kind, u32 rva, std::string const& detail) {
+		std::lock_guard<std::mutex> lock(report_mutex);
+		mismatches[kind]++;
+		if (reported++ < opt.max_report)
+			printf("!!! [0x%08x] %s: %s\n", rva, kind, detail.c_str());
+	}
+	std::string describe_ref (RefPiece const& r) {
+		if (r.module == NONE)
+			return "no proc";
+		auto* proc = pdb.get_module(r.module).procsyms[r.proc].proc;
+		char buf[64];
+		snprintf(buf, sizeof(buf), " (module %u, seg %u off 0x%x)", r.module, proc->seg, proc->off);
+		return (const char*)proc->name + std::string(buf);
+	}
+	static std::string describe (bool found, PDB_File::IndexedSymbol const& sym) {
+		if (!found)
+			return "no proc";
+		char buf[64];
+		snprintf(buf, sizeof(buf), " (module %u, rva 0x%x-0x%x)", sym.module, sym.rva_begin, sym.rva_end);
+		return sym.name + std::string(buf);
+	}
+
+	// the decoded line table against the scan of the raw C13 line info
+	void check_source (u32 rva, PDB_File::IndexedSymbol const& sym) {
+		auto& mod = pdb.get_module(sym.module);
+		SourceLoc a = {}, ref = {};
+		bool has_a = pdb.find_source_loc(mod, sym.sec_id, sym.sec_raddr, &a);
+		bool has_ref = pdb.find_source_loc_reference(mod, sym.sec_id, sym.sec_raddr, &ref);
+		if (!same_source(has_a, a, has_ref, ref))
+			report("source location differs from the C13 scan", rva, describe_source(has_a, a) + " != " + describe_source(has_ref, ref));
+	}
+	void check_cached_source (u32 rva, PDB_File::IndexedSymbol const& sym) {
+		SourceLoc a = {}, b = {};
+		bool has_a = pdb.find_source_loc(pdb.get_module(sym.module), sym.sec_id, sym.sec_raddr, &a);
+		bool has_b = cached->find_source_loc(cached->get_module(sym.module), sym.sec_id, sym.sec_raddr, &b);
+		if (!same_source(has_a, a, has_b, b))
+			report("index cache source location differs", rva, describe_source(has_a, a) + " != " + describe_source(has_b, b));
+
+		PDB_File::InlineFrame fa[16], fb[16];
+		u32 na = pdb.find_inline_frames(pdb.get_module(sym.module), sym.sec_id, sym.sec_raddr, fa, 16);
+		u32 nb = cached->find_inline_frames(cached->get_module(sym.module), sym.sec_id, sym.sec_raddr, fb, 16);
+		if (!same_frames(fa, na, fb, nb))
+			report("index cache inline frames differ", rva, std::to_string(na) + " frames != " + std::to_string(nb) + " frames");
+	}
+
+public:
+	std::atomic<u64> checked = 0;
+
+	Validator (ValidateOptions const& opt, PDB_File& pdb, PDB_File* cached, std::vector<RefPiece> const& reference):
+		opt{opt}, pdb{pdb}, cached{cached}, reference{reference} {}
+
+	void check_range (u32 begin, u32 end) {
+		auto piece = std::upper_bound(reference.begin(), reference.end(), begin, [] (u32 rva, RefPiece const& p) {
+			return rva < p.rva_end;
+		});
+		size_t cursor = 0, cached_cursor = 0;
+		u64 count = 0;
+
+		for (u64 r=begin; r<end; r+=opt.step) {
+			u32 rva = (u32)r;
+			while (piece != reference.end() && rva >= piece->rva_end)
+				++piece;
+			RefPiece ref = piece != reference.end() && rva >= piece->rva_begin ? *piece : RefPiece{ rva, rva+1, NONE, NONE };
+
+			PDB_File::IndexedSymbol sym, sym_seek;
+			bool found = pdb.find_symbol_indexed(rva, &sym, &cursor);
+			bool found_seek = pdb.find_symbol_indexed(rva, &sym_seek);
+			count++;
+
+			if (found != found_seek || (found && (sym.module != sym_seek.module || sym.rva_begin != sym_seek.rva_begin || sym.rva_end != sym_seek.rva_end)))
+				report("cursor lookup differs from find", rva, describe(found, sym) + " != " + describe(found_seek, sym_seek));
+
+			bool same = found == (ref.module != NONE);
+			if (same && found) {
+				auto* proc = pdb.get_module(ref.module).procsyms[ref.proc].proc;
+				u32 ref_rva = (u32)pdb.get_sections()[proc->seg-1].base_addr + proc->off;
+				same = sym.module == ref.module && sym.sym_rva == ref_rva && strcmp(sym.name, (const char*)proc->name) == 0;
+			}
+			if (!same)
+				report("index differs from reference", rva, describe(found, sym) + " != " + describe_ref(ref));
+			else if (found && (rva < sym.rva_begin || rva >= sym.rva_end))
+				report("rva outside of the returned proc range", rva, describe(found, sym));
+			if (found)
+				check_source(rva, sym);
+
+			if (cached) {
+				PDB_File::IndexedSymbol csym;
+				bool cfound = cached->find_symbol_indexed(rva, &csym, &cached_cursor);
+				if (cfound != found || (found && (csym.module != sym.module || csym.sym_rva != sym.sym_rva || csym.rva_begin != sym.rva_begin || csym.rva_end != sym.rva_end || strcmp(csym.name, sym.name) != 0)))
+					report("index cache differs", rva, describe(cfound, csym) + " != " + describe(found, sym));
+				else if (found)
+					check_cached_source(rva, sym);
+			}
+		}
+		checked += count;
+	}
+
+	void spot_check (u32 image_end) {
+		std::mt19937_64 rng(opt.seed);
+		for (u32 i=0; i<opt.spot; i++) {
+			u32 rva = (u32)(rng() % image_end);
+			auto it = std::upper_bound(reference.begin(), reference.end(), rva, [] (u32 rva, RefPiece const& p) {
+				return rva < p.rva_end;
+			});
+			RefPiece ref = it != reference.end() && rva >= it->rva_begin ? *it : RefPiece{ rva, rva+1, NONE, NONE };
+			auto lin = linear_lookup(pdb, rva);
+			if (ref.module != lin.module || ref.proc != lin.proc)
+				report("reference differs from linear scans (validator bug)", rva, describe_ref(ref) + " != " + describe_ref(lin));
+
+			u32 sec_id = 0;
+			if (auto* sec = pdb.find_section_for_addr(rva, &sec_id)) {
+				s32 sec_raddr = (s32)(rva - (u32)sec->base_addr);
+				if (pdb.find_section_contribution(sec_id, sec_raddr) != pdb.find_section_contribution_linear(sec_id, sec_raddr))
+					report("section contribution search differs from the scan", rva, "sec " + std::to_string(sec_id));
+
+				PDB_File::PublicSymbol pub, pub_lin;
+				bool has_pub = pdb.find_public_symbol(sec_id, (u32)sec_raddr, &pub);
+				bool has_pub_lin = pdb.find_public_symbol_linear(sec_id, (u32)sec_raddr, &pub_lin);
+				if (has_pub != has_pub_lin || (has_pub && (pub.name != pub_lin.name || pub.sec_offset != pub_lin.sec_offset || pub.size != pub_lin.size)))
+					report("public symbol search differs from the PSI scan", rva, std::string(has_pub ? pub.name : "none") + " != " + (has_pub_lin ? pub_lin.name : "none"));
+			}
+
+			PDB_File::IndexedSymbol sym;
+			if (pdb.find_symbol_indexed(rva, &sym)) {
+				auto& mod = pdb.get_module(sym.module);
+				PDB_File::InlineFrame fa[16], fb[16];
+				u32 na = pdb.find_inline_frames(mod, sym.sec_id, sym.sec_raddr, fa, 16);
+				u32 nb = linear_inline_frames(pdb, mod, sym.sec_id, sym.sec_raddr, fb, 16);
+				if (!same_frames(fa, na, fb, nb))
+					report("inline frames differ from the range scan", rva, std::to_string(na) + " frames != " + std::to_string(nb) + " frames");
+			}
+		}
+	}
+
+	size_t total_mismatches () {
+		size_t total = 0;
+		for (auto& m : mismatches) total += m.second;
+		return total;
+	}
+	void print_summary () {
+		for (auto& m : mismatches)
+			printf("%10zu x %s\n", m.second, m.first.c_str());
+	}
+};
+
+static void print_usage () {
+	fprintf(stderr,
+		"Usage: pdb_validate -pdb <file> [options]\n"
+		"  -step <bytes>     check every n-th rva (default 1)\n"
+		"  -threads <n>      0 uses all hardware threads (default)\n"
+		"  -page_bits <n>    proc index page table with 1 << n byte pages (default 12), 0 for none\n"
+		"  -cache <dir>      also check the PDB mapped from the index cache (written first if needed)\n"
+		"  -spot <n>         random addresses to check the reference against the linear scans (default 10000)\n"
+		"  -max_report <n>   mismatches to print (default 20)\n"
+		"  -seed <n>\n");
+}
+
+int main (int argc, const char** argv) {
+	ValidateOptions opt;
+
+	for (int i=1; i<argc; i++) {
+		std::string_view arg = argv[i];
+		bool has_value = i+1 < argc;
+
+		if      (arg == "-pdb"        && has_value) opt.pdb_path = argv[++i];
+		else if (arg == "-cache"      && has_value) opt.index_cache_dir = argv[++i];
+		else if (arg == "-step"       && has_value) opt.step = std::max((u32)strtoul(argv[++i], nullptr, 0), 1u);
+		else if (arg == "-threads"    && has_value) opt.threads = (u32)strtoul(argv[++i], nullptr, 0);
+		else if (arg == "-spot"       && has_value) opt.spot = (u32)strtoul(argv[++i], nullptr, 0);
+		else if (arg == "-max_report" && has_value) opt.max_report = (u32)strtoul(argv[++i], nullptr, 0);
+		else if (arg == "-seed"       && has_value) opt.seed = strtoull(argv[++i], nullptr, 0);
+		else if (arg == "-page_bits"  && has_value) opt.page_bits = std::min((u32)strtoul(argv[++i], nullptr, 0), 24u);
+		else {
+			print_usage();
+			return 1;
+		}
+	}
+	if (opt.pdb_path.empty()) {
+		print_usage();
+		return 1;
+	}
+	if (opt.threads == 0)
+		opt.threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+	auto t = Timer::start();
+	PDB_File::Options pdb_opt;
+	pdb_opt.proc_index = true;
+	pdb_opt.load_threads = opt.threads;
+	pdb_opt.proc_page_bits = opt.page_bits;
+	pdb_opt.quiet = true;
+	auto pdb = PDB_File::try_load_pdb(std::string(opt.pdb_path), pdb_opt);
+	if (!pdb) {
+		fprintf(stderr, "Could not load %s\n", opt.pdb_path.c_str());
+		return 1;
+	}
+
+	std::unique_ptr<PDB_File> cached;
+	if (!opt.index_cache_dir.empty()) {
+		PDB_File::Options cache_opt = pdb_opt;
+		cache_opt.index_cache_dir = opt.index_cache_dir;
+		cached = PDB_File::try_load_pdb(std::string(opt.pdb_path), cache_opt);
+		if (cached && !cached->is_from_index_cache()) // wrote the cache, map it this time
+			cached = PDB_File::try_load_pdb(std::string(opt.pdb_path), cache_opt);
+		if (!cached || !cached->is_from_index_cache()) {
+			fprintf(stderr, "Could not use the index cache in %s\n", opt.index_cache_dir.c_str());
+			return 1;
+		}
+	}
+	printf("loaded in %.3f s\n", t.elapsed_sec());
+
+	t = Timer::start();
+	auto reference = build_reference(*pdb);
+	u32 image_end = 0;
+	for (auto& sec : pdb->get_sections())
+		image_end = std::max(image_end, (u32)(sec.base_addr + sec.size));
+	printf("reference built in %.3f s, %zu pieces over 0x%x bytes\n", t.elapsed_sec(), reference.size(), image_end);
+
+	Validator v(opt, *pdb, cached.get(), reference);
+	if (image_end > 0)
+		v.spot_check(image_end);
+
+	t = Timer::start();
+	{
+		constexpr u32 CHUNK = 1 << 20; // multiple of any sensible step, so the steps stay aligned across chunks
+		u32 num_chunks = (u32)(((u64)image_end + CHUNK-1) / CHUNK);
+		ThreadPool pool(opt.threads);
+		pool.parallel_for(num_chunks, [&] (u32 c) {
+			u64 begin = (u64)c * CHUNK;
+			begin = (begin + opt.step-1) / opt.step * opt.step;
+			v.check_range((u32)begin, (u32)std::min((u64)(c+1) * CHUNK, (u64)image_end));
+		});
+	}
+	float sec = t.elapsed_sec();
+	printf("checked %llu addresses in %.3f s (%.0f addr/s) on %u threads\n", (unsigned long long)v.checked.load(), sec, (double)v.checked.load() / sec, opt.threads);
+
+	size_t total = v.total_mismatches();
+	v.print_summary();
+	printf(total ? "%zu mismatches\n" : "no mismatches\n", total);
+	return total ? 1 : 0;
+}